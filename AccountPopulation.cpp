@@ -0,0 +1,292 @@
+#include "AccountPopulation.h"
+#include "CSVReader.h"
+#include <random>
+#include <algorithm>
+
+AccountPopulation::AccountPopulation()
+{
+
+}
+
+/** create accounts with random funds and strategies, the same seed gives the same population */
+void AccountPopulation::createAccounts(size_t count, std::map<std::string, double> const& funds, unsigned seed)
+{
+    int first = table.addAccounts(count);
+    std::mt19937 random{seed};
+    std::uniform_real_distribution<double> fundsShare{0.0005, 0.002};
+    std::uniform_real_distribution<double> fraction{0.02, 0.1};
+    std::uniform_real_distribution<double> move{0, 0.005};
+
+    std::vector<double> shares(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        shares[i] = fundsShare(random);
+        orderFraction.push_back(fraction(random));
+        threshold.push_back(move(random));
+    }
+    for (auto const& currency : funds)
+    {
+        int c = table.addCurrency(currency.first);
+        for (size_t i = 0; i < count; ++i)
+        {
+            table.deposit(first + i, c, currency.second * shares[i]);
+        }
+    }
+}
+
+size_t AccountPopulation::accountCount() const
+{
+    return table.accountCount();
+}
+
+AccountTable const& AccountPopulation::getTable() const
+{
+    return table;
+}
+
+/** open order flags of the accounts on one product and side, added on first use */
+std::vector<unsigned char>& AccountPopulation::openOrders(std::string const& market)
+{
+    std::vector<unsigned char>& flags = open[market];
+    flags.resize(table.accountCount(), 0);
+    return flags;
+}
+
+/** reserve the orders of the accounts that act on this prediction and pool them under orderID */
+double AccountPopulation::openPool(std::string const& orderID,
+                                   std::string const& product,
+                                   OrderBookType side,
+                                   double price,
+                                   double prediction)
+{
+    size_t count = table.accountCount();
+    std::vector<std::string> currs = CSVReader::tokenise(product, '/');
+    if (count == 0 || price <= 0 || currs.size() != 2)
+    {
+        return 0;
+    }
+    bool isBid = side == OrderBookType::bid;
+    Pool pool;
+    pool.market = product + (isBid ? " bid" : " ask");
+    pool.base = table.addCurrency(currs[0]);
+    pool.quote = table.addCurrency(currs[1]);
+    pool.side = side;
+    pool.price = price;
+    int spent = isBid ? pool.quote : pool.base;
+
+    // the expected move in the direction of the order, a bid buys the base currency with the quote currency
+    double move = isBid ? prediction / price - 1 : 1 - prediction / price;
+    double perFunds = isBid ? 1 / price : 1;
+    unsigned char* busy = openOrders(pool.market).data();
+    const double* funds = table.freeBalances(spent);
+    amounts.resize(count);
+    double* amount = amounts.data();
+    for (size_t a = 0; a < count; ++a)
+    {
+        amount[a] = move > threshold[a] && !busy[a] ? orderFraction[a] * funds[a] * perFunds : 0;
+    }
+
+    for (size_t a = 0; a < count; ++a)
+    {
+        if (amount[a] > 0 && table.reserve(a, spent, isBid ? amount[a] * price : amount[a]))
+        {
+            pool.members.push_back(a);
+            pool.remaining.push_back(amount[a]);
+            pool.total += amount[a];
+            busy[a] = 1;
+            table.changeRestingOrders(a, 1);
+        }
+    }
+    if (pool.members.empty())
+    {
+        return 0;
+    }
+    accountOrders += pool.members.size();
+    poolsOpened++;
+    double total = pool.total;
+    pools[orderID] = std::move(pool);
+    return total;
+}
+
+/** share a fill of a pooled order out to its accounts */
+void AccountPopulation::onFill(OrderBookEntry const& sale)
+{
+    auto it = pools.find(sale.orderID);
+    if (it == pools.end() || it->second.total <= 0)
+    {
+        return;
+    }
+    Pool& pool = it->second;
+    // the pooled amount was rounded for the market, so a full fill can be a little above the total
+    double share = std::min(sale.amount / pool.total, 1.0);
+    double price = sale.price;
+    for (size_t j = 0; j < pool.members.size(); ++j)
+    {
+        double filled = pool.remaining[j] * share;
+        pool.remaining[j] -= filled;
+        if (pool.side == OrderBookType::bid)
+        {
+            // reserved at the bid price, the difference to the sale price goes back to the free balance
+            double refund = filled * sale.priceDifference;
+            table.settle(pool.members[j], pool.quote, filled * price + refund, refund, pool.base, filled);
+        }
+        else
+        {
+            table.settle(pool.members[j], pool.base, filled, 0, pool.quote, filled * price);
+        }
+    }
+    pool.total -= pool.total * share;
+    accountFills += pool.members.size();
+}
+
+/** the pool rests into the next tick */
+void AccountPopulation::keepPool(std::string const& orderID)
+{
+    auto it = pools.find(orderID);
+    if (it != pools.end())
+    {
+        it->second.kept = true;
+    }
+}
+
+/** release what the accounts of a pool still have reserved and close it */
+void AccountPopulation::closePool(std::string const& orderID)
+{
+    auto it = pools.find(orderID);
+    if (it == pools.end())
+    {
+        return;
+    }
+    Pool& pool = it->second;
+    bool isBid = pool.side == OrderBookType::bid;
+    std::vector<unsigned char>& busy = openOrders(pool.market);
+    for (size_t j = 0; j < pool.members.size(); ++j)
+    {
+        int account = pool.members[j];
+        table.release(account, isBid ? pool.quote : pool.base, isBid ? pool.remaining[j] * pool.price : pool.remaining[j]);
+        table.changeRestingOrders(account, -1);
+        busy[account] = 0;
+    }
+    pools.erase(it);
+}
+
+/** close the pools that were fully filled this tick, the kept ones stay open */
+void AccountPopulation::endTick()
+{
+    for (auto it = pools.begin(); it != pools.end();)
+    {
+        if (it->second.kept)
+        {
+            it->second.kept = false;
+            ++it;
+        }
+        else
+        {
+            std::string orderID = it->first;
+            ++it;
+            closePool(orderID);
+        }
+    }
+}
+
+/** value of all accounts in the quote currency of the graph */
+double AccountPopulation::valueOf(CurrencyGraph const& valuation) const
+{
+    double value = 0;
+    for (size_t c = 0; c < table.currencyCount(); ++c)
+    {
+        int currency = valuation.currencyId(table.currencyName(c));
+        if (currency >= 0)
+        {
+            value += table.totalBalance(c) * valuation.rate(currency);
+        }
+    }
+    return value;
+}
+
+/** summary of the population: accounts, orders, fills and resting orders */
+void AccountPopulation::report(std::ostream& out) const
+{
+    long long resting = 0;
+    for (size_t a = 0; a < table.accountCount(); ++a)
+    {
+        resting += table.restingOrders(a);
+    }
+    out << "Accounts: " << table.accountCount() << " simulated, " << accountOrders << " orders in " << poolsOpened
+        << " pooled orders, " << accountFills << " account fills, " << resting << " orders resting" << std::endl;
+}
+
+/** state for a checkpoint */
+void AccountPopulation::save(BinaryWriter& out) const
+{
+    table.save(out);
+    for (size_t a = 0; a < table.accountCount(); ++a)
+    {
+        out.writeDouble(threshold[a]);
+        out.writeDouble(orderFraction[a]);
+    }
+
+    out.writeInt(pools.size());
+    for (auto const& e : pools)
+    {
+        Pool const& pool = e.second;
+        out.writeString(e.first);
+        out.writeString(pool.market);
+        out.writeString(table.currencyName(pool.base));
+        out.writeString(table.currencyName(pool.quote));
+        out.writeInt((int)pool.side);
+        out.writeDouble(pool.price);
+        out.writeDouble(pool.total);
+        out.writeInt(pool.members.size());
+        for (size_t j = 0; j < pool.members.size(); ++j)
+        {
+            out.writeInt(pool.members[j]);
+            out.writeDouble(pool.remaining[j]);
+        }
+    }
+
+    out.writeInt(accountOrders);
+    out.writeInt(poolsOpened);
+    out.writeInt(accountFills);
+}
+
+void AccountPopulation::restore(BinaryReader& in)
+{
+    table.restore(in);
+    threshold.clear();
+    orderFraction.clear();
+    for (size_t a = 0; a < table.accountCount(); ++a)
+    {
+        threshold.push_back(in.readDouble());
+        orderFraction.push_back(in.readDouble());
+    }
+
+    // the open order flags follow from the members of the pools
+    pools.clear();
+    open.clear();
+    long long poolCount = in.readInt();
+    for (long long i = 0; i < poolCount; ++i)
+    {
+        std::string orderID = in.readString();
+        Pool pool;
+        pool.market = in.readString();
+        pool.base = table.addCurrency(in.readString());
+        pool.quote = table.addCurrency(in.readString());
+        pool.side = (OrderBookType)in.readInt();
+        pool.price = in.readDouble();
+        pool.total = in.readDouble();
+        std::vector<unsigned char>& busy = openOrders(pool.market);
+        long long members = in.readInt();
+        for (long long j = 0; j < members; ++j)
+        {
+            pool.members.push_back(in.readInt());
+            pool.remaining.push_back(in.readDouble());
+            busy[pool.members.back()] = 1;
+        }
+        pools[orderID] = std::move(pool);
+    }
+
+    accountOrders = in.readInt();
+    poolsOpened = in.readInt();
+    accountFills = in.readInt();
+}
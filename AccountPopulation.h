@@ -0,0 +1,93 @@
+#pragma once
+#include "AccountTable.h"
+#include "OrderBookEntry.h"
+#include "CurrencyGraph.h"
+#include "Checkpoint.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+/** a population of simple retail accounts trading on the bot's price prediction
+ * every account acts when the predicted move beats its own threshold and then orders a share of its
+ * free balance, one resting order per product and side at most; the orders of all accounts on one
+ * product and side at a tick are pooled into one market order at the current price, so matching
+ * sees one order however many accounts there are, and the fills of a pool are shared out to its
+ * accounts in proportion to what each of them still has open */
+class AccountPopulation
+{
+    public:
+        AccountPopulation();
+
+        /** create accounts, each funded with a random share between 0.05% and 0.2% of funds
+         * and trading 2% to 10% of its free balance once the predicted move is above 0 to 0.5% */
+        void createAccounts(size_t count, std::map<std::string, double> const& funds, unsigned seed);
+
+        size_t accountCount() const;
+        AccountTable const& getTable() const;
+
+        /** reserve the orders of the accounts that act on this prediction and pool them under orderID
+         * returns the pooled amount in the base currency, 0 if no account acts */
+        double openPool(std::string const& orderID,
+                        std::string const& product,
+                        OrderBookType side,
+                        double price,
+                        double prediction);
+
+        /** share a fill of a pooled order out to its accounts */
+        void onFill(OrderBookEntry const& sale);
+
+        /** the pool rests into the next tick */
+        void keepPool(std::string const& orderID);
+
+        /** release what the accounts of a pool still have reserved and close it */
+        void closePool(std::string const& orderID);
+
+        /** close the pools that were fully filled this tick, the kept ones stay open */
+        void endTick();
+
+        /** value of all accounts in the quote currency of the graph */
+        double valueOf(CurrencyGraph const& valuation) const;
+
+        /** summary of the population: accounts, orders, fills and resting orders */
+        void report(std::ostream& out) const;
+
+        /** state for a checkpoint */
+        void save(BinaryWriter& out) const;
+        void restore(BinaryReader& in);
+
+    private:
+        /** pooled order of several accounts, with what each of them still has open in the base currency */
+        struct Pool
+        {
+            std::string market;
+            int base;
+            int quote;
+            OrderBookType side;
+            double price;
+            std::vector<int> members;
+            std::vector<double> remaining;
+            double total = 0;
+            bool kept = false;
+        };
+
+        /** open order flags of the accounts on one product and side, added on first use */
+        std::vector<unsigned char>& openOrders(std::string const& market);
+
+        AccountTable table;
+
+        // strategy of each account, indexed by account ID
+        std::vector<double> threshold;
+        std::vector<double> orderFraction;
+
+        // accounts with a resting order, by product and side like "ETH/BTC bid"
+        std::map<std::string, std::vector<unsigned char>> open;
+        std::map<std::string, Pool> pools;
+
+        // order amounts of the accounts while a pool is opened
+        std::vector<double> amounts;
+
+        long long accountOrders = 0;
+        long long poolsOpened = 0;
+        long long accountFills = 0;
+};
@@ -0,0 +1,188 @@
+#include "AccountTable.h"
+
+AccountTable::AccountTable()
+{
+
+}
+
+/** add accounts with no funds, returns the ID of the first */
+int AccountTable::addAccounts(size_t count)
+{
+    int first = accounts;
+    accounts += count;
+    for (size_t c = 0; c < currencyNames.size(); ++c)
+    {
+        free[c].resize(accounts, 0);
+        reserved[c].resize(accounts, 0);
+    }
+    resting.resize(accounts, 0);
+    return first;
+}
+
+size_t AccountTable::accountCount() const
+{
+    return accounts;
+}
+
+/** ID of a currency, added on first use with no funds in any account */
+int AccountTable::addCurrency(std::string const& currency)
+{
+    auto it = currencyIds.find(currency);
+    if (it != currencyIds.end())
+    {
+        return it->second;
+    }
+    int id = currencyNames.size();
+    currencyIds[currency] = id;
+    currencyNames.push_back(currency);
+    free.emplace_back(accounts, 0);
+    reserved.emplace_back(accounts, 0);
+    return id;
+}
+
+/** ID of a known currency, -1 otherwise */
+int AccountTable::currencyId(std::string const& currency) const
+{
+    auto it = currencyIds.find(currency);
+    return it == currencyIds.end() ? -1 : it->second;
+}
+
+std::string const& AccountTable::currencyName(int currency) const
+{
+    return currencyNames[currency];
+}
+
+size_t AccountTable::currencyCount() const
+{
+    return currencyNames.size();
+}
+
+/** add funds to the free balance */
+void AccountTable::deposit(int account, int currency, double amount)
+{
+    free[currency][account] += amount;
+}
+
+/** move an amount from the free to the reserved balance, false if the free balance is too small */
+bool AccountTable::reserve(int account, int currency, double amount)
+{
+    if (free[currency][account] < amount)
+    {
+        return false;
+    }
+    free[currency][account] -= amount;
+    reserved[currency][account] += amount;
+    return true;
+}
+
+/** move an amount from the reserved back to the free balance */
+void AccountTable::release(int account, int currency, double amount)
+{
+    reserved[currency][account] -= amount;
+    free[currency][account] += amount;
+}
+
+/** settle a fill of an order of the account */
+void AccountTable::settle(int account, int spentCurrency, double spent, double refund, int receivedCurrency, double received)
+{
+    reserved[spentCurrency][account] -= spent;
+    free[spentCurrency][account] += refund;
+    free[receivedCurrency][account] += received;
+}
+
+double AccountTable::freeBalance(int account, int currency) const
+{
+    return free[currency][account];
+}
+
+double AccountTable::reservedBalance(int account, int currency) const
+{
+    return reserved[currency][account];
+}
+
+double* AccountTable::freeBalances(int currency)
+{
+    return free[currency].data();
+}
+
+double* AccountTable::reservedBalances(int currency)
+{
+    return reserved[currency].data();
+}
+
+const double* AccountTable::freeBalances(int currency) const
+{
+    return free[currency].data();
+}
+
+const double* AccountTable::reservedBalances(int currency) const
+{
+    return reserved[currency].data();
+}
+
+/** free and reserved balances of a currency over all accounts */
+double AccountTable::totalBalance(int currency) const
+{
+    double total = 0;
+    for (size_t a = 0; a < accounts; ++a)
+    {
+        total += free[currency][a] + reserved[currency][a];
+    }
+    return total;
+}
+
+int AccountTable::restingOrders(int account) const
+{
+    return resting[account];
+}
+
+void AccountTable::changeRestingOrders(int account, int delta)
+{
+    resting[account] += delta;
+}
+
+/** state for a checkpoint */
+void AccountTable::save(BinaryWriter& out) const
+{
+    out.writeInt(accounts);
+    out.writeInt(currencyNames.size());
+    for (size_t c = 0; c < currencyNames.size(); ++c)
+    {
+        out.writeString(currencyNames[c]);
+        for (size_t a = 0; a < accounts; ++a)
+        {
+            out.writeDouble(free[c][a]);
+            out.writeDouble(reserved[c][a]);
+        }
+    }
+    for (size_t a = 0; a < accounts; ++a)
+    {
+        out.writeInt(resting[a]);
+    }
+}
+
+void AccountTable::restore(BinaryReader& in)
+{
+    accounts = 0;
+    currencyNames.clear();
+    currencyIds.clear();
+    free.clear();
+    reserved.clear();
+    resting.clear();
+
+    addAccounts(in.readInt());
+    long long currencies = in.readInt();
+    for (long long i = 0; i < currencies; ++i)
+    {
+        int c = addCurrency(in.readString());
+        for (size_t a = 0; a < accounts; ++a)
+        {
+            free[c][a] = in.readDouble();
+            reserved[c][a] = in.readDouble();
+        }
+    }
+    for (size_t a = 0; a < accounts; ++a)
+    {
+        resting[a] = in.readInt();
+    }
+}
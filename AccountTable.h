@@ -0,0 +1,71 @@
+#pragma once
+#include "Checkpoint.h"
+#include <string>
+#include <vector>
+#include <map>
+
+/** balances of many simulated accounts, one array per currency indexed by account ID
+ * free and reserved balances play the part of the standard and reserved wallets of Assets,
+ * with the number of resting orders of every account next to them; loops over all accounts
+ * for one currency run over contiguous memory */
+class AccountTable
+{
+    public:
+        AccountTable();
+
+        /** add accounts with no funds, returns the ID of the first */
+        int addAccounts(size_t count);
+
+        size_t accountCount() const;
+
+        /** ID of a currency, added on first use with no funds in any account */
+        int addCurrency(std::string const& currency);
+
+        /** ID of a known currency, -1 otherwise */
+        int currencyId(std::string const& currency) const;
+
+        std::string const& currencyName(int currency) const;
+        size_t currencyCount() const;
+
+        /** add funds to the free balance */
+        void deposit(int account, int currency, double amount);
+
+        /** move an amount from the free to the reserved balance, false if the free balance is too small */
+        bool reserve(int account, int currency, double amount);
+
+        /** move an amount from the reserved back to the free balance */
+        void release(int account, int currency, double amount);
+
+        /** settle a fill: spent leaves the reserved balance of one currency, refund of it goes back to the free balance
+         * (a bid filled below its price) and received is added to the free balance of the other currency */
+        void settle(int account, int spentCurrency, double spent, double refund, int receivedCurrency, double received);
+
+        double freeBalance(int account, int currency) const;
+        double reservedBalance(int account, int currency) const;
+
+        /** balances of one currency for every account, indexed by account ID */
+        double* freeBalances(int currency);
+        double* reservedBalances(int currency);
+        const double* freeBalances(int currency) const;
+        const double* reservedBalances(int currency) const;
+
+        /** free and reserved balances of a currency over all accounts */
+        double totalBalance(int currency) const;
+
+        /** number of orders of an account waiting in the market */
+        int restingOrders(int account) const;
+        void changeRestingOrders(int account, int delta);
+
+        /** state for a checkpoint */
+        void save(BinaryWriter& out) const;
+        void restore(BinaryReader& in);
+
+    private:
+        size_t accounts = 0;
+        std::vector<std::string> currencyNames;
+        std::map<std::string, int> currencyIds;
+        // balances by currency, then account
+        std::vector<std::vector<double>> free;
+        std::vector<std::vector<double>> reserved;
+        std::vector<int> resting;
+};
@@ -0,0 +1,344 @@
+#include "AssetLedger.h"
+#include "OrderBookEntry.h"
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+
+static const std::string ledgerMagic = "MerkelLedger";
+static const uint8_t ledgerVersion = 1;
+
+/** append the bytes of a value */
+template <typename T>
+static void put(std::ofstream& out, T value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/** append a string with a one byte length, longer names are cut */
+static size_t putName(std::ofstream& out, std::string const& name)
+{
+    uint8_t length = std::min<size_t>(name.size(), 255);
+    put(out, length);
+    out.write(name.data(), length);
+    return 1 + length;
+}
+
+/** read the bytes of a value, false at the end of the file */
+template <typename T>
+static bool get(std::ifstream& in, T& value)
+{
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return in.gcount() == sizeof(value);
+}
+
+AssetLedgerWriter::AssetLedgerWriter(std::string _path, int _snapshotInterval, long long resumeOffset, long long resumeIndexOffset)
+: path(_path),
+  snapshotInterval(_snapshotInterval)
+{
+    if (resumeOffset >= 0 && resumeIndexOffset >= 0)
+    {
+        // changes written after the checkpoint are dropped, the resumed run writes them again
+        std::filesystem::resize_file(path, resumeOffset);
+        std::filesystem::resize_file(path + ".index", resumeIndexOffset);
+        file.open(path, std::ios::binary | std::ios::app);
+        index.open(path + ".index", std::ios::binary | std::ios::app);
+        fileSize = resumeOffset;
+        indexSize = resumeIndexOffset;
+    }
+    else
+    {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        index.open(path + ".index", std::ios::binary | std::ios::trunc);
+        file.write(ledgerMagic.data(), ledgerMagic.size());
+        put(file, ledgerVersion);
+        fileSize = ledgerMagic.size() + 1;
+    }
+    if (!file || !index)
+    {
+        throw std::runtime_error{"cannot open ledger " + path};
+    }
+}
+
+/** start a tick, taking a snapshot of the wallets if one is due or forced */
+void AssetLedgerWriter::beginTick(std::string const& timestamp,
+                                  std::map<std::string, double> const& standard,
+                                  std::map<std::string, double> const& reserved,
+                                  std::map<std::string, double> const& total,
+                                  bool forceSnapshot)
+{
+    if (timestamp == currentTimestamp && !forceSnapshot)
+    {
+        return;
+    }
+    currentTimestamp = timestamp;
+    currentMicros = OrderBookEntry::timestampToMicros(timestamp);
+    tickWritten = false;
+    tickHasChanges = false;
+
+    // the first tick always has a snapshot, so every later tick has one to start from
+    bool due = ticksSeen == 0 || (snapshotInterval > 0 && ticksSeen % snapshotInterval == 0);
+    ticksSeen++;
+    if (due || forceSnapshot)
+    {
+        writeSnapshot(standard, reserved, total);
+    }
+}
+
+void AssetLedgerWriter::writeSnapshot(std::map<std::string, double> const& standard,
+                                      std::map<std::string, double> const& reserved,
+                                      std::map<std::string, double> const& total)
+{
+    put(index, currentMicros);
+    put(index, fileSize);
+    indexSize += 2 * sizeof(long long);
+
+    // every currency in any of the wallets, with the wallets it appears in
+    std::map<std::string, uint8_t> presence;
+    for (auto const& e : standard)
+        presence[e.first] |= 1;
+    for (auto const& e : reserved)
+        presence[e.first] |= 2;
+    for (auto const& e : total)
+        presence[e.first] |= 4;
+
+    put(file, LedgerRecordType::snapshot);
+    put(file, currentMicros);
+    fileSize += 1 + sizeof(currentMicros) + putName(file, currentTimestamp);
+    put(file, (uint16_t)presence.size());
+    fileSize += sizeof(uint16_t);
+
+    currencyIds.clear();
+    for (auto const& e : presence)
+    {
+        uint16_t id = currencyIds.size();
+        currencyIds[e.first] = id;
+        put(file, id);
+        fileSize += sizeof(id) + putName(file, e.first);
+        put(file, e.second);
+        put(file, (e.second & 1) ? standard.at(e.first) : 0.0);
+        put(file, (e.second & 2) ? reserved.at(e.first) : 0.0);
+        put(file, (e.second & 4) ? total.at(e.first) : 0.0);
+        fileSize += 1 + 3 * sizeof(double);
+    }
+    tickWritten = true;
+    snapshots++;
+}
+
+/** ID of a currency, announced with a currency record the first time */
+int AssetLedgerWriter::currencyId(std::string const& currency)
+{
+    auto it = currencyIds.find(currency);
+    if (it != currencyIds.end())
+    {
+        return it->second;
+    }
+    uint16_t id = currencyIds.size();
+    currencyIds[currency] = id;
+    put(file, LedgerRecordType::currency);
+    put(file, id);
+    fileSize += 1 + sizeof(id) + putName(file, currency);
+    return id;
+}
+
+/** add a balance change of the current tick */
+void AssetLedgerWriter::record(LedgerRecordType type, bool reserved, std::string const& currency, double delta)
+{
+    if (!tickWritten)
+    {
+        put(file, LedgerRecordType::tick);
+        put(file, currentMicros);
+        fileSize += 1 + sizeof(currentMicros) + putName(file, currentTimestamp);
+        tickWritten = true;
+    }
+    if (!tickHasChanges)
+    {
+        ticksWithChanges++;
+        tickHasChanges = true;
+    }
+    uint16_t id = currencyId(currency);
+    put(file, type);
+    put(file, (uint8_t)reserved);
+    put(file, id);
+    put(file, delta);
+    fileSize += 2 + sizeof(id) + sizeof(delta);
+    changes++;
+}
+
+/** write buffered records to the files */
+void AssetLedgerWriter::flush()
+{
+    file.flush();
+    index.flush();
+}
+
+long long AssetLedgerWriter::position()
+{
+    flush();
+    return fileSize;
+}
+
+long long AssetLedgerWriter::indexPosition()
+{
+    flush();
+    return indexSize;
+}
+
+/** one line summary: ticks with changes, changes, snapshots and bytes */
+void AssetLedgerWriter::report(std::ostream& out)
+{
+    out << "Asset ledger " << path << ": " << changes << " balance changes on " << ticksWithChanges << " of "
+        << ticksSeen << " ticks, " << snapshots << " snapshots, " << position() << " bytes" << std::endl;
+}
+
+AssetLedgerReader::AssetLedgerReader(std::string _path)
+: path(_path),
+  file(_path, std::ios::binary)
+{
+    std::string magic(ledgerMagic.size(), '\0');
+    uint8_t version = 0;
+    file.read(&magic[0], magic.size());
+    if (!file || magic != ledgerMagic || !get(file, version) || version != ledgerVersion)
+    {
+        throw std::runtime_error{"not a ledger: " + path};
+    }
+
+    std::ifstream index{path + ".index", std::ios::binary};
+    if (!index)
+    {
+        throw std::runtime_error{"missing ledger index: " + path + ".index"};
+    }
+    long long micros, offset;
+    while (get(index, micros) && get(index, offset))
+    {
+        snapshotTimes.push_back(micros);
+        snapshotOffsets.push_back(offset);
+    }
+}
+
+/** read a length prefixed string */
+std::string AssetLedgerReader::readName()
+{
+    uint8_t length = 0;
+    get(file, length);
+    std::string name(length, '\0');
+    file.read(&name[0], length);
+    return name;
+}
+
+/** wallets after all changes of ticks up to and including this time in microseconds */
+bool AssetLedgerReader::stateAt(long long micros, LedgerState& state)
+{
+    // latest snapshot at or before the time, snapshots are in time order
+    // except that a resumed run can repeat the time of an earlier one, the later offset wins
+    auto it = std::upper_bound(snapshotTimes.begin(), snapshotTimes.end(), micros);
+    if (it == snapshotTimes.begin())
+    {
+        return false;
+    }
+    size_t snapshot = it - snapshotTimes.begin() - 1;
+
+    file.clear();
+    file.seekg(snapshotOffsets[snapshot]);
+    std::map<int, std::string> names;
+    lastChanges = 0;
+    bool started = false;
+
+    LedgerRecordType type;
+    while (get(file, type))
+    {
+        if (type == LedgerRecordType::snapshot || type == LedgerRecordType::tick)
+        {
+            long long recordMicros = 0;
+            get(file, recordMicros);
+            std::string timestamp = readName();
+            if (started && recordMicros > micros)
+            {
+                break;
+            }
+            state.timestamp = timestamp;
+            if (type == LedgerRecordType::tick)
+            {
+                continue;
+            }
+
+            // a snapshot replaces the wallets and the currency IDs
+            started = true;
+            lastSnapshotMicros = recordMicros;
+            state.standard.clear();
+            state.reserved.clear();
+            state.total.clear();
+            names.clear();
+            uint16_t count = 0;
+            get(file, count);
+            for (uint16_t i = 0; i < count; ++i)
+            {
+                uint16_t id = 0;
+                uint8_t presence = 0;
+                double standard = 0, reserved = 0, total = 0;
+                get(file, id);
+                std::string name = readName();
+                get(file, presence);
+                get(file, standard);
+                get(file, reserved);
+                get(file, total);
+                names[id] = name;
+                if (presence & 1)
+                    state.standard[name] = standard;
+                if (presence & 2)
+                    state.reserved[name] = reserved;
+                if (presence & 4)
+                    state.total[name] = total;
+            }
+        }
+        else if (type == LedgerRecordType::currency)
+        {
+            uint16_t id = 0;
+            get(file, id);
+            names[id] = readName();
+        }
+        else if (type >= LedgerRecordType::deposit && type <= LedgerRecordType::cancel)
+        {
+            uint8_t reserved = 0;
+            uint16_t id = 0;
+            double delta = 0;
+            get(file, reserved);
+            get(file, id);
+            if (!get(file, delta))
+            {
+                // a change cut short by a crash is not applied
+                break;
+            }
+            std::string const& name = names[id];
+            std::map<std::string, double>& wallet = reserved ? state.reserved : state.standard;
+            wallet[name] += delta;
+            // the same operations as Assets, where deposits and fills update the total assets
+            if (type == LedgerRecordType::deposit || type == LedgerRecordType::fill)
+            {
+                state.total[name] = state.standard[name] + state.reserved[name];
+            }
+            lastChanges++;
+        }
+        else
+        {
+            throw std::runtime_error{"corrupt ledger record in " + path};
+        }
+    }
+    return started;
+}
+
+/** wallets after the last tick of the ledger */
+bool AssetLedgerReader::finalState(LedgerState& state)
+{
+    return stateAt(LLONG_MAX, state);
+}
+
+long long AssetLedgerReader::snapshotMicros() const
+{
+    return lastSnapshotMicros;
+}
+
+long long AssetLedgerReader::changesApplied() const
+{
+    return lastChanges;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+
+/** kinds of ledger records, balance changes are named after the Assets operation that made them */
+enum class LedgerRecordType : uint8_t {tick = 1, snapshot, currency, deposit, reserve, release, fill, cancel};
+
+/** wallets rebuilt from the ledger, keyed by currency like the Wallet maps */
+struct LedgerState
+{
+    std::string timestamp;
+    std::map<std::string, double> standard;
+    std::map<std::string, double> reserved;
+    std::map<std::string, double> total;
+};
+
+/** writes the balance changes of the bot as binary records instead of logging every wallet each tick
+ * a tick record is written only for ticks with changes, a full snapshot every snapshotInterval ticks
+ * and the offset of every snapshot goes to <path>.index so readers can seek to the nearest one
+ *
+ * file layout, little endian as written by the machine:
+ *   header   "MerkelLedger" and a version byte
+ *   tick     type, micros (8 bytes), timestamp length (1 byte) and text, starts the changes of a tick
+ *   snapshot type, micros, timestamp, currency count (2 bytes), then per currency its ID (2 bytes), name length,
+ *            name, the wallets it is in (1 byte, bits for standard, reserved and total) and the standard,
+ *            reserved and total balances (8 bytes each), also starts a tick
+ *   currency type, ID (2 bytes), name length and name, the first time a currency changes after a snapshot
+ *   change   type, wallet (1 byte), currency ID (2 bytes) and the delta (8 bytes)
+ * the currency IDs of a snapshot replace all earlier ones, so a resumed run can number them anew */
+class AssetLedgerWriter
+{
+    public:
+        /** resumeOffset and resumeIndexOffset truncate an existing ledger back to a checkpoint, -1 starts a new one */
+        AssetLedgerWriter(std::string _path, int _snapshotInterval, long long resumeOffset = -1, long long resumeIndexOffset = -1);
+
+        AssetLedgerWriter(AssetLedgerWriter const&) = delete;
+        AssetLedgerWriter& operator=(AssetLedgerWriter const&) = delete;
+
+        /** start a tick, taking a snapshot of the wallets if one is due or forced
+         * calls with the timestamp of the current tick are ignored */
+        void beginTick(std::string const& timestamp,
+                       std::map<std::string, double> const& standard,
+                       std::map<std::string, double> const& reserved,
+                       std::map<std::string, double> const& total,
+                       bool forceSnapshot = false);
+
+        /** add a balance change of the current tick */
+        void record(LedgerRecordType type, bool reserved, std::string const& currency, double delta);
+
+        /** write buffered records to the files */
+        void flush();
+
+        /** size of the ledger and index files once flushed, for checkpoints */
+        long long position();
+        long long indexPosition();
+
+        /** one line summary: ticks with changes, changes, snapshots and bytes */
+        void report(std::ostream& out);
+
+    private:
+        void writeSnapshot(std::map<std::string, double> const& standard,
+                           std::map<std::string, double> const& reserved,
+                           std::map<std::string, double> const& total);
+
+        /** ID of a currency, announced with a currency record the first time */
+        int currencyId(std::string const& currency);
+
+        std::string path;
+        int snapshotInterval;
+        std::ofstream file;
+        std::ofstream index;
+
+        std::string currentTimestamp;
+        long long currentMicros = 0;
+        bool tickWritten = false;
+        bool tickHasChanges = false;
+        long long ticksSeen = 0;
+        // bytes in the files, written or still buffered
+        long long fileSize = 0;
+        long long indexSize = 0;
+        std::map<std::string, int> currencyIds;
+
+        long long changes = 0;
+        long long ticksWithChanges = 0;
+        long long snapshots = 0;
+};
+
+/** rebuilds the wallets at any tick of a ledger from the nearest snapshot before it */
+class AssetLedgerReader
+{
+    public:
+        /** throws std::runtime_error if the ledger or its index cannot be read */
+        AssetLedgerReader(std::string _path);
+
+        /** wallets after all changes of ticks up to and including this time in microseconds,
+         * false if the ledger starts later */
+        bool stateAt(long long micros, LedgerState& state);
+
+        /** wallets after the last tick of the ledger */
+        bool finalState(LedgerState& state);
+
+        /** snapshot and changes read by the last query */
+        long long snapshotMicros() const;
+        long long changesApplied() const;
+
+    private:
+        std::string path;
+        std::ifstream file;
+        // snapshot times and offsets from the index, in file order
+        std::vector<long long> snapshotTimes;
+        std::vector<long long> snapshotOffsets;
+
+        long long lastSnapshotMicros = 0;
+        long long lastChanges = 0;
+
+        /** read a length prefixed string */
+        std::string readName();
+};
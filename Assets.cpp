@@ -8,24 +8,34 @@ Assets::Assets()
 /** add amounts to wallet */
 void Assets::addFunds()
 {
-    standardWallet.insertCurrency("BTC", 10);
-    updateTotalAssets("BTC");
-    standardWallet.insertCurrency("ETH", 500);
-    updateTotalAssets("ETH");
-    standardWallet.insertCurrency("USDT", 50000);
-    updateTotalAssets("USDT");
-    standardWallet.insertCurrency("DOGE", 10000000);
-    updateTotalAssets("DOGE");
+    addFunds(BotParameters{}.initialFunds);
+}
+
+/** add the given amount of each currency to the wallet */
+void Assets::addFunds(std::map<std::string, double> const& funds)
+{
+    for (auto const& e : funds)
+    {
+        standardWallet.insertCurrency(e.first, e.second);
+        recordChange(LedgerRecordType::deposit, false, e.first, e.second);
+        updateTotalAssets(e.first);
+    }
 }
 
 /** set standard order amount */
 void Assets::setStandardOrderAmounts()
+{
+    setStandardOrderAmounts(BotParameters{}.standardOrderFraction);
+}
+
+/** set standard order amount as a fraction of the current balance of each currency */
+void Assets::setStandardOrderAmounts(double fraction)
 {
     // initializing standard amounts for orders
-    standardOrderAmount["BTC"] = 0.05 * standardWallet.currencies["BTC"];
-    standardOrderAmount["ETH"] = 0.05 * standardWallet.currencies["ETH"];
-    standardOrderAmount["USDT"] = 0.05 * standardWallet.currencies["USDT"];
-    standardOrderAmount["DOGE"] = 0.05 * standardWallet.currencies["DOGE"];
+    for (auto const& e : standardWallet.currencies)
+    {
+        standardOrderAmount[e.first] = fraction * e.second;
+    }
 }
 
 /** update the contents of the wallets after processing a sale */
@@ -44,6 +54,8 @@ void Assets::processSale(OrderBookEntry& sale)
         // update assets
         standardWallet.currencies[incomingCurrency] += incomingAmount;
         reservedWallet.currencies[outgoingCurrency] -= outgoingAmount;
+        recordChange(LedgerRecordType::fill, false, incomingCurrency, incomingAmount);
+        recordChange(LedgerRecordType::fill, true, outgoingCurrency, -outgoingAmount);
         updateTotalAssets(incomingCurrency);
         updateTotalAssets(outgoingCurrency);
     }
@@ -64,6 +76,9 @@ void Assets::processSale(OrderBookEntry& sale)
         standardWallet.currencies[incomingCurrency] += incomingAmount;
         standardWallet.currencies[outgoingCurrency] += residualAmount;
         reservedWallet.currencies[outgoingCurrency] -= (outgoingAmount + residualAmount);
+        recordChange(LedgerRecordType::fill, false, incomingCurrency, incomingAmount);
+        recordChange(LedgerRecordType::fill, false, outgoingCurrency, residualAmount);
+        recordChange(LedgerRecordType::fill, true, outgoingCurrency, -(outgoingAmount + residualAmount));
         updateTotalAssets(incomingCurrency);
         updateTotalAssets(outgoingCurrency);
     } 
@@ -74,7 +89,11 @@ void Assets::blockAmount(std::string currency, double amount)
 {
     // move order amount for product to the reserved wallet to avoid placing uncovered bids/asks
     reservedWallet.insertCurrency(currency, amount);
-    standardWallet.removeCurrency(currency, amount);
+    recordChange(LedgerRecordType::reserve, true, currency, amount);
+    if (standardWallet.removeCurrency(currency, amount))
+    {
+        recordChange(LedgerRecordType::reserve, false, currency, -amount);
+    }
 }
 
 /** move amounts from reserved wallet back to the standard wallet */
@@ -82,13 +101,50 @@ void Assets::unblockAmount(std::string currency, double amount)
 {
     // move order amount for product to the reserved wallet to avoid placing uncovered bids/asks
     standardWallet.insertCurrency(currency, amount);
-    reservedWallet.removeCurrency(currency, amount);
+    recordChange(LedgerRecordType::release, false, currency, amount);
+    if (reservedWallet.removeCurrency(currency, amount))
+    {
+        recordChange(LedgerRecordType::release, true, currency, -amount);
+    }
 }
 
 /** update total assets: standard wallet + reserved wallet */
 void Assets::updateTotalAssets(std::string currency)
 {
-    totalAssets.currencies[currency] = standardWallet.currencies[currency] + reservedWallet.currencies[currency];
+    double& total = totalAssets.currencies[currency];
+    total = standardWallet.currencies[currency] + reservedWallet.currencies[currency];
+    if (valuation)
+    {
+        valuation->setBalance(valuation->addCurrency(currency), total);
+    }
+}
+
+/** keep the balances of a valuation graph equal to the total assets from now on */
+void Assets::setValuation(CurrencyGraph* _valuation)
+{
+    valuation = _valuation;
+    if (valuation)
+    {
+        for (auto const& e : totalAssets.currencies)
+        {
+            valuation->setBalance(valuation->addCurrency(e.first), e.second);
+        }
+    }
+}
+
+/** record every balance change to a ledger from now on */
+void Assets::setLedger(AssetLedgerWriter* _ledger)
+{
+    ledger = _ledger;
+}
+
+/** record a balance change if there is a ledger */
+void Assets::recordChange(LedgerRecordType type, bool reserved, std::string const& currency, double delta)
+{
+    if (ledger)
+    {
+        ledger->record(type, reserved, currency, delta);
+    }
 }
 
 /** update the contents of the wallets following order cancellation */
@@ -114,10 +170,16 @@ void Assets::processOrderCancellation(OrderBookEntry& order, Wallet& stdWallet,
     // remove blocked amount from the reserved wallet and add it back to the standard wallet
     resWallet.currencies[currency] -= blockedAmount;
     stdWallet.currencies[currency] += blockedAmount;
+    // only changes to the wallets of these assets belong in their ledger
+    if (&resWallet == &reservedWallet && &stdWallet == &standardWallet)
+    {
+        recordChange(LedgerRecordType::cancel, true, currency, -blockedAmount);
+        recordChange(LedgerRecordType::cancel, false, currency, blockedAmount);
+    }
 }
 
 /** function to log assets in all wallets (standard, reserved, total) */
-void Assets::logAssets(std::ofstream& logFile)
+void Assets::logAssets(std::ostream& logFile)
 {
     logFile << "Standard Wallet: " << std::endl;
     logFile << standardWallet.toString() << std::endl;
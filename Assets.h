@@ -3,6 +3,9 @@
 #include "Wallet.h"
 #include "CSVReader.h"
 #include "OrderBookEntry.h"
+#include "BotParameters.h"
+#include "CurrencyGraph.h"
+#include "AssetLedger.h"
 #include <iostream>
 #include <fstream>
 
@@ -20,9 +23,15 @@ class Assets
         /** add amounts to wallet */
         void addFunds();
 
+        /** add the given amount of each currency to the wallet */
+        void addFunds(std::map<std::string, double> const& funds);
+
         /** set standard order amount */
         void setStandardOrderAmounts();
 
+        /** set standard order amount as a fraction of the current balance of each currency */
+        void setStandardOrderAmounts(double fraction);
+
         /** update the contents of the wallets after processing a sale */
         void processSale(OrderBookEntry& sale);
 
@@ -35,12 +44,24 @@ class Assets
         /** update total assets: standard wallet + reserved wallet */
         void updateTotalAssets(std::string currency);
 
+        /** keep the balances of a valuation graph equal to the total assets from now on, null to stop */
+        void setValuation(CurrencyGraph* _valuation);
+
+        /** record every balance change to a ledger from now on, null to stop */
+        void setLedger(AssetLedgerWriter* _ledger);
+
         /** update the contents of the wallets following order cancellation */
         void processOrderCancellation(OrderBookEntry& order, Wallet& stdWallet, Wallet& resWallet);
 
         /** function to log assets in both wallets (standard, reserved) */
-        void logAssets(std::ofstream& logFile);
+        void logAssets(std::ostream& logFile);
 
     private:
+        // graph that values the total assets, told about every change of them
+        CurrencyGraph* valuation = nullptr;
+        // ledger of the balance changes, each recorded as the delta added to one wallet
+        AssetLedgerWriter* ledger = nullptr;
 
+        /** record a balance change if there is a ledger */
+        void recordChange(LedgerRecordType type, bool reserved, std::string const& currency, double delta);
 };
\ No newline at end of file
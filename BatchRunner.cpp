@@ -0,0 +1,115 @@
+#include "BatchRunner.h"
+#include "MerkelBot.h"
+#include "WorkStealingPool.h"
+#include <filesystem>
+#include <map>
+#include <set>
+#include <chrono>
+
+BatchRunner::BatchRunner(std::vector<std::string> _datasetFiles, std::string _outputDirectory, int _threads)
+: datasetFiles(_datasetFiles),
+  outputDirectory(_outputDirectory),
+  threads(_threads)
+{
+
+}
+
+/** run one simulation with its own bot, assets and logs */
+BatchRunResult BatchRunner::runOne(std::string const& datasetFile, std::string const& outputDirectory)
+{
+    BatchRunResult result;
+    result.datasetFile = datasetFile;
+    result.outputDirectory = outputDirectory;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    try
+    {
+        std::filesystem::create_directories(outputDirectory);
+
+        // nothing is shared between runs: bot, assets, order book and logs all belong to this task
+        MerkelBot bot{std::vector<std::string>{datasetFile}};
+        bot.setOutputDirectory(outputDirectory);
+        bot.setVerbose(false);
+        bot.init();
+
+        result.finalAssetsUSD = bot.getTotalAssetsUSD();
+        result.fills = bot.getFillCount();
+        result.orders = bot.getOrderCount();
+        result.completed = true;
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "BatchRunner::runOne failed on " << datasetFile << ": " << e.what() << std::endl;
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    result.wallTimeMicros = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+    return result;
+}
+
+/** run every simulation and return the results in dataset order */
+std::vector<BatchRunResult> BatchRunner::run()
+{
+    std::vector<BatchRunResult> results(datasetFiles.size());
+
+    // files from different directories can share a name, their runs are told apart by their position
+    std::map<std::string, int> stemCount;
+    for (std::string const& file : datasetFiles)
+    {
+        stemCount[std::filesystem::path(file).stem().string()]++;
+    }
+    std::set<std::string> usedNames;
+
+    WorkStealingPool pool{threads};
+    for (size_t i = 0; i < datasetFiles.size(); ++i)
+    {
+        std::string stem = std::filesystem::path(datasetFiles[i]).stem().string();
+        std::string name = stemCount[stem] > 1 ? std::to_string(i + 1) + "-" + stem : stem;
+        while (!usedNames.insert(name).second)
+        {
+            name = std::to_string(i + 1) + "-" + name;
+        }
+
+        // every task writes only its own slot of the results and its own directory
+        std::string runDirectory = outputDirectory + "/" + name;
+        pool.submit([this, i, runDirectory, &results]()
+        {
+            results[i] = runOne(datasetFiles[i], runDirectory);
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+/** write the combined summary as CSV */
+void BatchRunner::writeSummary(std::vector<BatchRunResult> const& results, std::ostream& out)
+{
+    double totalUSD = 0;
+    long long totalFills = 0, totalOrders = 0, totalMicros = 0;
+    int completed = 0;
+
+    out << "Dataset,Completed,Final_Assets_USD,Fills,Orders,Wall_Time_Microseconds,Log_Directory" << std::endl;
+    for (BatchRunResult const& r : results)
+    {
+        out << r.datasetFile << ",";
+        out << (r.completed ? "yes" : "no") << ",";
+        out << std::to_string(r.finalAssetsUSD) << ",";
+        out << r.fills << ",";
+        out << r.orders << ",";
+        out << r.wallTimeMicros << ",";
+        out << r.outputDirectory << std::endl;
+
+        if (r.completed)
+        {
+            completed++;
+            totalUSD += r.finalAssetsUSD;
+        }
+        totalFills += r.fills;
+        totalOrders += r.orders;
+        totalMicros += r.wallTimeMicros;
+    }
+    out << "Total," << completed << "/" << results.size() << ",";
+    out << std::to_string(totalUSD) << ",";
+    out << totalFills << ",";
+    out << totalOrders << ",";
+    out << totalMicros << "," << std::endl;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+
+/** outcome of one independent simulation in a batch */
+struct BatchRunResult
+{
+    std::string datasetFile;
+    std::string outputDirectory;
+    bool completed = false;
+    double finalAssetsUSD = 0;
+    int fills = 0;
+    int orders = 0;
+    long long wallTimeMicros = 0;
+};
+
+/** runs one independent simulation per dataset file on a work-stealing thread pool */
+class BatchRunner
+{
+    public:
+        /** threads 0 uses one worker per hardware thread
+         * each run writes its logs to outputDirectory/<dataset file name>/, or to outputDirectory/<run number>-<dataset file name>/
+         * when several dataset files share a name */
+        BatchRunner(std::vector<std::string> _datasetFiles, std::string _outputDirectory, int _threads = 0);
+
+        /** run every simulation and return the results in dataset order */
+        std::vector<BatchRunResult> run();
+
+        /** write the combined summary as CSV */
+        static void writeSummary(std::vector<BatchRunResult> const& results, std::ostream& out);
+
+    private:
+        /** run one simulation with its own bot, assets and logs */
+        static BatchRunResult runOne(std::string const& datasetFile, std::string const& outputDirectory);
+
+        std::vector<std::string> datasetFiles;
+        std::string outputDirectory;
+        int threads;
+};
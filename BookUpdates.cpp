@@ -0,0 +1,269 @@
+#include "BookUpdates.h"
+#include "VarintCoding.h"
+#include <stdexcept>
+#include <sstream>
+
+static const char updateMagic[] = "MerkelUpdates";
+static const unsigned char updateVersion = 1;
+
+SnapshotDiffer::SnapshotDiffer()
+{
+
+}
+
+/** the updates from the last snapshot to this one */
+void SnapshotDiffer::diff(std::vector<OrderBookEntry> const& snapshot, std::vector<LevelUpdate>& updates)
+{
+    updates.clear();
+    current.clear();
+    arrivals.clear();
+    for (OrderBookEntry const& order : snapshot)
+    {
+        if (order.orderType != OrderBookType::bid && order.orderType != OrderBookType::ask)
+        {
+            continue;
+        }
+        int key = productId(order.product) * 2 + (order.orderType == OrderBookType::ask ? 1 : 0);
+        auto level = current[key].emplace(order.price, order.amount);
+        if (level.second)
+        {
+            arrivals.push_back(std::make_pair(key, order.price));
+        }
+        else
+        {
+            level.first->second += order.amount;
+        }
+    }
+
+    // levels of the last snapshot that are gone or changed
+    for (auto const& side : previous)
+    {
+        auto now = current.find(side.first);
+        for (auto const& level : side.second)
+        {
+            LevelUpdate update{LevelUpdateType::remove, side.first / 2, side.first % 2 ? OrderBookType::ask : OrderBookType::bid,
+                               level.first, Decimal{}};
+            if (now == current.end() || now->second.count(level.first) == 0)
+            {
+                updates.push_back(update);
+                continue;
+            }
+            Decimal amount = now->second.at(level.first);
+            if (amount != level.second)
+            {
+                update.type = LevelUpdateType::modify;
+                update.amount = amount;
+                updates.push_back(update);
+            }
+        }
+    }
+
+    // new levels as they arrived
+    for (auto const& arrival : arrivals)
+    {
+        auto before = previous.find(arrival.first);
+        if (before == previous.end() || before->second.count(arrival.second) == 0)
+        {
+            updates.push_back(LevelUpdate{LevelUpdateType::add, arrival.first / 2,
+                                          arrival.first % 2 ? OrderBookType::ask : OrderBookType::bid,
+                                          arrival.second, current[arrival.first][arrival.second]});
+        }
+    }
+    previous.swap(current);
+}
+
+/** forget the last snapshot */
+void SnapshotDiffer::reset()
+{
+    previous.clear();
+}
+
+int SnapshotDiffer::productId(std::string const& product)
+{
+    auto it = productIds.find(product);
+    if (it != productIds.end())
+    {
+        return it->second;
+    }
+    productNames.push_back(product);
+    productIds[product] = productNames.size() - 1;
+    return productNames.size() - 1;
+}
+
+std::string const& SnapshotDiffer::productName(int product) const
+{
+    return productNames[product];
+}
+
+size_t SnapshotDiffer::levelCount() const
+{
+    size_t total = 0;
+    for (auto const& side : previous)
+    {
+        total += side.second.size();
+    }
+    return total;
+}
+
+UpdateStreamWriter::UpdateStreamWriter(std::string const& path)
+: file(path, std::ios::binary | std::ios::trunc)
+{
+    if (!file)
+    {
+        throw std::runtime_error{"UpdateStreamWriter cannot create " + path};
+    }
+    buffer.append(updateMagic, sizeof(updateMagic) - 1);
+    buffer.push_back(updateVersion);
+}
+
+/** write a tick and its updates */
+void UpdateStreamWriter::writeTick(std::string const& timestamp, std::vector<LevelUpdate> const& updates, SnapshotDiffer const& differ)
+{
+    buffer.push_back((char)UpdateRecordType::tick);
+    buffer.push_back((char)timestamp.size());
+    buffer.append(timestamp);
+    for (LevelUpdate const& update : updates)
+    {
+        if ((size_t)update.product >= announced.size())
+        {
+            announced.resize(update.product + 1, false);
+        }
+        if (!announced[update.product])
+        {
+            std::string const& name = differ.productName(update.product);
+            buffer.push_back((char)UpdateRecordType::product);
+            encodeVarint(buffer, update.product);
+            encodeVarint(buffer, name.size());
+            buffer.append(name);
+            announced[update.product] = true;
+        }
+        int side = update.side == OrderBookType::ask ? 1 : 0;
+        long long& last = lastPrice[update.product * 2 + side];
+        buffer.push_back((char)(uint8_t)update.type + (char)UpdateRecordType::add - (char)LevelUpdateType::add);
+        encodeVarint(buffer, update.product);
+        buffer.push_back((char)side);
+        encodeVarint(buffer, zigzag(update.price.units() - last));
+        last = update.price.units();
+        if (update.type != LevelUpdateType::remove)
+        {
+            encodeVarint(buffer, update.amount.units());
+        }
+    }
+    file.write(buffer.data(), buffer.size());
+    written += buffer.size();
+    buffer.clear();
+}
+
+long long UpdateStreamWriter::size() const
+{
+    return written + buffer.size();
+}
+
+UpdateStreamReader::UpdateStreamReader(std::string const& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        throw std::runtime_error{"UpdateStreamReader cannot open " + path};
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    data = contents.str();
+    size_t header = sizeof(updateMagic) - 1;
+    if (data.size() < header + 1 || data.compare(0, header, updateMagic) != 0 || (unsigned char)data[header] != updateVersion)
+    {
+        throw std::runtime_error{"UpdateStreamReader " + path + " is not an update stream"};
+    }
+    position = header + 1;
+}
+
+unsigned char UpdateStreamReader::readByte()
+{
+    if (position >= data.size())
+    {
+        throw std::runtime_error{"UpdateStreamReader truncated update stream"};
+    }
+    return data[position++];
+}
+
+uint64_t UpdateStreamReader::readVarint()
+{
+    uint64_t value;
+    if (!decodeVarint(data, position, value))
+    {
+        throw std::runtime_error{position >= data.size() ? "UpdateStreamReader truncated update stream"
+                                                         : "UpdateStreamReader bad number in update stream"};
+    }
+    return value;
+}
+
+/** the next tick and its updates, false at the end of the stream */
+bool UpdateStreamReader::nextTick(std::string& timestamp, std::vector<LevelUpdate>& updates)
+{
+    updates.clear();
+    if (position >= data.size())
+    {
+        return false;
+    }
+    if (readByte() != (unsigned char)UpdateRecordType::tick)
+    {
+        throw std::runtime_error{"UpdateStreamReader expected a tick record"};
+    }
+    size_t length = readByte();
+    if (position + length > data.size())
+    {
+        throw std::runtime_error{"UpdateStreamReader truncated update stream"};
+    }
+    timestamp = data.substr(position, length);
+    position += length;
+
+    while (position < data.size() && (unsigned char)data[position] != (unsigned char)UpdateRecordType::tick)
+    {
+        UpdateRecordType type = (UpdateRecordType)readByte();
+        if (type == UpdateRecordType::product)
+        {
+            size_t id = readVarint();
+            size_t nameLength = readVarint();
+            if (position + nameLength > data.size())
+            {
+                throw std::runtime_error{"UpdateStreamReader truncated update stream"};
+            }
+            if (id >= productNames.size())
+            {
+                productNames.resize(id + 1);
+            }
+            productNames[id] = data.substr(position, nameLength);
+            position += nameLength;
+            continue;
+        }
+        if (type != UpdateRecordType::add && type != UpdateRecordType::modify && type != UpdateRecordType::remove)
+        {
+            throw std::runtime_error{"UpdateStreamReader unknown record type " + std::to_string((int)type)};
+        }
+        LevelUpdate update;
+        update.type = (LevelUpdateType)((uint8_t)type - (uint8_t)UpdateRecordType::add + (uint8_t)LevelUpdateType::add);
+        update.product = readVarint();
+        int side = readByte();
+        update.side = side ? OrderBookType::ask : OrderBookType::bid;
+        if ((size_t)update.product >= productNames.size())
+        {
+            throw std::runtime_error{"UpdateStreamReader update of an unknown product"};
+        }
+        long long& last = lastPrice[update.product * 2 + side];
+        last += unzigzag(readVarint());
+        update.price = Decimal::fromUnits(last);
+        update.amount = update.type == LevelUpdateType::remove ? Decimal{} : Decimal::fromUnits(readVarint());
+        updates.push_back(update);
+    }
+    return true;
+}
+
+std::string const& UpdateStreamReader::productName(int product) const
+{
+    return productNames[product];
+}
+
+size_t UpdateStreamReader::productCount() const
+{
+    return productNames.size();
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdint>
+
+/** what happened to a price level between two snapshots */
+enum class LevelUpdateType : uint8_t {add = 1, modify, remove};
+
+/** one change of a price level, the amount is the new total of the level, 0 for a removal */
+struct LevelUpdate
+{
+    LevelUpdateType type;
+    int product;
+    OrderBookType side;
+    Decimal price;
+    Decimal amount;
+};
+
+/** turns the full book snapshots of consecutive ticks into price level updates
+ * the orders of a snapshot are summed per product, side and price; levels that are gone are removed,
+ * levels with another amount are modified and new levels are added, a product missing from a snapshot
+ * loses all of its levels; removals and modifications come first, in product, side and price order,
+ * then the additions in the order their levels first appear in the snapshot, as the orders arrived */
+class SnapshotDiffer
+{
+    public:
+        SnapshotDiffer();
+
+        /** the updates from the last snapshot to this one, the first snapshot is all additions */
+        void diff(std::vector<OrderBookEntry> const& snapshot, std::vector<LevelUpdate>& updates);
+
+        /** forget the last snapshot, the next one is all additions again */
+        void reset();
+
+        /** ID of a product, added on first use */
+        int productId(std::string const& product);
+
+        std::string const& productName(int product) const;
+
+        /** levels on both sides of all products in the last snapshot */
+        size_t levelCount() const;
+
+    private:
+        // levels of every product and side by price, keyed by product ID * 2 + 1 for asks
+        typedef std::map<int, std::map<Decimal, Decimal>> Levels;
+        Levels previous;
+        Levels current;
+        // levels of the snapshot being diffed in the order they first appear
+        std::vector<std::pair<int, Decimal>> arrivals;
+
+        std::vector<std::string> productNames;
+        std::map<std::string, int> productIds;
+};
+
+/** kinds of records of an update stream */
+enum class UpdateRecordType : uint8_t {tick = 1, product, add, modify, remove};
+
+/** writes level updates to a compact binary file, one tick after the other
+ *
+ * file layout, numbers are LEB128 varints unless stated otherwise:
+ *   header   "MerkelUpdates" and a version byte
+ *   tick     type, timestamp length (1 byte) and text, then the updates of the tick
+ *   product  type, ID, name length and name, the first time a product is updated
+ *   update   type (add, modify or remove), product ID, side (1 byte, 0 bid, 1 ask),
+ *            price as the zigzag difference to the last price written for the product and side, in units of 1e-8,
+ *            and for add and modify the amount of the level in units of 1e-8 */
+class UpdateStreamWriter
+{
+    public:
+        /** throws std::runtime_error if the file cannot be created */
+        UpdateStreamWriter(std::string const& path);
+
+        UpdateStreamWriter(UpdateStreamWriter const&) = delete;
+        UpdateStreamWriter& operator=(UpdateStreamWriter const&) = delete;
+
+        /** write a tick and its updates, product IDs are those of the differ that made them */
+        void writeTick(std::string const& timestamp, std::vector<LevelUpdate> const& updates, SnapshotDiffer const& differ);
+
+        /** bytes written so far */
+        long long size() const;
+
+    private:
+        std::ofstream file;
+        std::string buffer;
+        long long written = 0;
+        std::vector<bool> announced;
+        std::map<int, long long> lastPrice;
+};
+
+/** reads an update stream back tick by tick */
+class UpdateStreamReader
+{
+    public:
+        /** throws std::runtime_error if the file cannot be read or is not an update stream */
+        UpdateStreamReader(std::string const& path);
+
+        /** the next tick and its updates, false at the end of the stream, throws std::runtime_error on a damaged file */
+        bool nextTick(std::string& timestamp, std::vector<LevelUpdate>& updates);
+
+        /** name of a product announced so far */
+        std::string const& productName(int product) const;
+
+        size_t productCount() const;
+
+    private:
+        uint64_t readVarint();
+        unsigned char readByte();
+
+        std::string data;
+        size_t position = 0;
+        std::vector<std::string> productNames;
+        std::map<int, long long> lastPrice;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+#include <map>
+#include <vector>
+#include "PredictionEngine.h"
+
+/** strategy constants of the bot, the defaults are the values the bot was tuned with */
+struct BotParameters
+{
+    // number of most recent prices used by the linear regression
+    int regressionWindow = 14;
+    // number of periods ahead the regression predicts
+    int predictionHorizon = 7;
+    // forecasting models run next to the regression, which is always model 0, the others follow from ID 1
+    // none by default, the regression is the only model the strategy trades on unless it is blended with others
+    std::vector<ForecastSpec> predictionModels;
+    // model IDs and weights the traded prediction is combined from
+    std::vector<std::pair<int, double>> predictionBlend = {{0, 1}};
+    // share of the initial balance used as the standard order amount
+    double standardOrderFraction = 0.05;
+    // initial balance of each currency
+    std::map<std::string, double> initialFunds = {{"BTC", 10},
+                                                  {"ETH", 500},
+                                                  {"USDT", 50000},
+                                                  {"DOGE", 10000000}};
+};
@@ -1,4 +1,12 @@
 #include "CSVReader.h"
+#include "TickStream.h"
+#include <filesystem>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
 
 CSVReader::CSVReader()
 {
@@ -53,10 +61,169 @@ OrderBook CSVReader::readCSV(std::string csvFilename)
         ordersData.products.push_back(e.first);
     }
 
+    // number the orders of every product for reuse, the range-query index is built by the queries that need it
+    ordersData.buildVersions();
+
     // return entries;
     return ordersData;
 }
 
+OrderBook CSVReader::readCSVFiles(std::vector<std::string> const& csvFiles)
+{
+    OrderBook ordersData;
+
+    // map of products
+    std::map<std::string,bool> prodMap;
+
+    // parsers run a bounded number of ticks ahead of the merge, which hands back ticks in timestamp order
+    TickStream stream{csvFiles};
+    Tick tick;
+    while (stream.nextTick(tick))
+    {
+        // ticks arrive in order so the insertion always happens at the end of the map
+        auto it = ordersData.ordersByTimestamp.emplace_hint(ordersData.ordersByTimestamp.end(),
+                                                             tick.timestamp,
+                                                             std::vector<OrderBookEntry>{});
+        if (it->second.empty())
+        {
+            it->second = std::move(tick.orders);
+            ordersData.timestamps.push_back(tick.timestamp);
+        }
+        else
+        {
+            it->second.insert(it->second.end(), tick.orders.begin(), tick.orders.end());
+        }
+        for (OrderBookEntry const& obe : it->second)
+        {
+            prodMap[obe.product] = true;
+        }
+    }
+
+    // flatten the map of products to a vector of strings
+    for (auto const& e : prodMap)
+    {
+        ordersData.products.push_back(e.first);
+    }
+
+    // number the orders of every product for reuse, the range-query index is built by the queries that need it
+    ordersData.buildVersions();
+
+    return ordersData;
+}
+
+OrderBook CSVReader::readCSVMapped(std::string csvFilename, std::string fromTimestamp)
+{
+    OrderBook ordersData;
+    std::map<std::string,bool> timestampsMap;
+    std::map<std::string,bool> prodMap;
+
+    int fd = open(csvFilename.c_str(), O_RDONLY);
+    struct stat fileInfo;
+    if (fd < 0 || fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        if (fd >= 0) close(fd);
+        return ordersData;
+    }
+    size_t size = fileInfo.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+    {
+        return ordersData;
+    }
+    const char* data = static_cast<const char*>(mapping);
+
+    // start of the first line at or after position
+    auto lineStart = [data, size](size_t position)
+    {
+        if (position == 0)
+            return position;
+        const void* newline = std::memchr(data + position - 1, '\n', size - position + 1);
+        return newline ? static_cast<const char*>(newline) - data + 1 : size;
+    };
+    // a line belongs to the replay if its timestamp is not earlier than fromTimestamp
+    // lines without a timestamp (blank lines) never stop the search
+    auto isWanted = [data, size, &fromTimestamp](size_t start)
+    {
+        const char* end = static_cast<const char*>(std::memchr(data + start, ',', size - start));
+        if (!end)
+            return true;
+        std::string timestamp(data + start, end - data - start);
+        return timestamp.size() < 19 || timestamp >= fromTimestamp;
+    };
+
+    // binary search over byte offsets for the first wanted line
+    size_t low = 0, high = size;
+    while (!fromTimestamp.empty() && low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        size_t start = lineStart(middle);
+        if (start >= size || isWanted(start))
+            high = middle;
+        else
+            low = middle + 1;
+    }
+
+    std::string line;
+    for (size_t start = lineStart(low); start < size; )
+    {
+        const char* newline = static_cast<const char*>(std::memchr(data + start, '\n', size - start));
+        size_t end = newline ? newline - data : size;
+        line.assign(data + start, end - start);
+        start = end + 1;
+        try
+        {
+            OrderBookEntry obe = stringsToOBE(tokenise(line, ','));
+            ordersData.ordersByTimestamp[obe.timestamp].push_back(obe);
+            prodMap[obe.product] = true;
+            timestampsMap[obe.timestamp] = true;
+        }
+        catch(const std::exception& e)
+        {
+            // skip bad lines, as readCSV does
+        }
+    }
+    munmap(mapping, size);
+
+    // flatten the maps of timestamps and products to vectors of strings
+    for (auto const& e : timestampsMap)
+    {
+        ordersData.timestamps.push_back(e.first);
+    }
+    for (auto const& e : prodMap)
+    {
+        ordersData.products.push_back(e.first);
+    }
+
+    // number the orders of every product for reuse, the range-query index is built by the queries that need it
+    ordersData.buildVersions();
+
+    return ordersData;
+}
+
+std::vector<std::string> CSVReader::listDatasetFiles(std::string path)
+{
+    std::vector<std::string> files;
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error))
+    {
+        for (auto const& entry : std::filesystem::directory_iterator(path, error))
+        {
+            if (entry.is_regular_file(error) && entry.path().extension() == ".csv")
+            {
+                files.push_back(entry.path().string());
+            }
+        }
+        // one file per day, so sorting by name keeps the days in order
+        std::sort(files.begin(), files.end());
+    }
+    else
+    {
+        files.push_back(path);
+    }
+    return files;
+}
+
 std::vector<std::string> CSVReader::tokenise(std::string csvLine, char separator)
 {
     std::vector<std::string> tokens;
@@ -79,7 +246,7 @@ std::vector<std::string> CSVReader::tokenise(std::string csvLine, char separator
 
 OrderBookEntry CSVReader::stringsToOBE(std::vector<std::string> tokens)
 {
-    double price, amount;
+    Decimal price, amount;
     if (tokens.size() != 5)
     {
         // std::cout << "Bad line" << std::endl;
@@ -87,8 +254,9 @@ OrderBookEntry CSVReader::stringsToOBE(std::vector<std::string> tokens)
     }
     try
     {
-        price = std::stod(tokens[3]);
-        amount = std::stod(tokens[4]);
+        // parsed straight from the text, exact to 8 decimals
+        price = Decimal::parse(tokens[3]);
+        amount = Decimal::parse(tokens[4]);
     }
     catch(const std::exception& e)
     {
@@ -111,11 +279,11 @@ OrderBookEntry CSVReader::stringsToOBE(std::string priceString,
                                        std::string product,
                                        OrderBookType orderType)
 {
-    double price, amount;
+    Decimal price, amount;
     try
     {
-        price = std::stod(priceString);
-        amount = std::stod(amountString);
+        price = Decimal::parse(priceString);
+        amount = Decimal::parse(amountString);
     }
     catch (const std::exception& e)
     {
@@ -18,6 +18,19 @@ class CSVReader
         * 2020/03/17 17:01:24.884492,ETH/BTC,bid,0.02187305,6.85567013
         */
         OrderBook readCSV(std::string csvFile);
+
+        /** read several CSV files, each parsed on its own thread
+         * and merged by timestamp into one order book */
+        OrderBook readCSVFiles(std::vector<std::string> const& csvFiles);
+
+        /** read a CSV file through a memory map, starting at the first line with a timestamp >= fromTimestamp
+        * lines before it are found by binary search and never parsed, the file must be sorted by timestamp */
+        OrderBook readCSVMapped(std::string csvFile, std::string fromTimestamp = "");
+
+        /** expand a path to the dataset files it holds:
+         * a directory gives its .csv files sorted by name, a file gives itself */
+        static std::vector<std::string> listDatasetFiles(std::string path);
+
         static std::vector<std::string> tokenise(std::string csvLine, char separator);
         static OrderBookEntry stringsToOBE(std::string priceString,
                                            std::string amountString,
@@ -26,6 +39,8 @@ class CSVReader
                                            OrderBookType orderType);
 
     private:
+        // the tick stream parses lines on its own threads
+        friend class TickStream;
         static OrderBookEntry stringsToOBE(std::vector<std::string> tokens);
 
 };
\ No newline at end of file
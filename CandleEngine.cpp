@@ -0,0 +1,278 @@
+#include "CandleEngine.h"
+#include "OrderBookEntry.h"
+#include <ostream>
+#include <stdexcept>
+
+double Candle::vwap() const
+{
+    if (volume == 0)
+    {
+        return 0;
+    }
+    return turnover / volume;
+}
+
+CandleSeries::CandleSeries(long long _resolution, int _capacity)
+: resolution(_resolution),
+  bars(_capacity)
+{
+
+}
+
+/** return the bar for the bucket that contains time, opening it if needed */
+Candle& CandleSeries::barFor(long long time, double price)
+{
+    long long bucket = time - time % resolution;
+    if (count > 0)
+    {
+        Candle& current = bars[(head + count - 1) % bars.size()];
+        // ticks arrive in time order, anything older than the current bar is folded into it
+        if (bucket <= current.startTime)
+        {
+            return current;
+        }
+    }
+
+    // open a new bar, overwriting the oldest one when the buffer is full
+    if (count < (int)bars.size())
+    {
+        ++count;
+    }
+    else
+    {
+        head = (head + 1) % bars.size();
+    }
+    Candle& bar = bars[(head + count - 1) % bars.size()];
+    bar = Candle{};
+    bar.startTime = bucket;
+    bar.open = bar.high = bar.low = bar.close = price;
+    return bar;
+}
+
+/** record a mid price observation, opening a new bar when the bucket changes */
+void CandleSeries::addPrice(long long time, double price)
+{
+    Candle& bar = barFor(time, price);
+    if (price > bar.high) bar.high = price;
+    if (price < bar.low) bar.low = price;
+    bar.close = price;
+}
+
+/** record a fill, opening a new bar when the bucket changes */
+void CandleSeries::addTrade(long long time, double price, double amount)
+{
+    Candle& bar = barFor(time, price);
+    bar.volume += amount;
+    bar.turnover += price * amount;
+    bar.tradeCount++;
+}
+
+int CandleSeries::size() const
+{
+    return count;
+}
+
+const Candle& CandleSeries::at(int index) const
+{
+    if (index < 0 || index >= count)
+    {
+        throw std::out_of_range{"CandleSeries::at"};
+    }
+    return bars[(head + index) % bars.size()];
+}
+
+const Candle& CandleSeries::back() const
+{
+    return at(count - 1);
+}
+
+/** stored bars for a checkpoint, oldest first */
+void CandleSeries::save(BinaryWriter& out) const
+{
+    out.writeInt(count);
+    for (int i = 0; i < count; ++i)
+    {
+        const Candle& c = at(i);
+        out.writeInt(c.startTime);
+        out.writeDouble(c.open);
+        out.writeDouble(c.high);
+        out.writeDouble(c.low);
+        out.writeDouble(c.close);
+        out.writeDouble(c.volume);
+        out.writeDouble(c.turnover);
+        out.writeInt(c.tradeCount);
+    }
+}
+
+/** bars written by save, the oldest ones are dropped if they no longer fit */
+void CandleSeries::restore(BinaryReader& in)
+{
+    head = 0;
+    count = 0;
+    long long stored = in.readInt();
+    for (long long i = 0; i < stored; ++i)
+    {
+        Candle c;
+        c.startTime = in.readInt();
+        c.open = in.readDouble();
+        c.high = in.readDouble();
+        c.low = in.readDouble();
+        c.close = in.readDouble();
+        c.volume = in.readDouble();
+        c.turnover = in.readDouble();
+        c.tradeCount = in.readInt();
+        if (count < (int)bars.size())
+        {
+            ++count;
+        }
+        else
+        {
+            head = (head + 1) % bars.size();
+        }
+        bars[(head + count - 1) % bars.size()] = c;
+    }
+}
+
+CandleEngine::CandleEngine(std::vector<int> resolutionsSeconds, int _capacity)
+: resolutions(resolutionsSeconds),
+  capacity(_capacity)
+{
+
+}
+
+/** create the series for a product on first use */
+std::vector<CandleSeries>& CandleEngine::seriesFor(std::string const& product)
+{
+    std::vector<CandleSeries>& productSeries = series[product];
+    if (productSeries.empty())
+    {
+        for (int r : resolutions)
+        {
+            productSeries.emplace_back((long long)r * 1000000, capacity);
+        }
+    }
+    return productSeries;
+}
+
+/** all products of a tick share the timestamp so the parsed value is cached */
+long long CandleEngine::parseTime(std::string const& timestamp)
+{
+    if (timestamp != lastTimestamp)
+    {
+        lastTime = OrderBookEntry::timestampToMicros(timestamp);
+        lastTimestamp = timestamp;
+    }
+    return lastTime;
+}
+
+/** feed a top-of-book observation for a product */
+void CandleEngine::onQuote(std::string const& product, std::string const& timestamp, double midPrice)
+{
+    long long time = parseTime(timestamp);
+    for (CandleSeries& s : seriesFor(product))
+    {
+        s.addPrice(time, midPrice);
+    }
+}
+
+/** feed an executed sale for a product */
+void CandleEngine::onTrade(std::string const& product, std::string const& timestamp, double price, double amount)
+{
+    long long time = parseTime(timestamp);
+    for (CandleSeries& s : seriesFor(product))
+    {
+        s.addTrade(time, price, amount);
+    }
+}
+
+/** series for a product at a resolution in seconds, throws if it does not exist */
+const CandleSeries& CandleEngine::getSeries(std::string const& product, int resolutionSeconds) const
+{
+    const CandleSeries* s = findSeries(product, resolutionSeconds);
+    if (!s)
+    {
+        throw std::out_of_range{"CandleEngine::getSeries unknown product or resolution"};
+    }
+    return *s;
+}
+
+/** series for a product at a resolution in seconds, null if it does not exist */
+const CandleSeries* CandleEngine::findSeries(std::string const& product, int resolutionSeconds) const
+{
+    auto it = series.find(product);
+    if (it != series.end())
+    {
+        for (const CandleSeries& s : it->second)
+        {
+            if (s.resolution == (long long)resolutionSeconds * 1000000)
+            {
+                return &s;
+            }
+        }
+    }
+    return nullptr;
+}
+
+const std::vector<int>& CandleEngine::getResolutions() const
+{
+    return resolutions;
+}
+
+/** resolutions and bars of every series for a checkpoint */
+void CandleEngine::save(BinaryWriter& out) const
+{
+    out.writeInt(resolutions.size());
+    for (int r : resolutions)
+    {
+        out.writeInt(r);
+    }
+    out.writeInt(capacity);
+    out.writeInt(series.size());
+    for (auto const& e : series)
+    {
+        out.writeString(e.first);
+        for (const CandleSeries& s : e.second)
+        {
+            s.save(out);
+        }
+    }
+}
+
+/** the state written by save replaces the configured resolutions and all bars */
+void CandleEngine::restore(BinaryReader& in)
+{
+    resolutions.clear();
+    long long resolutionCount = in.readInt();
+    for (long long i = 0; i < resolutionCount; ++i)
+    {
+        resolutions.push_back(in.readInt());
+    }
+    capacity = in.readInt();
+    series.clear();
+    lastTimestamp.clear();
+    long long productCount = in.readInt();
+    for (long long i = 0; i < productCount; ++i)
+    {
+        for (CandleSeries& s : seriesFor(in.readString()))
+        {
+            s.restore(in);
+        }
+    }
+}
+
+/** write all the stored bars for a resolution as CSV */
+void CandleEngine::logCandles(std::ostream& logFile, int resolutionSeconds) const
+{
+    logFile << "Product,Start_Time_Micros,Open,High,Low,Close,Volume,VWAP,Trades" << std::endl;
+    for (auto const& e : series)
+    {
+        const CandleSeries& s = getSeries(e.first, resolutionSeconds);
+        for (int i = 0; i < s.size(); ++i)
+        {
+            const Candle& c = s.at(i);
+            logFile << e.first << "," << c.startTime << ",";
+            logFile << c.open << "," << c.high << "," << c.low << "," << c.close << ",";
+            logFile << c.volume << "," << c.vwap() << "," << c.tradeCount << std::endl;
+        }
+    }
+}
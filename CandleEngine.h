@@ -0,0 +1,106 @@
+#pragma once
+#include "Checkpoint.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+/** one OHLCV bar: prices come from the top-of-book mid, volume and VWAP from fills */
+struct Candle
+{
+    // start of the bar in microseconds since epoch
+    long long startTime = 0;
+    double open = 0;
+    double high = 0;
+    double low = 0;
+    double close = 0;
+    // traded amount and traded value (price * amount) within the bar
+    double volume = 0;
+    double turnover = 0;
+    int tradeCount = 0;
+
+    /** volume weighted average price of the fills in the bar, 0 if nothing traded */
+    double vwap() const;
+};
+
+/** fixed capacity ring buffer of candles for one product and one resolution */
+class CandleSeries
+{
+    public:
+        CandleSeries(long long _resolution, int _capacity);
+
+        /** record a mid price observation, opening a new bar when the bucket changes */
+        void addPrice(long long time, double price);
+
+        /** record a fill, opening a new bar when the bucket changes */
+        void addTrade(long long time, double price, double amount);
+
+        /** number of bars currently stored (at most the capacity) */
+        int size() const;
+
+        /** bar by position, 0 being the oldest stored bar */
+        const Candle& at(int index) const;
+
+        /** most recent bar, the one still being built */
+        const Candle& back() const;
+
+        /** stored bars for a checkpoint, restored with restore */
+        void save(BinaryWriter& out) const;
+        void restore(BinaryReader& in);
+
+        long long resolution;
+
+    private:
+        /** return the bar for the bucket that contains time, opening it if needed */
+        Candle& barFor(long long time, double price);
+
+        // contiguous storage, oldest bar is overwritten once the buffer is full
+        std::vector<Candle> bars;
+        int head = 0;
+        int count = 0;
+};
+
+/** streaming aggregation of ticks into candles for several resolutions per product */
+class CandleEngine
+{
+    public:
+        /** resolutions are given in seconds, capacity is the number of bars kept per series */
+        CandleEngine(std::vector<int> resolutionsSeconds = {5, 60, 300}, int capacity = 4096);
+
+        /** feed a top-of-book observation for a product */
+        void onQuote(std::string const& product, std::string const& timestamp, double midPrice);
+
+        /** feed an executed sale for a product */
+        void onTrade(std::string const& product, std::string const& timestamp, double price, double amount);
+
+        /** series for a product at a resolution in seconds, throws if it does not exist */
+        const CandleSeries& getSeries(std::string const& product, int resolutionSeconds) const;
+
+        /** series for a product at a resolution in seconds, null if it does not exist */
+        const CandleSeries* findSeries(std::string const& product, int resolutionSeconds) const;
+
+        /** resolutions in seconds, in the order they were configured */
+        const std::vector<int>& getResolutions() const;
+
+        /** resolutions and bars of every series for a checkpoint, restored with restore */
+        void save(BinaryWriter& out) const;
+        void restore(BinaryReader& in);
+
+        /** write all the stored bars for a resolution as CSV */
+        void logCandles(std::ostream& logFile, int resolutionSeconds) const;
+
+    private:
+        /** create the series for a product on first use */
+        std::vector<CandleSeries>& seriesFor(std::string const& product);
+
+        std::vector<int> resolutions;
+        int capacity;
+
+        // series per product, one entry per configured resolution
+        std::map<std::string, std::vector<CandleSeries>> series;
+
+        /** all products of a tick share the timestamp so the parsed value is cached */
+        long long parseTime(std::string const& timestamp);
+        std::string lastTimestamp;
+        long long lastTime = 0;
+};
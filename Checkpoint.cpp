@@ -0,0 +1,210 @@
+#include "Checkpoint.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <iostream>
+#include <cerrno>
+
+BinaryWriter::BinaryWriter()
+{
+
+}
+
+void BinaryWriter::writeInt(long long value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void BinaryWriter::writeDouble(double value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void BinaryWriter::writeString(std::string const& value)
+{
+    writeInt(value.size());
+    buffer.append(value);
+}
+
+void BinaryWriter::writeMap(std::map<std::string, double> const& values)
+{
+    writeInt(values.size());
+    for (auto const& e : values)
+    {
+        writeString(e.first);
+        writeDouble(e.second);
+    }
+}
+
+void BinaryWriter::writeOrder(OrderBookEntry const& order)
+{
+    writeInt(order.price.units());
+    writeInt(order.amount.units());
+    writeString(order.timestamp);
+    writeString(order.product);
+    writeInt((long long)order.orderType);
+    writeDouble(order.priceDifference);
+    writeString(order.username);
+    writeString(order.orderStatus);
+    writeString(order.orderID);
+}
+
+BinaryReader::BinaryReader(std::string const& _buffer)
+: data(_buffer.data()),
+  size(_buffer.size())
+{
+
+}
+
+BinaryReader::BinaryReader(const char* _data, size_t _size)
+: data(_data),
+  size(_size)
+{
+
+}
+
+/** copy the next count bytes, throws when the buffer is too short */
+void BinaryReader::read(void* destination, size_t count)
+{
+    if (position + count > size)
+    {
+        throw std::runtime_error{"BinaryReader::read truncated input"};
+    }
+    std::memcpy(destination, data + position, count);
+    position += count;
+}
+
+long long BinaryReader::readInt()
+{
+    long long value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+double BinaryReader::readDouble()
+{
+    double value;
+    read(&value, sizeof(value));
+    return value;
+}
+
+std::string BinaryReader::readString()
+{
+    long long length = readInt();
+    if (length < 0 || position + length > size)
+    {
+        throw std::runtime_error{"BinaryReader::readString truncated input"};
+    }
+    std::string value{data + position, (size_t)length};
+    position += length;
+    return value;
+}
+
+std::map<std::string, double> BinaryReader::readMap()
+{
+    std::map<std::string, double> values;
+    long long count = readInt();
+    for (long long i = 0; i < count; ++i)
+    {
+        std::string key = readString();
+        values[key] = readDouble();
+    }
+    return values;
+}
+
+OrderBookEntry BinaryReader::readOrder()
+{
+    Decimal price = Decimal::fromUnits(readInt());
+    Decimal amount = Decimal::fromUnits(readInt());
+    std::string timestamp = readString();
+    std::string product = readString();
+    OrderBookType orderType = (OrderBookType)readInt();
+    OrderBookEntry order{price, amount, timestamp, product, orderType};
+    order.priceDifference = readDouble();
+    order.username = readString();
+    order.orderStatus = readString();
+    order.orderID = readString();
+    return order;
+}
+
+CheckpointWriter::CheckpointWriter(std::string _path)
+: path(_path)
+{
+    writer = std::thread([this]() { run(); });
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+/** queue a serialized checkpoint for writing */
+void CheckpointWriter::submit(std::string bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(bytes);
+        hasPending = true;
+    }
+    changed.notify_all();
+}
+
+/** writer loop, the file is replaced atomically through a temporary file */
+void CheckpointWriter::run()
+{
+    while (true)
+    {
+        std::string bytes;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this]() { return hasPending || stopping; });
+            if (!hasPending)
+            {
+                return;
+            }
+            bytes = std::move(pending);
+            hasPending = false;
+        }
+
+        // the previous checkpoint is only replaced by a completely written one,
+        // a crash or a failed write (e.g. a full disk) leaves it in place
+        std::string temporaryPath = path + ".tmp";
+        std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+        file.write(bytes.data(), bytes.size());
+        file.flush();
+        bool written = file.good();
+        file.close();
+        if (!written || file.fail())
+        {
+            std::cout << "CheckpointWriter::run cannot write " << temporaryPath << ", the previous checkpoint is kept" << std::endl;
+            std::remove(temporaryPath.c_str());
+            continue;
+        }
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::cout << "CheckpointWriter::run cannot replace " << path << ": " << std::strerror(errno) << std::endl;
+            std::remove(temporaryPath.c_str());
+        }
+    }
+}
+
+/** read a checkpoint file, returns false if it does not exist */
+bool CheckpointWriter::load(std::string const& path, std::string& bytes)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    bytes = contents.str();
+    return true;
+}
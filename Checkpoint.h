@@ -0,0 +1,78 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/** appends values to a byte buffer in a compact binary layout */
+class BinaryWriter
+{
+    public:
+        BinaryWriter();
+
+        void writeInt(long long value);
+        void writeDouble(double value);
+        void writeString(std::string const& value);
+        void writeMap(std::map<std::string, double> const& values);
+        void writeOrder(OrderBookEntry const& order);
+
+        /** the bytes written so far */
+        std::string buffer;
+};
+
+/** reads values back in the order they were written, throws on truncated input */
+class BinaryReader
+{
+    public:
+        BinaryReader(std::string const& _buffer);
+        /** read from memory owned by the caller, e.g. a frame inside a receive buffer, without copying it */
+        BinaryReader(const char* _data, size_t _size);
+
+        long long readInt();
+        double readDouble();
+        std::string readString();
+        std::map<std::string, double> readMap();
+        OrderBookEntry readOrder();
+
+    private:
+        /** copy the next count bytes, throws when the buffer is too short */
+        void read(void* destination, size_t count);
+
+        const char* data;
+        size_t size;
+        size_t position = 0;
+};
+
+/** writes checkpoints on a background thread so the simulation never waits for the disk
+ * only the latest pending checkpoint is kept if the writer falls behind */
+class CheckpointWriter
+{
+    public:
+        CheckpointWriter(std::string _path);
+        /** writes the last pending checkpoint before returning */
+        ~CheckpointWriter();
+
+        CheckpointWriter(CheckpointWriter const&) = delete;
+        CheckpointWriter& operator=(CheckpointWriter const&) = delete;
+
+        /** queue a serialized checkpoint for writing */
+        void submit(std::string bytes);
+
+        /** read a checkpoint file, returns false if it does not exist */
+        static bool load(std::string const& path, std::string& bytes);
+
+    private:
+        /** writer loop, the file is replaced atomically through a temporary file */
+        void run();
+
+        std::string path;
+        std::string pending;
+        bool hasPending = false;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::thread writer;
+};
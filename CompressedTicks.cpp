@@ -0,0 +1,339 @@
+#include "CompressedTicks.h"
+#include "VarintCoding.h"
+#include <algorithm>
+
+BitPackedStream::BitPackedStream()
+{
+
+}
+
+void BitPackedStream::push(uint64_t value)
+{
+    pending.push_back(value);
+    count++;
+    if (pending.size() == blockSize)
+    {
+        packBlock();
+    }
+}
+
+/** pack the values still buffered, the last block is padded with zeros */
+void BitPackedStream::finish()
+{
+    if (!pending.empty())
+    {
+        pending.resize(blockSize, 0);
+        packBlock();
+    }
+}
+
+void BitPackedStream::packBlock()
+{
+    uint64_t all = 0;
+    for (uint64_t value : pending)
+    {
+        all |= value;
+    }
+    int width = 0;
+    while (width < 64 && (all >> width) != 0)
+    {
+        ++width;
+    }
+    widths.push_back(width);
+
+    // 128 values of width bits fill exactly 2 * width words
+    size_t base = words.size();
+    words.resize(base + 2 * width, 0);
+    for (size_t j = 0; j < pending.size() && width > 0; ++j)
+    {
+        size_t bit = j * width;
+        size_t index = base + bit / 64;
+        size_t shift = bit % 64;
+        words[index] |= pending[j] << shift;
+        if (shift + width > 64)
+        {
+            words[index + 1] |= pending[j] >> (64 - shift);
+        }
+    }
+    pending.clear();
+}
+
+size_t BitPackedStream::size() const
+{
+    return count;
+}
+
+size_t BitPackedStream::bytes() const
+{
+    return words.size() * sizeof(uint64_t) + widths.size() + pending.size() * sizeof(uint64_t);
+}
+
+BitPackedStream::Reader::Reader(BitPackedStream const* _stream)
+: stream(_stream)
+{
+
+}
+
+uint64_t BitPackedStream::Reader::next()
+{
+    if (position == blockSize)
+    {
+        int width = stream->widths[block];
+        const uint64_t* packed = stream->words.data() + word;
+        uint64_t mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+        for (size_t j = 0; j < blockSize; ++j)
+        {
+            if (width == 0)
+            {
+                values[j] = 0;
+                continue;
+            }
+            size_t bit = j * width;
+            size_t shift = bit % 64;
+            uint64_t value = packed[bit / 64] >> shift;
+            if (shift + width > 64)
+            {
+                value |= packed[bit / 64 + 1] << (64 - shift);
+            }
+            values[j] = value & mask;
+        }
+        word += 2 * width;
+        block++;
+        position = 0;
+    }
+    return values[position++];
+}
+
+void CompressedTickStore::Levels::clear()
+{
+    previous.clear();
+    current.clear();
+}
+
+/** the current tick is done, its levels become the previous ones
+ * a product and side without orders at this tick keeps the levels it had before */
+void CompressedTickStore::Levels::endTick()
+{
+    for (auto& e : current)
+    {
+        if (!e.second.empty())
+        {
+            previous[e.first].swap(e.second);
+            e.second.clear();
+        }
+    }
+}
+
+/** the order at the same position in the previous tick, or the order before it in this tick if the previous tick had fewer */
+std::pair<long long, long long> CompressedTickStore::Levels::reference(std::vector<std::pair<long long, long long>> const& previous,
+                                                                       std::vector<std::pair<long long, long long>> const& current)
+{
+    size_t i = current.size();
+    if (i < previous.size())
+    {
+        return previous[i];
+    }
+    if (i > 0)
+    {
+        return current[i - 1];
+    }
+    return std::make_pair(0LL, 0LL);
+}
+
+CompressedTickStore::CompressedTickStore(size_t _ticksPerSegment)
+: ticksPerSegment(std::max<size_t>(1, _ticksPerSegment))
+{
+
+}
+
+int CompressedTickStore::productId(std::string const& product)
+{
+    auto it = productIds.find(product);
+    if (it != productIds.end())
+    {
+        return it->second;
+    }
+    products.push_back(product);
+    productIds[product] = products.size() - 1;
+    return products.size() - 1;
+}
+
+/** append the orders of the next tick */
+void CompressedTickStore::addTick(std::string const& timestamp, std::vector<OrderBookEntry> const& tickOrders)
+{
+    if (segments.empty() || segments.back().ticks == ticksPerSegment)
+    {
+        finish();
+        segments.emplace_back();
+        segments.back().firstTick = timestamps.size();
+        encoderLevels.clear();
+    }
+    Segment& segment = segments.back();
+    timestamps.push_back(timestamp);
+    segment.ticks++;
+    orders += tickOrders.size();
+
+    // runs of consecutive orders with the same product and side
+    size_t runs = 0;
+    for (size_t i = 0; i < tickOrders.size(); ++i)
+    {
+        if (i == 0 || tickOrders[i].product != tickOrders[i - 1].product || tickOrders[i].orderType != tickOrders[i - 1].orderType)
+        {
+            runs++;
+        }
+    }
+    segment.runCounts.push(runs);
+
+    for (size_t first = 0; first < tickOrders.size();)
+    {
+        size_t last = first + 1;
+        while (last < tickOrders.size() && tickOrders[last].product == tickOrders[first].product
+               && tickOrders[last].orderType == tickOrders[first].orderType)
+        {
+            ++last;
+        }
+        int key = productId(tickOrders[first].product) * 8 + (int)tickOrders[first].orderType;
+        segment.runKeys.push(key);
+        segment.runLengths.push(last - first);
+
+        std::vector<std::pair<long long, long long>> const& previous = encoderLevels.previous[key];
+        std::vector<std::pair<long long, long long>>& current = encoderLevels.current[key];
+        for (size_t i = first; i < last; ++i)
+        {
+            OrderBookEntry const& order = tickOrders[i];
+            std::pair<long long, long long> reference = Levels::reference(previous, current);
+            segment.prices.push(zigzag(order.price.units() - reference.first));
+            segment.amounts.push(zigzag(order.amount.units() - reference.second));
+            segment.orderCounts.push(order.orderCount - 1);
+            current.push_back(std::make_pair(order.price.units(), order.amount.units()));
+        }
+        first = last;
+    }
+    encoderLevels.endTick();
+}
+
+/** pack what is still buffered */
+void CompressedTickStore::finish()
+{
+    if (segments.empty())
+    {
+        return;
+    }
+    Segment& segment = segments.back();
+    segment.runCounts.finish();
+    segment.runKeys.finish();
+    segment.runLengths.finish();
+    segment.prices.finish();
+    segment.amounts.finish();
+    segment.orderCounts.finish();
+}
+
+size_t CompressedTickStore::tickCount() const
+{
+    return timestamps.size();
+}
+
+size_t CompressedTickStore::orderCount() const
+{
+    return orders;
+}
+
+/** memory taken by the packed ticks, their timestamps and the product names */
+size_t CompressedTickStore::bytes() const
+{
+    size_t total = 0;
+    for (Segment const& s : segments)
+    {
+        total += sizeof(Segment) + s.runCounts.bytes() + s.runKeys.bytes() + s.runLengths.bytes()
+               + s.prices.bytes() + s.amounts.bytes() + s.orderCounts.bytes();
+    }
+    for (std::string const& t : timestamps)
+    {
+        total += sizeof(std::string) + t.capacity();
+    }
+    for (std::string const& p : products)
+    {
+        total += sizeof(std::string) + p.capacity();
+    }
+    return total;
+}
+
+/** position of a timestamp, the ticks are in time order */
+long long CompressedTickStore::find(std::string const& timestamp) const
+{
+    auto it = std::lower_bound(timestamps.begin(), timestamps.end(), timestamp);
+    if (it == timestamps.end() || *it != timestamp)
+    {
+        return -1;
+    }
+    return it - timestamps.begin();
+}
+
+/** the orders of a tick, the next tick in sequence is decoded from the last one, any other from the start of its segment */
+std::vector<OrderBookEntry> const& CompressedTickStore::tick(size_t index)
+{
+    if ((long long)index == decodedTick)
+    {
+        return decoded;
+    }
+    size_t segment = index / ticksPerSegment;
+    if (segment != readSegment || (long long)index <= decodedTick || decodedTick < 0)
+    {
+        Segment const& s = segments[segment];
+        readSegment = segment;
+        readTick = s.firstTick;
+        runCountReader = BitPackedStream::Reader{&s.runCounts};
+        runKeyReader = BitPackedStream::Reader{&s.runKeys};
+        runLengthReader = BitPackedStream::Reader{&s.runLengths};
+        priceReader = BitPackedStream::Reader{&s.prices};
+        amountReader = BitPackedStream::Reader{&s.amounts};
+        orderCountReader = BitPackedStream::Reader{&s.orderCounts};
+        decoderLevels.clear();
+    }
+    while (readTick <= index)
+    {
+        decodeNext();
+    }
+    return decoded;
+}
+
+/** decode the next tick of the segment being read into the buffer, the entries of the buffer are reused */
+void CompressedTickStore::decodeNext()
+{
+    std::string const& timestamp = timestamps[readTick];
+    size_t runs = runCountReader.next();
+    size_t n = 0;
+    for (size_t r = 0; r < runs; ++r)
+    {
+        int key = runKeyReader.next();
+        size_t length = runLengthReader.next();
+        std::string const& product = products[key / 8];
+        OrderBookType type = (OrderBookType)(key % 8);
+        std::vector<std::pair<long long, long long>> const& previous = decoderLevels.previous[key];
+        std::vector<std::pair<long long, long long>>& current = decoderLevels.current[key];
+        for (size_t i = 0; i < length; ++i, ++n)
+        {
+            std::pair<long long, long long> reference = Levels::reference(previous, current);
+            long long price = reference.first + unzigzag(priceReader.next());
+            long long amount = reference.second + unzigzag(amountReader.next());
+            int mergedOrders = orderCountReader.next() + 1;
+            current.push_back(std::make_pair(price, amount));
+
+            if (n == decoded.size())
+            {
+                decoded.push_back(OrderBookEntry{Decimal{}, Decimal{}, "", "", OrderBookType::unknown});
+            }
+            OrderBookEntry& order = decoded[n];
+            order.price = Decimal::fromUnits(price);
+            order.amount = Decimal::fromUnits(amount);
+            order.timestamp = timestamp;
+            order.product = product;
+            order.orderType = type;
+            order.orderCount = mergedOrders;
+        }
+    }
+    decoded.erase(decoded.begin() + n, decoded.end());
+    decoderLevels.endTick();
+    decodedTick = readTick;
+    readTick++;
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+/** unsigned values bit-packed in blocks of 128, each block packed with the bit width of its largest value
+ * a block of zeros takes no words at all, a block of values below 16 takes 8 words */
+class BitPackedStream
+{
+    public:
+        static const size_t blockSize = 128;
+
+        BitPackedStream();
+
+        void push(uint64_t value);
+
+        /** pack the values still buffered, called once all values are in */
+        void finish();
+
+        /** number of values pushed */
+        size_t size() const;
+
+        /** memory taken by the packed blocks */
+        size_t bytes() const;
+
+        /** reads the values back in the order they were pushed, one block is unpacked at a time */
+        class Reader
+        {
+            public:
+                Reader(BitPackedStream const* _stream = nullptr);
+                uint64_t next();
+
+            private:
+                BitPackedStream const* stream;
+                size_t block = 0;
+                size_t word = 0;
+                size_t position = blockSize;
+                uint64_t values[blockSize];
+        };
+
+    private:
+        void packBlock();
+
+        std::vector<uint64_t> words;
+        // bit width of every block, block b starts 2 * (sum of the widths before it) words in
+        std::vector<unsigned char> widths;
+        std::vector<uint64_t> pending;
+        size_t count = 0;
+};
+
+/** the dataset orders of all ticks, delta encoded and bit-packed
+ * the i-th order of a product and side at a tick is stored as the difference of its price and amount
+ * to the i-th order of the same product and side at the previous tick that had one, so the levels of
+ * near identical snapshots cost a few bits each; the ticks are grouped in segments that start without
+ * a previous tick, so a tick is decoded from the start of its segment at most, and in sequence one
+ * tick after the other; decoded orders are the same as the loaded ones, field for field */
+class CompressedTickStore
+{
+    public:
+        /** ticks per segment, the most ticks decoded to reach one out of sequence */
+        CompressedTickStore(size_t _ticksPerSegment = 256);
+
+        /** append the orders of the next tick, ticks are added in time order */
+        void addTick(std::string const& timestamp, std::vector<OrderBookEntry> const& orders);
+
+        /** pack what is still buffered, called once all ticks are added */
+        void finish();
+
+        size_t tickCount() const;
+        size_t orderCount() const;
+
+        /** memory taken by the packed ticks, their timestamps and the product names */
+        size_t bytes() const;
+
+        /** position of a timestamp, -1 if there is no tick at it */
+        long long find(std::string const& timestamp) const;
+
+        /** the orders of a tick, valid until the next call */
+        std::vector<OrderBookEntry> const& tick(size_t index);
+
+    private:
+        /** the streams of a run of ticks encoded against each other */
+        struct Segment
+        {
+            size_t firstTick = 0;
+            size_t ticks = 0;
+            // runs of orders with the same product and side per tick, and the key and length of every run
+            BitPackedStream runCounts;
+            BitPackedStream runKeys;
+            BitPackedStream runLengths;
+            // zigzag encoded deltas of the prices and amounts in units of 1e-8, merged dataset orders per entry minus one
+            BitPackedStream prices;
+            BitPackedStream amounts;
+            BitPackedStream orderCounts;
+        };
+
+        /** the orders of the last tick of every product and side, as price and amount units, keyed by product * 8 + side */
+        struct Levels
+        {
+            std::map<int, std::vector<std::pair<long long, long long>>> previous;
+            std::map<int, std::vector<std::pair<long long, long long>>> current;
+
+            void clear();
+            /** the current tick is done, its levels become the previous ones */
+            void endTick();
+            /** what the i-th order of a product and side is encoded against */
+            static std::pair<long long, long long> reference(std::vector<std::pair<long long, long long>> const& previous,
+                                                             std::vector<std::pair<long long, long long>> const& current);
+        };
+
+        int productId(std::string const& product);
+
+        /** decode the next tick of the segment being read into the buffer */
+        void decodeNext();
+
+        size_t ticksPerSegment;
+        std::vector<Segment> segments;
+        std::vector<std::string> timestamps;
+        std::vector<std::string> products;
+        std::map<std::string, int> productIds;
+        size_t orders = 0;
+        Levels encoderLevels;
+
+        // read position: the segment, the next tick in it and the tick in the buffer
+        size_t readSegment = 0;
+        size_t readTick = 0;
+        long long decodedTick = -1;
+        Levels decoderLevels;
+        BitPackedStream::Reader runCountReader;
+        BitPackedStream::Reader runKeyReader;
+        BitPackedStream::Reader runLengthReader;
+        BitPackedStream::Reader priceReader;
+        BitPackedStream::Reader amountReader;
+        BitPackedStream::Reader orderCountReader;
+        std::vector<OrderBookEntry> decoded;
+};
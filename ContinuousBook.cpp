@@ -0,0 +1,332 @@
+#include "ContinuousBook.h"
+#include <algorithm>
+
+EventQueue::EventQueue(size_t capacity)
+: events(std::max<size_t>(capacity, 1))
+{
+
+}
+
+void EventQueue::push(OrderEvent const& event)
+{
+    if (count == events.size())
+    {
+        // unwrap into a buffer twice as large
+        std::vector<OrderEvent> larger(events.size() * 2);
+        for (size_t i = 0; i < count; ++i)
+        {
+            larger[i] = events[(head + i) % events.size()];
+        }
+        events.swap(larger);
+        head = 0;
+    }
+    events[(head + count) % events.size()] = event;
+    count++;
+}
+
+bool EventQueue::pop(OrderEvent& event)
+{
+    if (count == 0)
+    {
+        return false;
+    }
+    event = events[head];
+    head = (head + 1) % events.size();
+    count--;
+    return true;
+}
+
+bool EventQueue::empty() const
+{
+    return count == 0;
+}
+
+size_t EventQueue::size() const
+{
+    return count;
+}
+
+void EventQueue::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+ContinuousBook::ContinuousBook()
+{
+
+}
+
+/** match against one side, best price first and oldest order first within a price */
+template <typename Levels>
+void ContinuousBook::matchAgainst(OrderBookEntry& incoming, Levels& levels, std::string const& timestamp, std::vector<OrderBookEntry>& fills)
+{
+    bool incomingIsBid = incoming.orderType == OrderBookType::bid;
+    while (incoming.amount > Decimal{} && !levels.empty())
+    {
+        auto level = levels.begin();
+        // stop once the best resting price does not cross
+        if (incomingIsBid ? level->first > incoming.price : level->first < incoming.price)
+        {
+            break;
+        }
+
+        OrderBookEntry& resting = level->second.front();
+        OrderBookEntry& bid = incomingIsBid ? incoming : resting;
+        OrderBookEntry& ask = incomingIsBid ? resting : incoming;
+
+        // sale at the resting price, the bid price difference releases the bot's reserved funds
+        OrderBookEntry sale{resting.price, std::min(bid.amount, ask.amount), timestamp, incoming.product, OrderBookType::asksale};
+        sale.priceDifference = bid.price - resting.price;
+        if (bid.username == "botuser")
+        {
+            sale.username = bid.username;
+            sale.orderType = OrderBookType::bidsale;
+            sale.orderID = bid.orderID;
+        }
+        if (ask.username == "botuser")
+        {
+            sale.username = ask.username;
+            sale.orderType = OrderBookType::asksale;
+            sale.orderID = ask.orderID;
+        }
+        fills.push_back(sale);
+
+        if (resting.amount <= incoming.amount)
+        {
+            incoming.amount -= resting.amount;
+            if (resting.username == "botuser")
+            {
+                botOrderLocations.erase(resting.orderID);
+            }
+            level->second.pop_front();
+            if (level->second.empty())
+            {
+                levels.erase(level);
+            }
+        }
+        else
+        {
+            resting.amount -= incoming.amount;
+            incoming.amount = Decimal{};
+        }
+    }
+}
+
+/** match an incoming order and rest what is left, sales are appended to fills */
+void ContinuousBook::add(OrderBookEntry order, std::string const& timestamp, std::vector<OrderBookEntry>& fills)
+{
+    if (order.orderType == OrderBookType::bid)
+    {
+        matchAgainst(order, asks, timestamp, fills);
+        if (order.amount > Decimal{})
+        {
+            bids[order.price].push_back(order);
+        }
+    }
+    else if (order.orderType == OrderBookType::ask)
+    {
+        matchAgainst(order, bids, timestamp, fills);
+        if (order.amount > Decimal{})
+        {
+            asks[order.price].push_back(order);
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    if (order.amount > Decimal{} && order.username == "botuser")
+    {
+        botOrderLocations[order.orderID] = {order.orderType == OrderBookType::bid, order.price};
+    }
+}
+
+/** remove a resting bot order, false if it is not in the book */
+bool ContinuousBook::cancel(std::string const& orderID)
+{
+    auto location = botOrderLocations.find(orderID);
+    if (location == botOrderLocations.end())
+    {
+        return false;
+    }
+    bool isBid = location->second.first;
+    Decimal price = location->second.second;
+    botOrderLocations.erase(location);
+
+    auto removeFrom = [&orderID, price](auto& levels)
+    {
+        auto level = levels.find(price);
+        if (level == levels.end())
+            return;
+        std::deque<OrderBookEntry>& orders = level->second;
+        for (auto it = orders.begin(); it != orders.end(); ++it)
+        {
+            if (it->username == "botuser" && it->orderID == orderID)
+            {
+                orders.erase(it);
+                break;
+            }
+        }
+        if (orders.empty())
+        {
+            levels.erase(level);
+        }
+    };
+    if (isBid)
+        removeFrom(bids);
+    else
+        removeFrom(asks);
+    return true;
+}
+
+/** whether a bot order with this ID is resting in the book */
+bool ContinuousBook::hasOrder(std::string const& orderID) const
+{
+    return botOrderLocations.count(orderID) > 0;
+}
+
+/** amount still resting of a bot order, 0 if it is not in the book */
+Decimal ContinuousBook::restingAmount(std::string const& orderID) const
+{
+    auto location = botOrderLocations.find(orderID);
+    if (location == botOrderLocations.end())
+    {
+        return Decimal{};
+    }
+    Decimal price = location->second.second;
+    auto findIn = [&orderID, price](auto const& levels)
+    {
+        auto level = levels.find(price);
+        if (level == levels.end())
+            return Decimal{};
+        for (OrderBookEntry const& order : level->second)
+        {
+            if (order.username == "botuser" && order.orderID == orderID)
+                return order.amount;
+        }
+        return Decimal{};
+    };
+    return location->second.first ? findIn(bids) : findIn(asks);
+}
+
+/** remove every resting order that is not a bot order */
+void ContinuousBook::expireDatasetOrders()
+{
+    auto expire = [](auto& levels)
+    {
+        for (auto level = levels.begin(); level != levels.end(); )
+        {
+            std::deque<OrderBookEntry>& orders = level->second;
+            orders.erase(std::remove_if(orders.begin(), orders.end(), [](OrderBookEntry const& e)
+            {
+                return e.username != "botuser";
+            }), orders.end());
+            level = orders.empty() ? levels.erase(level) : std::next(level);
+        }
+    };
+    // bot orders are tracked separately, so the book is empty of dataset orders in the common case
+    if (botOrderLocations.empty())
+    {
+        bids.clear();
+        asks.clear();
+        return;
+    }
+    expire(bids);
+    expire(asks);
+}
+
+/** resize or remove the dataset orders at a price of one side, false if there are none
+ * the first dataset order at the price takes the whole amount and any others there are dropped */
+template <typename Levels>
+bool ContinuousBook::resizeDatasetLevel(Levels& levels, Decimal price, Decimal amount)
+{
+    auto level = levels.find(price);
+    if (level == levels.end())
+    {
+        return false;
+    }
+    std::deque<OrderBookEntry>& orders = level->second;
+    bool found = false;
+    for (auto it = orders.begin(); it != orders.end(); )
+    {
+        if (it->username == "botuser")
+        {
+            ++it;
+        }
+        else if (!found && amount > Decimal{})
+        {
+            it->amount = amount;
+            found = true;
+            ++it;
+        }
+        else
+        {
+            found = true;
+            it = orders.erase(it);
+        }
+    }
+    if (orders.empty())
+    {
+        levels.erase(level);
+    }
+    return found;
+}
+
+/** bring the dataset liquidity at a side and price to the level's amount
+ * a resting level never crosses the other side, so resizing it in place cannot cause a sale */
+void ContinuousBook::setDatasetLevel(OrderBookEntry const& level, std::string const& timestamp, std::vector<OrderBookEntry>& fills)
+{
+    bool resized = false;
+    if (level.orderType == OrderBookType::bid)
+        resized = resizeDatasetLevel(bids, level.price, level.amount);
+    else if (level.orderType == OrderBookType::ask)
+        resized = resizeDatasetLevel(asks, level.price, level.amount);
+    else
+        return;
+
+    if (!resized && level.amount > Decimal{})
+    {
+        add(level, timestamp, fills);
+    }
+}
+
+/** bot orders still resting, with their remaining amounts */
+std::vector<OrderBookEntry> ContinuousBook::restingBotOrders() const
+{
+    std::vector<OrderBookEntry> resting;
+    for (auto const& e : botOrderLocations)
+    {
+        bool isBid = e.second.first;
+        Decimal price = e.second.second;
+        const std::deque<OrderBookEntry>* orders = nullptr;
+        if (isBid && bids.count(price)) orders = &bids.at(price);
+        if (!isBid && asks.count(price)) orders = &asks.at(price);
+        if (!orders)
+            continue;
+        for (OrderBookEntry const& order : *orders)
+        {
+            if (order.username == "botuser" && order.orderID == e.first)
+            {
+                resting.push_back(order);
+            }
+        }
+    }
+    return resting;
+}
+
+/** number of resting orders on both sides */
+size_t ContinuousBook::depth() const
+{
+    size_t total = 0;
+    for (auto const& level : bids)
+    {
+        total += level.second.size();
+    }
+    for (auto const& level : asks)
+    {
+        total += level.second.size();
+    }
+    return total;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+
+enum class OrderEventType {add, cancel, expireDataset, setLevel};
+
+/** one event of the continuous matching loop, the order lives in the caller's order storage */
+struct OrderEvent
+{
+    OrderEventType type;
+    size_t orderIndex;
+};
+
+/** fixed capacity ring buffer of events, allocated once and reused for every tick
+ * the capacity only grows when a tick brings more events than ever before */
+class EventQueue
+{
+    public:
+        EventQueue(size_t capacity = 1024);
+
+        void push(OrderEvent const& event);
+        bool pop(OrderEvent& event);
+        bool empty() const;
+        size_t size() const;
+        void clear();
+
+    private:
+        std::vector<OrderEvent> events;
+        size_t head = 0;
+        size_t count = 0;
+};
+
+/** limit order book for one product with price-time priority
+ * incoming orders match against the best resting prices first and the remainder rests */
+class ContinuousBook
+{
+    public:
+        ContinuousBook();
+
+        /** match an incoming order and rest what is left, sales are appended to fills
+         * sales trade at the resting price and follow the sale conventions of OrderBook::matchAsksToBids */
+        void add(OrderBookEntry order, std::string const& timestamp, std::vector<OrderBookEntry>& fills);
+
+        /** remove a resting bot order, false if it is not in the book */
+        bool cancel(std::string const& orderID);
+
+        /** whether a bot order with this ID is resting in the book */
+        bool hasOrder(std::string const& orderID) const;
+
+        /** amount still resting of a bot order, 0 if it is not in the book */
+        Decimal restingAmount(std::string const& orderID) const;
+
+        /** remove every resting order that is not a bot order, dataset snapshots only live for one tick */
+        void expireDatasetOrders();
+
+        /** bring the dataset liquidity at the order's side and price to the order's amount, 0 removes it
+         * a level already in the book keeps its place in time priority and is only resized,
+         * a new level arrives as an incoming order and can match resting bot orders, sales are appended to fills */
+        void setDatasetLevel(OrderBookEntry const& level, std::string const& timestamp, std::vector<OrderBookEntry>& fills);
+
+        /** bot orders still resting, with their remaining amounts */
+        std::vector<OrderBookEntry> restingBotOrders() const;
+
+        /** number of resting orders on both sides */
+        size_t depth() const;
+
+    private:
+        /** match against one side, best price first and oldest order first within a price */
+        template <typename Levels>
+        void matchAgainst(OrderBookEntry& incoming, Levels& levels, std::string const& timestamp, std::vector<OrderBookEntry>& fills);
+
+        /** resize or remove the dataset orders at a price of one side, false if there are none */
+        template <typename Levels>
+        bool resizeDatasetLevel(Levels& levels, Decimal price, Decimal amount);
+
+        // price levels, best price first, orders in arrival order within a level
+        std::map<Decimal, std::deque<OrderBookEntry>, std::greater<Decimal>> bids;
+        std::map<Decimal, std::deque<OrderBookEntry>> asks;
+
+        // side (true for bids) and price of every resting bot order by order ID
+        std::map<std::string, std::pair<bool, Decimal>> botOrderLocations;
+};
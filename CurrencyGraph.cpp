@@ -0,0 +1,227 @@
+#include "CurrencyGraph.h"
+#include "CSVReader.h"
+#include <deque>
+#include <algorithm>
+
+CurrencyGraph::CurrencyGraph(std::string _quoteCurrency)
+: quoteCurrencyName(_quoteCurrency)
+{
+    addCurrency(quoteCurrencyName);
+}
+
+/** ID of a product like DOGE/BTC, its currencies and conversion paths are added on first use */
+int CurrencyGraph::addProduct(std::string const& product)
+{
+    auto it = productIds.find(product);
+    if (it != productIds.end())
+    {
+        return it->second;
+    }
+    std::vector<std::string> currs = CSVReader::tokenise(product, '/');
+    if (currs.size() != 2)
+    {
+        return -1;
+    }
+    int id = productBase.size();
+    productIds[product] = id;
+    productBase.push_back(addCurrency(currs[0]));
+    productQuote.push_back(addCurrency(currs[1]));
+    prices.push_back(0);
+    dependents.emplace_back();
+
+    // a new edge can shorten or create paths, products are added rarely so all paths are searched again
+    rebuildPaths();
+    return id;
+}
+
+/** ID of a known product, -1 otherwise */
+int CurrencyGraph::productId(std::string const& product) const
+{
+    auto it = productIds.find(product);
+    return it == productIds.end() ? -1 : it->second;
+}
+
+/** currency a product is priced in, e.g. BTC for DOGE/BTC */
+int CurrencyGraph::productQuoteCurrency(int product) const
+{
+    return productQuote[product];
+}
+
+/** ID of a currency, added on first use */
+int CurrencyGraph::addCurrency(std::string const& currency)
+{
+    auto it = currencyIds.find(currency);
+    if (it != currencyIds.end())
+    {
+        return it->second;
+    }
+    int id = currencyNames.size();
+    currencyIds[currency] = id;
+    currencyNames.push_back(currency);
+    // the quote currency is worth 1, every other currency nothing until it has a path
+    bool isQuote = currency == quoteCurrencyName;
+    paths.emplace_back();
+    reachable.push_back(isQuote);
+    balances.push_back(0);
+    rates.push_back(isQuote ? 1 : 0);
+    values.push_back(0);
+    return id;
+}
+
+/** ID of a known currency, -1 otherwise */
+int CurrencyGraph::currencyId(std::string const& currency) const
+{
+    auto it = currencyIds.find(currency);
+    return it == currencyIds.end() ? -1 : it->second;
+}
+
+std::string const& CurrencyGraph::currencyName(int currency) const
+{
+    return currencyNames[currency];
+}
+
+std::string const& CurrencyGraph::quoteCurrency() const
+{
+    return quoteCurrencyName;
+}
+
+size_t CurrencyGraph::currencyCount() const
+{
+    return currencyNames.size();
+}
+
+/** last price of a product, in its quote currency */
+void CurrencyGraph::setPrice(int product, double price)
+{
+    if (prices[product] == price)
+    {
+        return;
+    }
+    prices[product] = price;
+    for (int currency : dependents[product])
+    {
+        revalue(currency);
+    }
+}
+
+/** amount held of a currency */
+void CurrencyGraph::setBalance(int currency, double amount)
+{
+    if (balances[currency] == amount)
+    {
+        return;
+    }
+    balances[currency] = amount;
+    revalue(currency);
+}
+
+double CurrencyGraph::rate(int currency) const
+{
+    return rates[currency];
+}
+
+double CurrencyGraph::value(int currency) const
+{
+    return values[currency];
+}
+
+/** summed every time rather than kept as a running total, so rounding never accumulates over a run */
+double CurrencyGraph::totalValue() const
+{
+    double total = 0;
+    for (double v : values)
+    {
+        total += v;
+    }
+    return total;
+}
+
+/** number of steps from a currency to the quote currency, -1 without a path */
+int CurrencyGraph::pathLength(int currency) const
+{
+    return reachable[currency] ? paths[currency].size() : -1;
+}
+
+/** find the conversion path of every currency and revalue everything */
+void CurrencyGraph::rebuildPaths()
+{
+    size_t currencyTotal = currencyNames.size();
+
+    // edges of each currency: the product and whether it is the quote side of it
+    std::vector<std::vector<PathStep>> edges(currencyTotal);
+    for (size_t p = 0; p < productBase.size(); ++p)
+    {
+        edges[productBase[p]].push_back(PathStep{(int)p, false});
+        edges[productQuote[p]].push_back(PathStep{(int)p, true});
+    }
+
+    // search outwards from the quote currency, each currency is reached by its shortest path
+    // and extends the path of the currency it was reached from by one step
+    std::fill(reachable.begin(), reachable.end(), false);
+    int quote = currencyIds[quoteCurrencyName];
+    paths[quote].clear();
+    reachable[quote] = true;
+    std::deque<int> frontier{quote};
+    while (!frontier.empty())
+    {
+        int reached = frontier.front();
+        frontier.pop_front();
+        for (PathStep const& edge : edges[reached])
+        {
+            // the currency at the other end converts into the reached one along this product
+            int other = edge.inverse ? productBase[edge.product] : productQuote[edge.product];
+            if (reachable[other])
+            {
+                continue;
+            }
+            reachable[other] = true;
+            paths[other].clear();
+            paths[other].push_back(PathStep{edge.product, !edge.inverse});
+            paths[other].insert(paths[other].end(), paths[reached].begin(), paths[reached].end());
+            frontier.push_back(other);
+        }
+    }
+
+    for (std::vector<int>& currencies : dependents)
+    {
+        currencies.clear();
+    }
+    for (size_t c = 0; c < currencyTotal; ++c)
+    {
+        if (!reachable[c])
+        {
+            paths[c].clear();
+        }
+        for (PathStep const& step : paths[c])
+        {
+            dependents[step.product].push_back(c);
+        }
+    }
+
+    for (size_t c = 0; c < currencyTotal; ++c)
+    {
+        values[c] = 0;
+        revalue(c);
+    }
+}
+
+/** revalue one currency after a price on its path or its balance changed */
+void CurrencyGraph::revalue(int currency)
+{
+    double newRate = reachable[currency] ? 1 : 0;
+    for (PathStep const& step : paths[currency])
+    {
+        double price = prices[step.product];
+        if (step.inverse)
+        {
+            newRate = price > 0 ? newRate / price : 0;
+        }
+        else
+        {
+            newRate *= price;
+        }
+    }
+    rates[currency] = newRate;
+
+    values[currency] = balances[currency] * newRate;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+
+/** values holdings in one quote currency through a graph of the traded products
+ * every product is an edge between its two currencies, the conversion path of each currency
+ * to the quote currency is found once, by breadth first search, when products are added,
+ * e.g. DOGE -> BTC -> USDT when there is no DOGE/USDT market
+ * prices and balances are set by ID and only the currencies they affect are revalued, so valuing
+ * the portfolio never builds product names or walks paths, the total is the sum of the few currency values */
+class CurrencyGraph
+{
+    public:
+        CurrencyGraph(std::string _quoteCurrency = "USDT");
+
+        /** ID of a product like DOGE/BTC, its currencies and conversion paths are added on first use */
+        int addProduct(std::string const& product);
+
+        /** ID of a known product, -1 otherwise */
+        int productId(std::string const& product) const;
+
+        /** currency a product is priced in, e.g. BTC for DOGE/BTC */
+        int productQuoteCurrency(int product) const;
+
+        /** ID of a currency, added on first use */
+        int addCurrency(std::string const& currency);
+
+        /** ID of a known currency, -1 otherwise */
+        int currencyId(std::string const& currency) const;
+
+        std::string const& currencyName(int currency) const;
+        std::string const& quoteCurrency() const;
+        size_t currencyCount() const;
+
+        /** last price of a product, in its quote currency */
+        void setPrice(int product, double price);
+
+        /** amount held of a currency */
+        void setBalance(int currency, double amount);
+
+        /** value of one unit of a currency in the quote currency, 0 without a path or with a missing price on it */
+        double rate(int currency) const;
+
+        /** value of the amount held of a currency in the quote currency */
+        double value(int currency) const;
+
+        /** value of all holdings in the quote currency */
+        double totalValue() const;
+
+        /** number of steps from a currency to the quote currency, -1 without a path */
+        int pathLength(int currency) const;
+
+    private:
+        /** one conversion along a product: base to quote at the price, or quote to base at its inverse */
+        struct PathStep
+        {
+            int product;
+            bool inverse;
+        };
+
+        /** find the conversion path of every currency and revalue everything */
+        void rebuildPaths();
+
+        /** revalue one currency after a price on its path or its balance changed */
+        void revalue(int currency);
+
+        std::string quoteCurrencyName;
+
+        std::vector<std::string> currencyNames;
+        std::map<std::string, int> currencyIds;
+        std::map<std::string, int> productIds;
+        std::vector<int> productBase;
+        std::vector<int> productQuote;
+        std::vector<double> prices;
+
+        // path of each currency, reachable[c] is false without one
+        std::vector<std::vector<PathStep>> paths;
+        std::vector<bool> reachable;
+        // currencies whose path goes through each product
+        std::vector<std::vector<int>> dependents;
+
+        std::vector<double> balances;
+        std::vector<double> rates;
+        std::vector<double> values;
+};
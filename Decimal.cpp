@@ -0,0 +1,192 @@
+#include "Decimal.h"
+#include <cmath>
+#include <stdexcept>
+
+Decimal::Decimal()
+: value(0)
+{
+
+}
+
+/** parse decimal text without going through a double */
+Decimal Decimal::parse(std::string const& text)
+{
+    size_t i = 0;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+'))
+    {
+        negative = text[i] == '-';
+        i++;
+    }
+
+    long long whole = 0;
+    long long fraction = 0;
+    int fractionDigits = 0;
+    bool roundUp = false;
+    bool hasDigits = false;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+    {
+        if (whole > (INT64_MAX / unitsPerOne - 9) / 10)
+        {
+            throw std::invalid_argument{"Decimal::parse out of range " + text};
+        }
+        whole = whole * 10 + (text[i] - '0');
+        hasDigits = true;
+    }
+    if (i < text.size() && text[i] == '.')
+    {
+        for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+        {
+            hasDigits = true;
+            if (fractionDigits < scale)
+            {
+                fraction = fraction * 10 + (text[i] - '0');
+                fractionDigits++;
+            }
+            else if (fractionDigits == scale)
+            {
+                // first digit beyond the scale decides the rounding, the rest are dropped
+                roundUp = text[i] >= '5';
+                fractionDigits++;
+            }
+        }
+    }
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E') && hasDigits)
+    {
+        // exponent notation is rare in the dumps, it goes through a double
+        return fromDouble(std::stod(text));
+    }
+    if (!hasDigits || i != text.size())
+    {
+        throw std::invalid_argument{"Decimal::parse bad number " + text};
+    }
+
+    for (; fractionDigits < scale; ++fractionDigits)
+    {
+        fraction *= 10;
+    }
+    long long units = whole * unitsPerOne + fraction + (roundUp ? 1 : 0);
+    return fromUnits(negative ? -units : units);
+}
+
+/** nearest decimal to a double, for values computed in floating point */
+Decimal Decimal::fromDouble(double value)
+{
+    return fromUnits(std::llround(value * unitsPerOne));
+}
+
+/** nearest decimal with at most the given number of decimals (0 to 8) */
+Decimal Decimal::fromDouble(double value, int decimals)
+{
+    static const long long powersOfTen[scale + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+    decimals = decimals < 0 ? 0 : (decimals > scale ? scale : decimals);
+    return fromUnits(std::llround(value * powersOfTen[decimals]) * powersOfTen[scale - decimals]);
+}
+
+/** a decimal from its raw count of 1e-8 units */
+Decimal Decimal::fromUnits(long long units)
+{
+    Decimal d;
+    d.value = units;
+    return d;
+}
+
+long long Decimal::units() const
+{
+    return value;
+}
+
+double Decimal::toDouble() const
+{
+    // the division is correctly rounded, so parsed text gives the same double as std::stod
+    return (double)value / unitsPerOne;
+}
+
+Decimal::operator double() const
+{
+    return toDouble();
+}
+
+/** exact text with trailing zeros removed */
+std::string Decimal::toString() const
+{
+    unsigned long long magnitude = value < 0 ? -(unsigned long long)value : value;
+    std::string text = std::to_string(magnitude / unitsPerOne);
+    std::string fraction = std::to_string(magnitude % unitsPerOne);
+    fraction.insert(0, scale - fraction.size(), '0');
+    while (!fraction.empty() && fraction.back() == '0')
+    {
+        fraction.pop_back();
+    }
+    if (!fraction.empty())
+    {
+        text += "." + fraction;
+    }
+    return value < 0 ? "-" + text : text;
+}
+
+/** product rounded half away from zero to 8 decimals */
+Decimal Decimal::multiply(Decimal other) const
+{
+    __int128 product = (__int128)value * other.value;
+    __int128 half = unitsPerOne / 2;
+    product += product < 0 ? -half : half;
+    return fromUnits((long long)(product / unitsPerOne));
+}
+
+Decimal Decimal::operator+(Decimal other) const
+{
+    return fromUnits(value + other.value);
+}
+
+Decimal Decimal::operator-(Decimal other) const
+{
+    return fromUnits(value - other.value);
+}
+
+Decimal Decimal::operator-() const
+{
+    return fromUnits(-value);
+}
+
+Decimal& Decimal::operator+=(Decimal other)
+{
+    value += other.value;
+    return *this;
+}
+
+Decimal& Decimal::operator-=(Decimal other)
+{
+    value -= other.value;
+    return *this;
+}
+
+bool Decimal::operator==(Decimal other) const
+{
+    return value == other.value;
+}
+
+bool Decimal::operator!=(Decimal other) const
+{
+    return value != other.value;
+}
+
+bool Decimal::operator<(Decimal other) const
+{
+    return value < other.value;
+}
+
+bool Decimal::operator<=(Decimal other) const
+{
+    return value <= other.value;
+}
+
+bool Decimal::operator>(Decimal other) const
+{
+    return value > other.value;
+}
+
+bool Decimal::operator>=(Decimal other) const
+{
+    return value >= other.value;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+/** fixed-point decimal stored as a 64-bit count of 1e-8 units
+ * 8 decimals is the precision the exchange quotes every product in, so prices and amounts
+ * parsed from the CSV text are exact and compare and add as integers
+ * converts implicitly to double for statistics, wallets and logs */
+class Decimal
+{
+    public:
+        static const int scale = 8;
+        static const long long unitsPerOne = 100000000;
+
+        Decimal();
+
+        /** parse decimal text like 0.02187305 or -12.5 without going through a double
+         * digits past the 8th decimal are rounded half away from zero, throws std::invalid_argument on bad text */
+        static Decimal parse(std::string const& text);
+
+        /** nearest decimal to a double, for values computed in floating point */
+        static Decimal fromDouble(double value);
+
+        /** nearest decimal with at most the given number of decimals (0 to 8) */
+        static Decimal fromDouble(double value, int decimals);
+
+        /** a decimal from its raw count of 1e-8 units */
+        static Decimal fromUnits(long long units);
+
+        long long units() const;
+        double toDouble() const;
+        operator double() const;
+
+        /** exact text with trailing zeros removed, e.g. 0.0000003 */
+        std::string toString() const;
+
+        /** product rounded half away from zero to 8 decimals, computed in 128 bits so it cannot overflow midway */
+        Decimal multiply(Decimal other) const;
+
+        Decimal operator+(Decimal other) const;
+        Decimal operator-(Decimal other) const;
+        Decimal operator-() const;
+        Decimal& operator+=(Decimal other);
+        Decimal& operator-=(Decimal other);
+
+        bool operator==(Decimal other) const;
+        bool operator!=(Decimal other) const;
+        bool operator<(Decimal other) const;
+        bool operator<=(Decimal other) const;
+        bool operator>(Decimal other) const;
+        bool operator>=(Decimal other) const;
+
+    private:
+        long long value;
+};
@@ -0,0 +1,297 @@
+#include "FillSimulator.h"
+#include <algorithm>
+
+double FillEstimate::fillRatio() const
+{
+    if (requested == 0)
+    {
+        return 0;
+    }
+    return filled / requested;
+}
+
+double FillEstimate::averagePrice() const
+{
+    if (filled == 0)
+    {
+        return 0;
+    }
+    return notional / filled;
+}
+
+FillSimulator::FillSimulator()
+{
+
+}
+
+/** append the levels of one tick, sorted best first */
+void FillSimulator::addTick(Ladder& ladder, std::vector<std::pair<double, double>> const& levels)
+{
+    double amount = 0;
+    double notional = 0;
+    for (auto const& level : levels)
+    {
+        amount += level.second;
+        notional += level.first * level.second;
+        ladder.price.push_back(level.first);
+        ladder.cumulativeAmount.push_back(amount);
+        ladder.cumulativeNotional.push_back(notional);
+    }
+    ladder.best.push_back(levels.empty() ? 0 : levels.front().first);
+    ladder.start.push_back(ladder.price.size());
+}
+
+/** sort the orders of one side best first and merge the ones at the same price */
+static void mergeLevels(std::vector<std::pair<double, double>>& levels, bool descending)
+{
+    if (descending)
+        std::sort(levels.begin(), levels.end(), [](auto const& a, auto const& b) { return a.first > b.first; });
+    else
+        std::sort(levels.begin(), levels.end());
+    size_t kept = 0;
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        if (kept > 0 && levels[kept - 1].first == levels[i].first)
+        {
+            levels[kept - 1].second += levels[i].second;
+        }
+        else
+        {
+            levels[kept++] = levels[i];
+        }
+    }
+    levels.resize(kept);
+}
+
+/** lay out the ladders from orders grouped by timestamp */
+void FillSimulator::build(std::map<std::string, std::vector<OrderBookEntry>> const& ordersByTimestamp)
+{
+    books.clear();
+    ticks = ordersByTimestamp.size();
+    for (auto const& tick : ordersByTimestamp)
+    {
+        for (OrderBookEntry const& order : tick.second)
+        {
+            books[order.product];
+        }
+    }
+    for (auto& e : books)
+    {
+        e.second.bids.start.assign(1, 0);
+        e.second.asks.start.assign(1, 0);
+    }
+
+    // levels of every product at the current tick, reused from tick to tick
+    std::map<std::string, std::pair<std::vector<std::pair<double, double>>, std::vector<std::pair<double, double>>>> levels;
+    for (auto const& tick : ordersByTimestamp)
+    {
+        for (auto& e : levels)
+        {
+            e.second.first.clear();
+            e.second.second.clear();
+        }
+        for (OrderBookEntry const& order : tick.second)
+        {
+            if (order.orderType == OrderBookType::bid)
+                levels[order.product].first.push_back(std::make_pair((double)order.price, (double)order.amount));
+            else if (order.orderType == OrderBookType::ask)
+                levels[order.product].second.push_back(std::make_pair((double)order.price, (double)order.amount));
+        }
+        for (auto& e : books)
+        {
+            auto& product = levels[e.first];
+            mergeLevels(product.first, true);
+            mergeLevels(product.second, false);
+            addTick(e.second.bids, product.first);
+            addTick(e.second.asks, product.second);
+            if (!product.first.empty() || !product.second.empty())
+            {
+                e.second.activeTicks++;
+            }
+        }
+    }
+}
+
+size_t FillSimulator::tickCount() const
+{
+    return ticks;
+}
+
+/** the estimate of every hypothesis, in the order given */
+std::vector<FillEstimate> FillSimulator::evaluate(std::vector<FillHypothesis> const& hypotheses) const
+{
+    std::vector<FillEstimate> estimates(hypotheses.size());
+    std::map<std::pair<std::string, OrderBookType>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < hypotheses.size(); ++i)
+    {
+        FillHypothesis const& h = hypotheses[i];
+        if ((h.side == OrderBookType::bid || h.side == OrderBookType::ask) && h.price > 0 && h.amount > 0)
+        {
+            groups[std::make_pair(h.product, h.side)].push_back(i);
+        }
+    }
+
+    for (auto& e : groups)
+    {
+        auto book = books.find(e.first.first);
+        if (book == books.end())
+        {
+            continue;
+        }
+        std::vector<size_t>& group = e.second;
+        std::stable_sort(group.begin(), group.end(), [&hypotheses](size_t a, size_t b)
+        {
+            return hypotheses[a].price < hypotheses[b].price;
+        });
+        for (size_t i : group)
+        {
+            estimates[i].ticks = book->second.activeTicks;
+            estimates[i].requested = hypotheses[i].amount * book->second.activeTicks;
+        }
+        if (e.first.second == OrderBookType::bid)
+            evaluateBids(book->second, hypotheses, group, estimates);
+        else
+            evaluateAsks(book->second, hypotheses, group, estimates);
+    }
+    return estimates;
+}
+
+/** notional of the first amount units of a tick's ask ladder, levels [first, last) */
+double FillSimulator::notionalAt(Ladder const& ladder, size_t first, size_t last, double amount)
+{
+    if (amount <= 0 || first == last)
+    {
+        return 0;
+    }
+    const double* cumulative = ladder.cumulativeAmount.data();
+    size_t level = std::lower_bound(cumulative + first, cumulative + last, amount) - cumulative;
+    if (level == last)
+    {
+        return ladder.cumulativeNotional[last - 1];
+    }
+    double amountBefore = level > first ? cumulative[level - 1] : 0;
+    double notionalBefore = level > first ? ladder.cumulativeNotional[level - 1] : 0;
+    return notionalBefore + (amount - amountBefore) * ladder.price[level];
+}
+
+/** bids sorted by ascending price, the ones at or above the best ask cross, which is a suffix of them
+ * a bid at X gets the ask amount at or below X minus what the dataset bids at X and above take first,
+ * that is the slice of the ask ladder after the first bidDepth units, sold at the ask prices */
+void FillSimulator::evaluateBids(ProductBook const& book, std::vector<FillHypothesis> const& hypotheses,
+                                 std::vector<size_t> const& group, std::vector<FillEstimate>& estimates) const
+{
+    size_t n = group.size();
+    std::vector<double> prices(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        prices[i] = hypotheses[group[i]].price;
+    }
+    const double* price = prices.data();
+    Ladder const& asks = book.asks;
+    Ladder const& bids = book.bids;
+
+    for (size_t t = 0; t < ticks; ++t)
+    {
+        size_t askFirst = asks.start[t], askLast = asks.start[t + 1];
+        if (askFirst == askLast)
+        {
+            continue;
+        }
+        // one comparison per hypothesis, the loop the compiler vectorizes
+        double bestAsk = asks.best[t];
+        size_t crossing = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            crossing += price[i] >= bestAsk;
+        }
+        if (crossing == 0)
+        {
+            continue;
+        }
+
+        // merge the crossing hypotheses with the ladders, the ask levels at or below the price and the bid levels at or above it
+        size_t bidFirst = bids.start[t];
+        size_t a = askFirst;
+        size_t b = bids.start[t + 1];
+        for (size_t i = n - crossing; i < n; ++i)
+        {
+            double p = price[i];
+            while (a < askLast && asks.price[a] <= p)
+                ++a;
+            while (b > bidFirst && bids.price[b - 1] < p)
+                --b;
+            double askDepth = asks.cumulativeAmount[a - 1];
+            double bidDepth = b > bidFirst ? bids.cumulativeAmount[b - 1] : 0;
+            double available = askDepth - bidDepth;
+            if (available <= 0)
+            {
+                continue;
+            }
+            FillEstimate& estimate = estimates[group[i]];
+            double fill = std::min(hypotheses[group[i]].amount, available);
+            estimate.ticksFilled++;
+            estimate.filled += fill;
+            estimate.notional += notionalAt(asks, askFirst, a, bidDepth + fill) - notionalAt(asks, askFirst, a, bidDepth);
+        }
+    }
+}
+
+/** asks sorted by ascending price, the ones at or below the best bid cross, which is a prefix of them
+ * an ask at X gets the bid amount at or above X minus what the dataset asks at X and below take first,
+ * the sale price of a matched ask is its own price */
+void FillSimulator::evaluateAsks(ProductBook const& book, std::vector<FillHypothesis> const& hypotheses,
+                                 std::vector<size_t> const& group, std::vector<FillEstimate>& estimates) const
+{
+    size_t n = group.size();
+    std::vector<double> prices(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        prices[i] = hypotheses[group[i]].price;
+    }
+    const double* price = prices.data();
+    Ladder const& asks = book.asks;
+    Ladder const& bids = book.bids;
+
+    for (size_t t = 0; t < ticks; ++t)
+    {
+        size_t bidFirst = bids.start[t], bidLast = bids.start[t + 1];
+        if (bidFirst == bidLast)
+        {
+            continue;
+        }
+        double bestBid = bids.best[t];
+        size_t crossing = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            crossing += price[i] <= bestBid;
+        }
+        if (crossing == 0)
+        {
+            continue;
+        }
+
+        size_t askFirst = asks.start[t], askLast = asks.start[t + 1];
+        size_t a = askFirst;
+        size_t b = bidLast;
+        for (size_t i = 0; i < crossing; ++i)
+        {
+            double p = price[i];
+            while (a < askLast && asks.price[a] <= p)
+                ++a;
+            while (b > bidFirst && bids.price[b - 1] < p)
+                --b;
+            double bidDepth = b > bidFirst ? bids.cumulativeAmount[b - 1] : 0;
+            double askDepth = a > askFirst ? asks.cumulativeAmount[a - 1] : 0;
+            double available = bidDepth - askDepth;
+            if (available <= 0)
+            {
+                continue;
+            }
+            FillEstimate& estimate = estimates[group[i]];
+            double fill = std::min(hypotheses[group[i]].amount, available);
+            estimate.ticksFilled++;
+            estimate.filled += fill;
+            estimate.notional += fill * p;
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+
+/** a hypothetical order posted at every tick */
+struct FillHypothesis
+{
+    std::string product;
+    OrderBookType side;
+    double price;
+    double amount;
+};
+
+/** how a hypothetical order would have filled over the loaded ticks */
+struct FillEstimate
+{
+    // ticks the product had orders at and ticks the order got at least a partial fill
+    int ticks = 0;
+    int ticksFilled = 0;
+    double requested = 0;
+    double filled = 0;
+    // amount times sale price of the fills
+    double notional = 0;
+
+    /** share of the requested amount that filled, 0 if nothing was requested */
+    double fillRatio() const;
+
+    /** amount weighted average sale price of the fills, 0 without fills */
+    double averagePrice() const;
+};
+
+/** what-if fill queries over the whole loaded book
+ * the dataset orders of every product are laid out once as per tick price ladders with cumulative
+ * amounts, one flat array per quantity; an order joins the batch matching of a tick behind the
+ * dataset orders at its own price or better, so a bid at price X fills from the asks at or below X
+ * that the dataset bids at X and above have not taken, at the ask prices, and an ask at X fills
+ * from the bids at or above X the asks at X and below have not taken, at X; the hypotheses of
+ * one product and side are sorted by price so every tick is one crossing test over all of them
+ * and one merge of the crossing ones with the ladders */
+class FillSimulator
+{
+    public:
+        FillSimulator();
+
+        /** lay out the ladders from orders grouped by timestamp */
+        void build(std::map<std::string, std::vector<OrderBookEntry>> const& ordersByTimestamp);
+
+        /** number of ticks loaded */
+        size_t tickCount() const;
+
+        /** the estimate of every hypothesis, in the order given, unknown products get an empty estimate */
+        std::vector<FillEstimate> evaluate(std::vector<FillHypothesis> const& hypotheses) const;
+
+    private:
+        /** price ladders of one side of one product, levels of tick t are [start[t], start[t + 1]) */
+        struct Ladder
+        {
+            std::vector<size_t> start;
+            // best price per tick, 0 for a tick without orders on this side
+            std::vector<double> best;
+            // asks ascending, bids descending, the cumulative sums include the level itself
+            std::vector<double> price;
+            std::vector<double> cumulativeAmount;
+            std::vector<double> cumulativeNotional;
+        };
+
+        struct ProductBook
+        {
+            Ladder bids;
+            Ladder asks;
+            // ticks with orders on either side
+            int activeTicks = 0;
+        };
+
+        /** append the levels of one tick, sorted best first */
+        static void addTick(Ladder& ladder, std::vector<std::pair<double, double>> const& levels);
+
+        /** evaluate the hypotheses of one product and side, given by index and sorted by price */
+        void evaluateBids(ProductBook const& book, std::vector<FillHypothesis> const& hypotheses,
+                          std::vector<size_t> const& group, std::vector<FillEstimate>& estimates) const;
+        void evaluateAsks(ProductBook const& book, std::vector<FillHypothesis> const& hypotheses,
+                          std::vector<size_t> const& group, std::vector<FillEstimate>& estimates) const;
+
+        /** notional of the first amount units of a tick's ask ladder */
+        static double notionalAt(Ladder const& ladder, size_t first, size_t last, double amount);
+
+        std::map<std::string, ProductBook> books;
+        size_t ticks = 0;
+};
@@ -0,0 +1,59 @@
+#include "LatencyRecorder.h"
+#include <algorithm>
+
+LatencyRecorder::LatencyRecorder(size_t expectedSamples)
+{
+    samples.reserve(expectedSamples);
+}
+
+void LatencyRecorder::record(long long nanoseconds)
+{
+    samples.push_back(nanoseconds);
+    total += nanoseconds;
+}
+
+size_t LatencyRecorder::count() const
+{
+    return samples.size();
+}
+
+double LatencyRecorder::mean() const
+{
+    if (samples.empty())
+    {
+        return 0;
+    }
+    return (double)total / samples.size();
+}
+
+long long LatencyRecorder::max() const
+{
+    if (samples.empty())
+    {
+        return 0;
+    }
+    return *std::max_element(samples.begin(), samples.end());
+}
+
+/** value below which the given fraction of samples fall, e.g. 0.99 */
+long long LatencyRecorder::percentile(double fraction) const
+{
+    if (samples.empty())
+    {
+        return 0;
+    }
+    std::vector<long long> sorted = samples;
+    size_t index = std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+/** one line summary: count, mean, p50, p99 and max */
+void LatencyRecorder::report(std::ostream& out, std::string const& label) const
+{
+    out << label << ": " << count() << " samples, ";
+    out << "mean " << (long long)mean() << " ns, ";
+    out << "p50 " << percentile(0.5) << " ns, ";
+    out << "p99 " << percentile(0.99) << " ns, ";
+    out << "max " << max() << " ns" << std::endl;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <iostream>
+
+/** collects latency samples in nanoseconds and summarizes them */
+class LatencyRecorder
+{
+    public:
+        /** reserve room for the expected number of samples so recording never allocates */
+        LatencyRecorder(size_t expectedSamples = 0);
+
+        void record(long long nanoseconds);
+
+        size_t count() const;
+        double mean() const;
+        long long max() const;
+
+        /** value below which the given fraction of samples fall, e.g. 0.99 */
+        long long percentile(double fraction) const;
+
+        /** one line summary: count, mean, p50, p99 and max */
+        void report(std::ostream& out, std::string const& label) const;
+
+    private:
+        std::vector<long long> samples;
+        long long total = 0;
+};
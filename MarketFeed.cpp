@@ -0,0 +1,499 @@
+#include "MarketFeed.h"
+#include "Checkpoint.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <set>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** append a frame header and payload to a send buffer */
+static void appendFrame(std::string& out, FeedFrameType type, std::string const& payload)
+{
+    uint32_t length = payload.size();
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.push_back((char)type);
+    out.append(payload);
+}
+
+/** fill in a socket address for "unix:<path>" or "<host>:<port>", returns the address length */
+static socklen_t resolveFeedAddress(std::string const& address, sockaddr_storage& storage)
+{
+    std::memset(&storage, 0, sizeof(storage));
+    if (address.compare(0, 5, "unix:") == 0)
+    {
+        std::string path = address.substr(5);
+        sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&storage);
+        if (path.empty() || path.size() >= sizeof(un->sun_path))
+        {
+            throw std::runtime_error{"bad Unix socket path " + path};
+        }
+        un->sun_family = AF_UNIX;
+        std::strcpy(un->sun_path, path.c_str());
+        return sizeof(sockaddr_un);
+    }
+
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+    {
+        throw std::runtime_error{"bad feed address " + address + ", expected unix:<path> or <host>:<port>"};
+    }
+    std::string host = address.substr(0, colon);
+    sockaddr_in* in = reinterpret_cast<sockaddr_in*>(&storage);
+    in->sin_family = AF_INET;
+    in->sin_port = htons(std::stoi(address.substr(colon + 1)));
+    if (host == "localhost" || host.empty())
+    {
+        host = "127.0.0.1";
+    }
+    if (inet_pton(AF_INET, host.c_str(), &in->sin_addr) != 1)
+    {
+        throw std::runtime_error{"bad IPv4 address " + host};
+    }
+    return sizeof(sockaddr_in);
+}
+
+/** small frames must not wait for the TCP send coalescing */
+static void disableNagle(int fd, sockaddr_storage const& storage)
+{
+    if (storage.ss_family == AF_INET)
+    {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+}
+
+int listenOnFeedAddress(std::string const& address)
+{
+    sockaddr_storage storage;
+    socklen_t length = resolveFeedAddress(address, storage);
+    int fd = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error{std::string{"socket: "} + std::strerror(errno)};
+    }
+    if (storage.ss_family == AF_UNIX)
+    {
+        // a socket file left over from an earlier run would make bind fail
+        unlink(reinterpret_cast<sockaddr_un*>(&storage)->sun_path);
+    }
+    else
+    {
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    }
+    if (bind(fd, reinterpret_cast<sockaddr*>(&storage), length) < 0 || listen(fd, 1) < 0)
+    {
+        std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error{"cannot listen on " + address + ": " + error};
+    }
+    return fd;
+}
+
+int connectToFeedAddress(std::string const& address)
+{
+    sockaddr_storage storage;
+    socklen_t length = resolveFeedAddress(address, storage);
+    int fd = socket(storage.ss_family, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error{std::string{"socket: "} + std::strerror(errno)};
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&storage), length) < 0)
+    {
+        std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error{"cannot connect to " + address + ": " + error};
+    }
+    disableNagle(fd, storage);
+    return fd;
+}
+
+FrameReceiver::FrameReceiver(size_t capacity)
+: buffer(capacity)
+{
+
+}
+
+/** read what the socket has into the buffer */
+long long FrameReceiver::receive(int fd)
+{
+    if (end == buffer.size())
+    {
+        // move the unfinished frame to the front, grow only if a single frame fills the buffer
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+        if (end == buffer.size())
+        {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+    ssize_t received = recv(fd, buffer.data() + end, buffer.size() - end, 0);
+    if (received < 0)
+    {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? -1 : 0;
+    }
+    end += received;
+    return received;
+}
+
+/** the next complete frame, the payload points into the buffer and stays valid until the next receive */
+bool FrameReceiver::nextFrame(FeedFrameType& type, const char*& payload, size_t& size)
+{
+    const size_t header = sizeof(uint32_t) + 1;
+    if (end - begin < header)
+    {
+        return false;
+    }
+    uint32_t length;
+    std::memcpy(&length, buffer.data() + begin, sizeof(length));
+    if (end - begin < header + length)
+    {
+        return false;
+    }
+    type = (FeedFrameType)buffer[begin + sizeof(uint32_t)];
+    payload = buffer.data() + begin + header;
+    size = length;
+    begin += header + length;
+    if (begin == end)
+    {
+        begin = 0;
+        end = 0;
+    }
+    return true;
+}
+
+FeedServer::FeedServer(std::vector<std::string> _files, std::string _address, double _speed)
+: files(_files),
+  address(_address),
+  speed(_speed)
+{
+
+}
+
+/** wait for a bot to connect, replay the dataset and collect its replies, false on socket errors */
+bool FeedServer::run()
+{
+    int listenFd;
+    try
+    {
+        listenFd = listenOnFeedAddress(address);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "FeedServer::run " << e.what() << std::endl;
+        return false;
+    }
+    std::cout << "Feed server listening on " << address << std::endl;
+    clientFd = accept(listenFd, nullptr, nullptr);
+    close(listenFd);
+    if (address.compare(0, 5, "unix:") == 0)
+    {
+        unlink(address.substr(5).c_str());
+    }
+    if (clientFd < 0)
+    {
+        std::cout << "FeedServer::run accept failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    int one = 1;
+    setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    // sends and receives interleave through poll, so a slow bot cannot deadlock the replay
+    fcntl(clientFd, F_SETFL, fcntl(clientFd, F_GETFL) | O_NONBLOCK);
+
+    TickStream stream{files};
+    Tick tick;
+    Tick next;
+    bool hasTick = stream.nextTick(tick);
+    auto start = std::chrono::steady_clock::now();
+    long long firstMicros = 0;
+    bool paced = speed > 0;
+    if (hasTick && paced)
+    {
+        try
+        {
+            firstMicros = OrderBookEntry::timestampToMicros(tick.timestamp);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "FeedServer::run timestamps cannot be paced, replaying as fast as possible" << std::endl;
+            paced = false;
+        }
+    }
+    // time at which a tick is due for sending
+    auto dueTime = [&](std::string const& timestamp)
+    {
+        long long offset = paced ? (long long)((OrderBookEntry::timestampToMicros(timestamp) - firstMicros) / speed) : 0;
+        return start + std::chrono::microseconds(offset);
+    };
+
+    bool connected = true;
+    while (hasTick && connected)
+    {
+        bool hasNext = stream.nextTick(next);
+
+        // tick frame: sequence, timestamps, product table and orders referring to it
+        BinaryWriter frame;
+        frame.writeInt(ticksSent);
+        frame.writeString(tick.timestamp);
+        frame.writeString(hasNext ? next.timestamp : "");
+        std::map<std::string, long long> productIndex;
+        for (OrderBookEntry const& order : tick.orders)
+        {
+            productIndex.emplace(order.product, productIndex.size());
+        }
+        std::vector<std::string> products(productIndex.size());
+        for (auto const& e : productIndex)
+        {
+            products[e.second] = e.first;
+        }
+        frame.writeInt(products.size());
+        for (std::string const& p : products)
+        {
+            frame.writeString(p);
+        }
+        frame.writeInt(tick.orders.size());
+        for (OrderBookEntry const& order : tick.orders)
+        {
+            frame.writeInt(productIndex[order.product]);
+            frame.writeInt((long long)order.orderType);
+            frame.writeInt(order.price.units());
+            frame.writeInt(order.amount.units());
+        }
+        appendFrame(pending, FeedFrameType::tick, frame.buffer);
+        pendingSequences.push_back(ticksSent);
+        sendTimes.emplace_back();
+        ticksSent++;
+
+        // ticks that are already due go out together with this one
+        auto due = hasNext ? dueTime(next.timestamp) : std::chrono::steady_clock::now();
+        if (!hasNext || due > std::chrono::steady_clock::now() || pending.size() > (1 << 16))
+        {
+            connected = sendPending();
+        }
+        while (connected && hasNext && std::chrono::steady_clock::now() < due)
+        {
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::steady_clock::now());
+            connected = readReplies(std::max<long long>(wait.count(), 1));
+        }
+
+        tick = std::move(next);
+        hasTick = hasNext;
+    }
+    if (connected)
+    {
+        connected = sendPending();
+    }
+
+    // the bot answers every tick, the last replies may still be on their way
+    while (connected && repliesReceived < ticksSent)
+    {
+        connected = readReplies(1000);
+    }
+    close(clientFd);
+    return true;
+}
+
+/** send the pending frames, reading replies whenever the socket is readable */
+bool FeedServer::sendPending()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (long long sequence : pendingSequences)
+    {
+        sendTimes[sequence] = now;
+    }
+    pendingSequences.clear();
+
+    size_t sent = 0;
+    while (sent < pending.size())
+    {
+        ssize_t written = send(clientFd, pending.data() + sent, pending.size() - sent, MSG_NOSIGNAL);
+        if (written > 0)
+        {
+            sent += written;
+            writes++;
+            continue;
+        }
+        if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            pending.clear();
+            return false;
+        }
+        // socket buffer full: wait until it drains, taking replies meanwhile
+        pollfd p{clientFd, POLLIN | POLLOUT, 0};
+        poll(&p, 1, 1000);
+        if ((p.revents & POLLIN) && !readReplies(0))
+        {
+            pending.clear();
+            return false;
+        }
+    }
+    pending.clear();
+    return true;
+}
+
+/** read and process the replies available, waiting up to timeoutMillis for the first one */
+bool FeedServer::readReplies(int timeoutMillis)
+{
+    pollfd p{clientFd, POLLIN, 0};
+    if (poll(&p, 1, timeoutMillis) <= 0)
+    {
+        return true;
+    }
+    while (true)
+    {
+        long long received = receiver.receive(clientFd);
+        if (received == 0)
+        {
+            return false;
+        }
+        auto now = std::chrono::steady_clock::now();
+
+        FeedFrameType type;
+        const char* payload;
+        size_t size;
+        while (receiver.nextFrame(type, payload, size))
+        {
+            if (type != FeedFrameType::orders)
+                continue;
+            try
+            {
+                BinaryReader in{payload, size};
+                long long sequence = in.readInt();
+                long long count = in.readInt();
+                if (sequence >= 0 && sequence < (long long)sendTimes.size())
+                {
+                    tickToOrder.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - sendTimes[sequence]).count());
+                }
+                repliesReceived++;
+                ordersReceived += count;
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "FeedServer::readReplies bad orders frame" << std::endl;
+            }
+        }
+        if (received < 0)
+        {
+            return true;
+        }
+    }
+}
+
+/** ticks sent, writes used, orders received and tick-to-order latency */
+void FeedServer::report(std::ostream& out) const
+{
+    out << "Ticks sent: " << ticksSent << " in " << writes << " writes" << std::endl;
+    out << "Replies received: " << repliesReceived << ", bot orders received: " << ordersReceived << std::endl;
+    tickToOrder.report(out, "Tick-to-order latency, server send to reply");
+}
+
+/** connect to a feed server, throws std::runtime_error when it cannot */
+FeedClient::FeedClient(std::string const& address)
+: fd(connectToFeedAddress(address))
+{
+
+}
+
+FeedClient::~FeedClient()
+{
+    close(fd);
+}
+
+/** next tick of the feed, waiting for it to arrive */
+bool FeedClient::nextTick(Tick& tick, std::string& nextTimestamp)
+{
+    FeedFrameType type;
+    const char* payload;
+    size_t size;
+    while (true)
+    {
+        if (!receiver.nextFrame(type, payload, size))
+        {
+            if (receiver.receive(fd) == 0)
+            {
+                return false;
+            }
+            continue;
+        }
+        if (type != FeedFrameType::tick)
+            continue;
+
+        // orders are built straight from the frame inside the receive buffer
+        BinaryReader in{payload, size};
+        long long sequence = in.readInt();
+        tick.timestamp = in.readString();
+        nextTimestamp = in.readString();
+        std::vector<std::string> products(in.readInt());
+        for (std::string& p : products)
+        {
+            p = in.readString();
+        }
+        long long count = in.readInt();
+        tick.orders.clear();
+        tick.orders.reserve(count);
+        for (long long i = 0; i < count; ++i)
+        {
+            size_t product = in.readInt();
+            OrderBookType orderType = (OrderBookType)in.readInt();
+            Decimal price = Decimal::fromUnits(in.readInt());
+            Decimal amount = Decimal::fromUnits(in.readInt());
+            if (product >= products.size())
+            {
+                throw std::runtime_error{"FeedClient::nextTick bad product index"};
+            }
+            tick.orders.push_back(OrderBookEntry{price, amount, tick.timestamp, products[product], orderType});
+        }
+        unanswered[tick.timestamp] = {sequence, std::chrono::steady_clock::now()};
+        return true;
+    }
+}
+
+/** send the orders placed for a tick, all in one frame with a single write */
+void FeedClient::sendOrders(std::string const& timestamp, std::vector<OrderBookEntry> const& orders)
+{
+    auto it = unanswered.find(timestamp);
+    if (it == unanswered.end())
+    {
+        return;
+    }
+    BinaryWriter frame;
+    frame.writeInt(it->second.first);
+    frame.writeInt(orders.size());
+    for (OrderBookEntry const& order : orders)
+    {
+        frame.writeOrder(order);
+    }
+    sendBuffer.clear();
+    appendFrame(sendBuffer, FeedFrameType::orders, frame.buffer);
+
+    size_t sent = 0;
+    while (sent < sendBuffer.size())
+    {
+        ssize_t written = send(fd, sendBuffer.data() + sent, sendBuffer.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0)
+        {
+            if (written < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+        sent += written;
+    }
+    tickToOrder.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - it->second.second).count());
+    unanswered.erase(it);
+}
+
+/** latency from receiving a tick to sending its orders, measured inside the bot */
+void FeedClient::report(std::ostream& out) const
+{
+    tickToOrder.report(out, "Tick-to-order latency inside the bot");
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include "TickStream.h"
+#include "LatencyRecorder.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <iostream>
+#include <cstdint>
+
+/** frames exchanged between the feed server and a live bot
+ * every frame is a 4 byte payload length, a 1 byte type and the payload in the BinaryWriter layout */
+enum class FeedFrameType : uint8_t {tick = 1, orders = 2};
+
+/** socket addresses are "unix:<path>" for a Unix domain socket or "<host>:<port>" for TCP, meant for loopback */
+int listenOnFeedAddress(std::string const& address);
+int connectToFeedAddress(std::string const& address);
+
+/** receive buffer that frames are parsed from in place
+ * only the unfinished frame at the end of the buffer is ever moved */
+class FrameReceiver
+{
+    public:
+        FrameReceiver(size_t capacity = 1 << 20);
+
+        /** read what the socket has into the buffer
+         * returns the number of bytes read, 0 when the connection is closed and -1 when nothing is available yet */
+        long long receive(int fd);
+
+        /** the next complete frame, the payload points into the buffer and stays valid until the next receive */
+        bool nextFrame(FeedFrameType& type, const char*& payload, size_t& size);
+
+    private:
+        std::vector<char> buffer;
+        size_t begin = 0;
+        size_t end = 0;
+};
+
+/** replays dataset ticks to one live bot over a socket, paced by the dataset timestamps
+ * speed 1 replays in real time, 10 ten times faster and 0 as fast as possible
+ * ticks that are due together are sent with one write, and the bot's replies measure tick-to-order latency */
+class FeedServer
+{
+    public:
+        FeedServer(std::vector<std::string> _files, std::string _address, double _speed = 1.0);
+
+        /** wait for a bot to connect, replay the dataset and collect its replies, false on socket errors */
+        bool run();
+
+        /** ticks sent, writes used, orders received and tick-to-order latency */
+        void report(std::ostream& out) const;
+
+    private:
+        /** send the pending frames, reading replies whenever the socket is readable */
+        bool sendPending();
+
+        /** read and process the replies available, waiting up to timeoutMillis for the first one, false once the bot disconnected */
+        bool readReplies(int timeoutMillis);
+
+        std::vector<std::string> files;
+        std::string address;
+        double speed;
+        int clientFd = -1;
+
+        std::string pending;
+        std::vector<long long> pendingSequences;
+        FrameReceiver receiver;
+
+        // send time of every tick by sequence number, replies are matched against them
+        std::vector<std::chrono::steady_clock::time_point> sendTimes;
+        LatencyRecorder tickToOrder;
+        long long ticksSent = 0;
+        long long writes = 0;
+        long long repliesReceived = 0;
+        long long ordersReceived = 0;
+};
+
+/** live bot side of the feed: receives ticks and sends back the orders placed for each of them */
+class FeedClient
+{
+    public:
+        /** connect to a feed server, throws std::runtime_error when it cannot */
+        FeedClient(std::string const& address);
+        ~FeedClient();
+
+        FeedClient(FeedClient const&) = delete;
+        FeedClient& operator=(FeedClient const&) = delete;
+
+        /** next tick of the feed, waiting for it to arrive
+         * nextTimestamp is the timestamp of the following tick, empty on the last one
+         * returns false once the server has closed the connection */
+        bool nextTick(Tick& tick, std::string& nextTimestamp);
+
+        /** send the orders placed for a tick, all in one frame with a single write */
+        void sendOrders(std::string const& timestamp, std::vector<OrderBookEntry> const& orders);
+
+        /** latency from receiving a tick to sending its orders, measured inside the bot */
+        void report(std::ostream& out) const;
+
+    private:
+        int fd = -1;
+        FrameReceiver receiver;
+        std::string sendBuffer;
+
+        // sequence number and arrival time of the ticks that have not been answered yet
+        std::map<std::string, std::pair<long long, std::chrono::steady_clock::time_point>> unanswered;
+        LatencyRecorder tickToOrder;
+};
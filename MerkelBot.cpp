@@ -1,135 +1,1143 @@
 #include "MerkelBot.h"
+#include <algorithm>
 
 MerkelBot::MerkelBot()
+: datasetFiles{"20200317.csv"},
+  botUserId(orderBuilder.internUser("botuser")),
+  accountsUserId(orderBuilder.internUser("accounts"))
 {
 	
 }
 
+MerkelBot::MerkelBot(std::vector<std::string> _datasetFiles, bool _streaming)
+: datasetFiles(_datasetFiles),
+  streaming(_streaming),
+  botUserId(orderBuilder.internUser("botuser")),
+  accountsUserId(orderBuilder.internUser("accounts"))
+{
+
+}
+
+MerkelBot::MerkelBot(std::shared_ptr<const OrderBook> _dataset)
+: dataset(_dataset),
+  botUserId(orderBuilder.internUser("botuser")),
+  accountsUserId(orderBuilder.internUser("accounts"))
+{
+
+}
+
+/** override the strategy constants, call before init */
+void MerkelBot::setParameters(BotParameters const& _parameters)
+{
+    parameters = _parameters;
+}
+
 void MerkelBot::init() 
 {
-    std::cout << "Loading CSV file..." << std::endl;
+    if (verbose)
+        std::cout << "Loading CSV file..." << std::endl;
+
+    // this thread is the simulation stage of the pipeline
+    if (pipelined && !pinCurrentThreadToCore(simulationCore))
+    {
+        std::cout << "MerkelBot::init cannot pin the simulation stage to core " << simulationCore << std::endl;
+    }
 
     // starting high resolution clock to measure file loading time
     auto start1 = std::chrono::high_resolution_clock::now();
 
-    // initialize CSV Reader object
-    CSVReader csvReader{};
+    // a resumed run restores its state first, the dataset is then loaded from the checkpoint tick
+    if (resuming && !restoreCheckpoint())
+    {
+        std::cout << "MerkelBot::init cannot resume from " << checkpointPath << std::endl;
+        return;
+    }
+
+    // the regression the strategy was tuned with is model 0, a resumed run has its models from the checkpoint
+    if (!resuming)
+    {
+        std::vector<ForecastSpec> models{ForecastSpec{ForecastKind::regression, parameters.regressionWindow}};
+        models.insert(models.end(), parameters.predictionModels.begin(), parameters.predictionModels.end());
+        predictions.configure(parameters.predictionHorizon, models);
+    }
 
-    // read order book from the file
-    fullOrderBook = csvReader.readCSV("20200317.csv");
+    // read order book from the files, or start streaming them
+    loadDataset();
 
     // stopping high resolution clock to measure file loading time
     auto stop1 = std::chrono::high_resolution_clock::now();
     // extracting duration and logging to console
     auto duration1 = std::chrono::duration_cast<std::chrono::microseconds>(stop1 - start1);
-    std::cout << "Data load completed successfully in " << duration1.count() << " microseconds" << std::endl;
+    if (verbose)
+        std::cout << "Data load completed successfully in " << duration1.count() << " microseconds" << std::endl;
+
+    if (allTimestamps.empty())
+    {
+        std::cout << "MerkelBot::init no data in the dataset files" << std::endl;
+        return;
+    }
+
+    // log files are left closed when logging is off, writes to them are then ignored
+    openLogs();
+    if (logging && !resuming)
+    {
+        // write file headers for the bot orders
+        botActiveOrdersLog << "Timestamp,Order ID,Product,Order Price,Predicted Price,Min Ask Price,";
+        botActiveOrdersLog << "Max Bid Price,Amount,Corresponding_Amount,Order_Type,Username,Status" << std::endl;
+        botCancelledOrdersLog << "Timestamp,Order ID, Product,Order Price,Predicted Price,Min Ask Price,";
+        botCancelledOrdersLog << "Max Bid Price,Amount,Corresponding_Amount,Order_Type,Username,Status" << std::endl;
+
+        // write file header for the bot sales
+        botSalesLog << "Timestamp,Order ID, Product,Price,Order_Type,Amount,Currency_1,Corresponding_Amount,Currency_2,";
+        botSalesLog << "Max_Bid_Price,Min_Ask_Price,Average_Price" << std::endl;
+    }
+
+    // balance changes are recorded from here on, a resumed run starts with a snapshot of the restored wallets
+    if (!ledgerPath.empty())
+    {
+        try
+        {
+            ledger.reset(new AssetLedgerWriter{ledgerPath, ledgerSnapshotInterval, resuming ? resumeLedgerOffset : -1,
+                                               resuming ? resumeLedgerIndexOffset : -1});
+            currentTime = allTimestamps[warmupStartTick];
+            beginLedgerTick(resuming);
+            botAssets.setLedger(ledger.get());
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "MerkelBot::init " << e.what() << std::endl;
+            ledger.reset();
+        }
+    }
+
+    // initialzing wallets and standard order amounts, a resumed run has them from the checkpoint
+    if (!resuming)
+    {
+        botAssets.addFunds(parameters.initialFunds);
+        botAssets.setStandardOrderAmounts(parameters.standardOrderFraction);
+    }
+
+    // the accounts are funded like the bot, each with a small share of its funds
+    if (accountCount > 0 && !resuming)
+    {
+        if (continuousMatching)
+        {
+            std::cout << "MerkelBot::init accounts are simulated with batch matching only" << std::endl;
+        }
+        else
+        {
+            accounts.createAccounts(accountCount, parameters.initialFunds, accountSeed);
+        }
+    }
+
+    // from here on the valuation follows every balance and price change, restored prices included
+    botAssets.setValuation(&valuation);
+    for (size_t k = 0; k < allProducts.size(); ++k)
+    {
+        auto price = avgCurrentPrices.find(allProducts[k]);
+        if (price != avgCurrentPrices.end())
+        {
+            valuation.setPrice(valuationProductIds[k], price->second);
+        }
+    }
+
+    // other processes follow the bot through shared memory
+    if (!sharedMemoryName.empty())
+    {
+        try
+        {
+            sharedMarket.reset(new SharedMarketPublisher{sharedMemoryName});
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "MerkelBot::init " << e.what() << std::endl;
+        }
+    }
+
+    // checkpoints are serialized here and written to disk on a background thread
+    if (checkpointInterval > 0)
+    {
+        checkpointWriter.reset(new CheckpointWriter{checkpointPath});
+    }
+
+    // iterating through timestamp values until we reaches the end, so we are stopping at latestTimestamp
+    // or at the end of the tick range when only a slice of the timeline is replayed
+    for (size_t i = warmupStartTick; i < tradeEndTick && hasNextTimestamp(i); ++i)
+    {   
+        currentTime = allTimestamps[i];
+        beginLedgerTick();
+
+        // extract current timestamp data by product
+        splitDataByProduct();
+
+        // warm-up ticks only build the price history, the bot does not trade yet
+        if (i < tradeStartTick)
+        {
+            getMarketPrices();
+            addToPriceHistory();
+            sendLiveOrders();
+            streamedOrders.erase(currentTime);
+            tickVersions.erase(currentTime);
+            continue;
+        }
+
+        // run all bot operations related to current timestamp: cancel orders, place asks/bids
+        processBotActions();
+        sendLiveOrders();
+
+        // value at the start of trading, new orders only move funds to the reserved wallet
+        if (i == tradeStartTick && !resuming)
+        {
+            initialTotalAssetsUSD = computeTotalAssetsUSD();
+            metrics.start(initialTotalAssetsUSD);
+            accountsInitialUSD = accounts.valueOf(valuation);
+        }
+
+        // writing to assets log
+        botAssetsLog << "Timestamp: " << currentTime << std::endl;
+        botAssetsLog << "Before processing sales: " << std::endl;
+        botAssetsLog << "========================= " << std::endl;
+        botAssets.logAssets(botAssetsLog);
+
+        // update split of current data by product to include the bot actions
+        splitDataByProduct();
+
+        // match asks to bids and log sales, move active bot users to next period
+        if (continuousMatching)
+        {
+            runContinuousSales(i);
+        }
+        else
+        {
+            auto matchStart = std::chrono::high_resolution_clock::now();
+            runMarketSales(i);
+            auto matchStop = std::chrono::high_resolution_clock::now();
+            if (latencyReport)
+            {
+                matchLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(matchStop - matchStart).count());
+            }
+        }
+
+        // writing to assets log
+        botAssetsLog << "After processing sales: " << std::endl;
+        botAssetsLog << "========================= " << std::endl;
+
+        // writing to assets log
+        botAssets.logAssets(botAssetsLog);
+        logTotalAssetsUSD(botAssetsLog);
+        logSalesImpact(botAssetsLog);     
+        metrics.onMark(currentTime, holdingsUSD());
+        publishSharedMarket();
+
+        // orders are released once processed, carryovers already moved to the next tick
+        botOrders.erase(currentTime);
+        streamedOrders.erase(currentTime);
+        tickVersions.erase(currentTime);
+        flushLogs();
+
+        ticksProcessed++;
+        if (checkpointWriter && ticksProcessed % checkpointInterval == 0)
+        {
+            writeCheckpoint(allTimestamps[i + 1]);
+        }
+    } 
+
+    // the last timestamp belongs to this run only if the tick range reaches the end of the dataset
+    if (tradeEndTick >= allTimestamps.size() - 1)
+    {
+        currentTime = allTimestamps[allTimestamps.size() - 1];
+        beginLedgerTick();
+
+        // process bot operations for last timestamp
+        processBotActions();
+        sendLiveOrders();
+        publishSharedMarket();
+        // writing to assets log
+        botAssetsLog << "Timestamp: " << currentTime << std::endl;
+        botAssets.logAssets(botAssetsLog);
+    }
+
+    // close log files once the log writer has written everything
+    flushLogs();
+    if (pipelined && verbose)
+    {
+        if (tickIngest)
+            tickIngest->report(std::cout);
+        if (logWriter)
+            logWriter->report(std::cout);
+    }
+    logWriter.reset();
+    tickIngest.reset();
+    if (feedClient && verbose)
+    {
+        feedClient->report(std::cout);
+    }
+    feedClient.reset();
+
+    // wait for the last checkpoint to reach the disk
+    checkpointWriter.reset();
+
+    if (ledger && verbose)
+    {
+        ledger->report(std::cout);
+    }
+    botAssets.setLedger(nullptr);
+    ledger.reset();
+
+    sharedMarket.reset();
+
+    if (tickStore && verbose)
+    {
+        size_t orders = tickStore->orderCount();
+        std::cout << "Compressed tick storage: " << orders << " dataset orders of " << tickStore->tickCount() << " ticks in "
+                  << tickStore->bytes() << " bytes, " << (orders > 0 ? (double)tickStore->bytes() / orders : 0)
+                  << " bytes per order" << std::endl;
+    }
+
+    if (continuousMatching && incrementalBook && verbose)
+    {
+        std::cout << "Incremental books: " << snapshotOrdersSeen << " snapshot orders replayed as "
+                  << levelUpdatesApplied << " level updates" << std::endl;
+    }
+
+    if (compactLevels && verbose && datasetOrdersLoaded > 0)
+    {
+        std::cout << "Price level compaction: " << datasetOrdersLoaded << " dataset orders merged into "
+                  << datasetLevelsLoaded << " price levels" << std::endl;
+    }
+
+    if (candles && logging)
+    {
+        for (int r : candles->getResolutions())
+        {
+            std::ofstream candleFile{logPath("BotCandles" + std::to_string(r) + "s.csv")};
+            candles->logCandles(candleFile, r);
+        }
+    }
+
+    // metrics of the whole run, with the series if one was kept
+    if (logging)
+    {
+        std::ofstream summaryFile{logPath("BotMetricsSummary.txt")};
+        metrics.writeSummary(summaryFile);
+        if (metricsSeriesInterval > 0)
+        {
+            std::ofstream seriesFile{logPath("BotMetricsSeries.csv")};
+            metrics.writeSeries(seriesFile);
+        }
+    }
+    if (verbose)
+    {
+        metrics.writeSummary(std::cout);
+    }
+
+    if (verbose && accounts.accountCount() > 0)
+    {
+        accounts.report(std::cout);
+        std::cout << "Accounts total assets USD: initial " << accountsInitialUSD << ", final "
+                  << accounts.valueOf(valuation) << std::endl;
+    }
+
+    if (verbose)
+    {
+        predictions.report(std::cout);
+        std::cout << "Unchanged products reused: matching " << matchesReused << " of "
+                  << matchesReused + matchesRun << std::endl;
+    }
+
+    if (latencyReport)
+    {
+        matchLatency.report(std::cout, continuousMatching ? "Matching latency per order event" : "Matching latency per tick");
+        if (publishLatency.count() > 0)
+        {
+            publishLatency.report(std::cout, "Shared memory publishing per tick");
+        }
+    }
+}
+
+/** match every order as an event against persistent per-product books instead of once per tick */
+void MerkelBot::setContinuousMatching(bool _continuous)
+{
+    continuousMatching = _continuous;
+}
+
+/** drive the dataset side of the continuous books with level updates between consecutive snapshots */
+void MerkelBot::setIncrementalBook(bool _incremental)
+{
+    incrementalBook = _incremental;
+}
+
+/** print matching latency percentiles at the end of the run */
+void MerkelBot::setLatencyReport(bool _latencyReport)
+{
+    latencyReport = _latencyReport;
+}
+
+/** merge dataset orders of a tick with the same product, side and price into one price level as they are loaded */
+void MerkelBot::setPriceLevelCompaction(bool _compact)
+{
+    compactLevels = _compact;
+}
+
+/** build candles per product at these resolutions in seconds, none turns them off */
+void MerkelBot::setCandles(std::vector<int> resolutionsSeconds)
+{
+    resolutionsSeconds.erase(std::remove_if(resolutionsSeconds.begin(), resolutionsSeconds.end(), [](int r) { return r <= 0; }),
+                             resolutionsSeconds.end());
+    if (resolutionsSeconds.empty())
+        candles.reset();
+    else
+        candles = std::make_unique<CandleEngine>(resolutionsSeconds);
+}
+
+/** keep the dataset files delta encoded and bit-packed in memory instead of as an order book */
+void MerkelBot::setTickCompression(bool _compress)
+{
+    compressTicks = _compress;
+}
+
+/** record the balance changes to a binary ledger at this path with a full snapshot every snapshotInterval ticks */
+void MerkelBot::setLedger(std::string path, int snapshotInterval)
+{
+    ledgerPath = path;
+    ledgerSnapshotInterval = snapshotInterval;
+}
+
+/** start the current tick in the ledger */
+void MerkelBot::beginLedgerTick(bool forceSnapshot)
+{
+    if (ledger)
+    {
+        ledger->beginTick(currentTime,
+                          botAssets.standardWallet.currencies,
+                          botAssets.reservedWallet.currencies,
+                          botAssets.totalAssets.currencies,
+                          forceSnapshot);
+    }
+}
+
+/** simulate this many retail accounts trading against the same market as the bot */
+void MerkelBot::setAccounts(size_t count, unsigned seed)
+{
+    accountCount = count;
+    accountSeed = seed;
+}
+
+/** rolling window of the Sharpe and Sortino ratios and interval of the metrics series, in ticks */
+void MerkelBot::setMetrics(int window, int seriesInterval)
+{
+    metrics = StrategyMetrics{window, seriesInterval};
+    metricsSeriesInterval = seriesInterval;
+}
+
+/** write a checkpoint every everyTicks processed ticks to this file, 0 turns checkpoints off */
+void MerkelBot::setCheckpointing(std::string path, int everyTicks)
+{
+    checkpointPath = path;
+    checkpointInterval = std::max(everyTicks, 0);
+}
+
+/** continue from the checkpoint file instead of starting from the first tick */
+void MerkelBot::setResume(std::string path)
+{
+    checkpointPath = path;
+    resuming = true;
+}
+
+/** serialize everything needed to continue at nextTimestamp and hand it to the background writer */
+void MerkelBot::writeCheckpoint(std::string const& nextTimestamp)
+{
+    // the logs must hold everything up to this tick, a resumed run truncates them back to here
+    flushLogs();
+    if (logWriter)
+    {
+        logWriter->flush();
+    }
 
-    // copy vector of timestamps to class variable
-    for (auto const& e : fullOrderBook.timestamps)
+    BinaryWriter out;
+    out.writeString("MerkelBotCheckpoint");
+    out.writeInt(7);
+    out.writeString(nextTimestamp);
+    out.writeInt(ticksProcessed);
+
+    out.writeInt(parameters.regressionWindow);
+    out.writeInt(parameters.predictionHorizon);
+    out.writeDouble(parameters.standardOrderFraction);
+    out.writeMap(parameters.initialFunds);
+    out.writeInt(parameters.predictionBlend.size());
+    for (std::pair<int, double> const& w : parameters.predictionBlend)
+    {
+        out.writeInt(w.first);
+        out.writeDouble(w.second);
+    }
+
+    out.writeInt(allProducts.size());
+    for (std::string const& p : allProducts)
+    {
+        out.writeString(p);
+    }
+
+    out.writeMap(botAssets.standardWallet.currencies);
+    out.writeMap(botAssets.reservedWallet.currencies);
+    out.writeMap(botAssets.totalAssets.currencies);
+    out.writeMap(botAssets.standardOrderAmount);
+
+    // resting bot orders are the carryovers already moved to the next tick
+    std::vector<OrderBookEntry>& restingOrders = botOrders[nextTimestamp];
+    out.writeInt(restingOrders.size());
+    for (OrderBookEntry const& order : restingOrders)
+    {
+        out.writeOrder(order);
+    }
+
+    predictions.save(out);
+
+    out.writeMap(maxBidPrices);
+    out.writeMap(minAskPrices);
+    out.writeMap(avgCurrentPrices);
+    out.writeMap(pricePrediction);
+    out.writeMap(salesImpactOnAssets);
+
+    out.writeInt(botOrderIDTracker);
+    out.writeInt(fillCount);
+    out.writeDouble(initialTotalAssetsUSD);
+    out.writeDouble(lastTotalAssetsUSD);
+    metrics.save(out);
+    out.writeInt(candles ? 1 : 0);
+    if (candles)
+    {
+        candles->save(out);
+    }
+    accounts.save(out);
+    out.writeInt(accountOrderIDTracker);
+    out.writeDouble(accountsInitialUSD);
+    out.writeInt(ledger ? ledger->position() : -1);
+    out.writeInt(ledger ? ledger->indexPosition() : -1);
+
+    // log sizes, -1 when logging is off
+    for (size_t i = 0; i < 4; ++i)
+    {
+        out.writeInt(logWriter ? logWriter->position(i) : -1);
+    }
+
+    checkpointWriter->submit(std::move(out.buffer));
+}
+
+/** candle resolutions as given to --candles, none for no candles */
+static std::string joinResolutions(std::vector<int> const& resolutions)
+{
+    if (resolutions.empty())
+    {
+        return "none";
+    }
+    std::string joined;
+    for (int r : resolutions)
+    {
+        joined += (joined.empty() ? "" : ",") + std::to_string(r);
+    }
+    return joined;
+}
+
+/** read the checkpoint file back into the bot state, false if it is missing or damaged */
+bool MerkelBot::restoreCheckpoint()
+{
+    std::string bytes;
+    if (!CheckpointWriter::load(checkpointPath, bytes))
+    {
+        return false;
+    }
+    try
+    {
+        BinaryReader in{bytes};
+        if (in.readString() != "MerkelBotCheckpoint" || in.readInt() != 7)
+        {
+            return false;
+        }
+        resumeTimestamp = in.readString();
+        ticksProcessed = in.readInt();
+
+        parameters.regressionWindow = in.readInt();
+        parameters.predictionHorizon = in.readInt();
+        parameters.standardOrderFraction = in.readDouble();
+        parameters.initialFunds = in.readMap();
+        parameters.predictionBlend.clear();
+        long long blendSize = in.readInt();
+        for (long long i = 0; i < blendSize; ++i)
+        {
+            int model = in.readInt();
+            parameters.predictionBlend.push_back({model, in.readDouble()});
+        }
+
+        long long productCount = in.readInt();
+        for (long long i = 0; i < productCount; ++i)
+        {
+            addProduct(in.readString());
+        }
+
+        botAssets.standardWallet.currencies = in.readMap();
+        botAssets.reservedWallet.currencies = in.readMap();
+        botAssets.totalAssets.currencies = in.readMap();
+        botAssets.standardOrderAmount = in.readMap();
+
+        long long orderCount = in.readInt();
+        for (long long i = 0; i < orderCount; ++i)
+        {
+            botOrders[resumeTimestamp].push_back(in.readOrder());
+        }
+
+        predictions.restore(in);
+
+        maxBidPrices = in.readMap();
+        minAskPrices = in.readMap();
+        avgCurrentPrices = in.readMap();
+        pricePrediction = in.readMap();
+        salesImpactOnAssets = in.readMap();
+
+        botOrderIDTracker = in.readInt();
+        fillCount = in.readInt();
+        initialTotalAssetsUSD = in.readDouble();
+        lastTotalAssetsUSD = in.readDouble();
+        metrics.restore(in);
+        // the stored candles are continued, so the run must ask for the resolutions they were built with
+        std::vector<int> checkpointed;
+        CandleEngine stored;
+        if (in.readInt() == 1)
+        {
+            stored.restore(in);
+            checkpointed = stored.getResolutions();
+        }
+        std::vector<int> configured = candles ? candles->getResolutions() : std::vector<int>{};
+        if (configured != checkpointed)
+        {
+            throw std::runtime_error{"candle resolutions " + joinResolutions(configured) + " differ from the checkpoint's "
+                                     + joinResolutions(checkpointed) + ", resume "
+                                     + (checkpointed.empty() ? "without --candles" : "with --candles " + joinResolutions(checkpointed))};
+        }
+        if (candles)
+        {
+            *candles = std::move(stored);
+        }
+        accounts.restore(in);
+        accountOrderIDTracker = in.readInt();
+        accountsInitialUSD = in.readDouble();
+        resumeLedgerOffset = in.readInt();
+        resumeLedgerIndexOffset = in.readInt();
+
+        resumeLogOffsets.clear();
+        for (int i = 0; i < 4; ++i)
+        {
+            resumeLogOffsets.push_back(in.readInt());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "MerkelBot::restoreCheckpoint " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/** open the log files, cut back to their size at the checkpoint when resuming */
+void MerkelBot::openLogs()
+{
+    if (!logging)
+    {
+        // writes to a failed stream are dropped without formatting
+        botAssetsLog.setstate(std::ios::badbit);
+        botActiveOrdersLog.setstate(std::ios::badbit);
+        botCancelledOrdersLog.setstate(std::ios::badbit);
+        botSalesLog.setstate(std::ios::badbit);
+        return;
+    }
+    // the ledger holds the balances instead
+    if (!ledgerPath.empty())
+    {
+        botAssetsLog.setstate(std::ios::badbit);
+    }
+    // same order as the log offsets in the checkpoint
+    std::vector<std::string> paths = {logPath("BotAssetsLog.txt"), logPath("BotActiveOrdersLog.csv"),
+                                      logPath("BotCancelledOrdersLog.csv"), logPath("BotSalesLog.csv")};
+    std::vector<long long> offsets;
+    if (resuming)
+    {
+        offsets = resumeLogOffsets;
+    }
+    logWriter.reset(new LogWriter{paths, offsets, pipelined, 64, logCore});
+}
+
+/** hand the logs of the current tick over to the log writer */
+void MerkelBot::flushLogs()
+{
+    if (!logWriter)
+    {
+        return;
+    }
+    std::vector<std::string> texts = {botAssetsLog.str(), botActiveOrdersLog.str(),
+                                      botCancelledOrdersLog.str(), botSalesLog.str()};
+    botAssetsLog.str("");
+    botActiveOrdersLog.str("");
+    botCancelledOrdersLog.str("");
+    botSalesLog.str("");
+    logWriter->write(texts);
+}
+
+/** take the ticks from a feed server at this address instead of the dataset files and send the bot orders back */
+void MerkelBot::setLiveFeed(std::string address)
+{
+    liveFeedAddress = address;
+}
+
+/** send the orders placed at the current tick to the feed server */
+void MerkelBot::sendLiveOrders()
+{
+    if (!feedClient)
+    {
+        return;
+    }
+    std::vector<OrderBookEntry> placed;
+    auto orders = botOrders.find(currentTime);
+    if (orders != botOrders.end())
+    {
+        for (OrderBookEntry const& order : orders->second)
+        {
+            if (order.orderStatus == "initial")
+            {
+                placed.push_back(order);
+            }
+        }
+    }
+    feedClient->sendOrders(currentTime, placed);
+}
+
+/** publish prices, predictions and balances of every tick to the shared memory object with this name */
+void MerkelBot::setSharedMemory(std::string name)
+{
+    sharedMemoryName = name;
+}
+
+/** publish the state of the current tick to shared memory */
+void MerkelBot::publishSharedMarket()
+{
+    if (!sharedMarket)
+    {
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // the snapshot is written in place, readers retry until it is complete
+    SharedMarketSnapshot& snapshot = sharedMarket->beginUpdate();
+    SharedMarketSnapshot::setName(snapshot.timestamp, currentTime);
+    snapshot.tick = ticksProcessed;
+    snapshot.productCount = 0;
+    for (std::string const& p : allProducts)
+    {
+        if (snapshot.productCount == SharedMarketSnapshot::maxProducts)
+            break;
+        SharedQuote& quote = snapshot.quotes[snapshot.productCount++];
+        SharedMarketSnapshot::setName(quote.product, p);
+        quote.bestBid = maxBidPrices[p];
+        quote.bestAsk = minAskPrices[p];
+        quote.mid = avgCurrentPrices[p];
+        quote.prediction = pricePrediction[p];
+    }
+
+    // wallets only hold the currencies they have been given, missing ones are 0
+    auto balance = [](Wallet const& wallet, std::string const& currency)
+    {
+        auto it = wallet.currencies.find(currency);
+        return it == wallet.currencies.end() ? 0.0 : it->second;
+    };
+    snapshot.currencyCount = 0;
+    for (auto const& e : botAssets.totalAssets.currencies)
+    {
+        if (snapshot.currencyCount == SharedMarketSnapshot::maxCurrencies)
+            break;
+        SharedBalance& b = snapshot.balances[snapshot.currencyCount++];
+        SharedMarketSnapshot::setName(b.currency, e.first);
+        b.available = balance(botAssets.standardWallet, e.first);
+        b.reserved = balance(botAssets.reservedWallet, e.first);
+        b.total = e.second;
+    }
+    snapshot.totalAssetsUSD = lastTotalAssetsUSD;
+    sharedMarket->endUpdate();
+
+    if (latencyReport)
+    {
+        auto stop = std::chrono::high_resolution_clock::now();
+        publishLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    }
+}
+
+/** run ingest, simulation and log writing as a pipeline of three threads, the dataset is streamed */
+void MerkelBot::setPipelining(bool _pipelined, int _ingestCore, int _simulationCore, int _logCore)
+{
+    pipelined = _pipelined;
+    ingestCore = _ingestCore;
+    simulationCore = _simulationCore;
+    logCore = _logCore;
+}
+
+/** write the logs to this directory instead of the working directory */
+void MerkelBot::setOutputDirectory(std::string directory)
+{
+    outputDirectory = directory;
+}
+
+/** replay only part of the timeline of a loaded dataset
+ * ticks from warmupStart build the price history, ticks from tradeStart up to tradeEnd (excluded) are traded */
+void MerkelBot::setTickRange(size_t warmupStart, size_t tradeStart, size_t tradeEnd)
+{
+    warmupStartTick = warmupStart;
+    tradeStartTick = std::max(tradeStart, warmupStart);
+    tradeEndTick = tradeEnd;
+}
+
+/** turn the log files on or off */
+void MerkelBot::setLogging(bool _logging)
+{
+    logging = _logging;
+}
+
+/** turn the console progress messages on or off */
+void MerkelBot::setVerbose(bool _verbose)
+{
+    verbose = _verbose;
+}
+
+/** path of a log file inside the output directory */
+std::string MerkelBot::logPath(std::string const& filename) const
+{
+    if (outputDirectory.empty())
+    {
+        return filename;
+    }
+    return outputDirectory + "/" + filename;
+}
+
+/** total value of the bot assets in USD at the last processed tick */
+double MerkelBot::getTotalAssetsUSD() const
+{
+    return lastTotalAssetsUSD;
+}
+
+/** total value of the bot assets in USD at the first tick */
+double MerkelBot::getInitialAssetsUSD() const
+{
+    return initialTotalAssetsUSD;
+}
+
+/** number of sales the bot took part in */
+int MerkelBot::getFillCount() const
+{
+    return fillCount;
+}
+
+/** number of orders the bot placed */
+int MerkelBot::getOrderCount() const
+{
+    return botOrderIDTracker - 1;
+}
+
+/** load the dataset files, or start streaming them */
+void MerkelBot::loadDataset()
+{
+    // initialize CSV Reader object
+    CSVReader csvReader{};
+
+    // a live run has no files, the first tick comes from the feed server
+    if (!liveFeedAddress.empty())
+    {
+        try
+        {
+            feedClient.reset(new FeedClient{liveFeedAddress});
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "MerkelBot::loadDataset " << e.what() << std::endl;
+            return;
+        }
+        loadNextTick();
+        return;
+    }
+
+    // a resumed run always loads the dataset, so it can start at the checkpoint tick
+    if (pipelined && !resuming)
+    {
+        tickIngest.reset(new TickIngest{datasetFiles, 64, ingestCore});
+        loadNextTick();
+        return;
+    }
+    if (streaming && !resuming)
+    {
+        tickStream.reset(new TickStream{datasetFiles});
+        // the first tick is needed up front, the rest follow as the simulation runs
+        loadNextTick();
+        return;
+    }
+
+    // the compressed store holds the whole dataset, so a resumed run loads it as well
+    if (compressTicks && !dataset)
+    {
+        loadCompressedDataset();
+    }
+    // read order book from the file(s), unless it was handed over already loaded
+    else if (!dataset)
+    {
+        std::shared_ptr<OrderBook> loaded;
+        if (datasetFiles.size() == 1 && resuming)
+        {
+            // only the part of the file from the checkpoint tick onwards is parsed
+            loaded = std::make_shared<OrderBook>(csvReader.readCSVMapped(datasetFiles[0], resumeTimestamp));
+        }
+        else if (datasetFiles.size() == 1)
+        {
+            loaded = std::make_shared<OrderBook>(csvReader.readCSV(datasetFiles[0]));
+        }
+        else
+        {
+            loaded = std::make_shared<OrderBook>(csvReader.readCSVFiles(datasetFiles));
+        }
+
+        // compacted before it becomes read only
+        if (compactLevels)
+        {
+            for (auto const& tick : loaded->ordersByTimestamp)
+            {
+                datasetOrdersLoaded += tick.second.size();
+            }
+            datasetLevelsLoaded = datasetOrdersLoaded - loaded->compactPriceLevels();
+        }
+        dataset = loaded;
+    }
+
+    if (dataset)
+    {
+        // copy vector of timestamps to class variable, orders stay in the shared order book
+        for (auto const& e : dataset->timestamps)
+        {
+            allTimestamps.push_back(e);
+        }
+
+        // copy vectof of products to class variable
+        for (auto const& e : dataset->products)
+        {
+            addProduct(e);
+        }
+    }
+
+    // a resumed run starts at the checkpoint tick, earlier ticks are not replayed
+    if (resuming)
+    {
+        warmupStartTick = std::lower_bound(allTimestamps.begin(), allTimestamps.end(), resumeTimestamp) - allTimestamps.begin();
+        tradeStartTick = warmupStartTick;
+    }
+}
+
+/** stream the dataset files into the compressed store, tick by tick, so the order book is never built */
+void MerkelBot::loadCompressedDataset()
+{
+    tickStore.reset(new CompressedTickStore{});
+    // the versions of every tick are kept as the changes of each product, looked up by tick position
+    productVersions = ProductVersions{true};
+    TickStream stream{datasetFiles};
+    Tick tick;
+    while (stream.nextTick(tick))
+    {
+        for (OrderBookEntry const& obe : tick.orders)
+        {
+            addProduct(obe.product);
+        }
+        compactTick(tick.orders);
+        productVersions.addTick(tick.orders);
+        tickStore->addTick(tick.timestamp, tick.orders);
+        allTimestamps.push_back(tick.timestamp);
+    }
+    tickStore->finish();
+}
+
+/** add a product to the sorted list of known products if it is new */
+void MerkelBot::addProduct(std::string const& product)
+{
+    auto it = std::lower_bound(allProducts.begin(), allProducts.end(), product);
+    if (it == allProducts.end() || *it != product)
+    {
+        // the product ID for the order builder sits at the same position
+        allProductIds.insert(allProductIds.begin() + (it - allProducts.begin()), orderBuilder.internProduct(product));
+        valuationProductIds.insert(valuationProductIds.begin() + (it - allProducts.begin()), valuation.addProduct(product));
+        predictionProductIds.insert(predictionProductIds.begin() + (it - allProducts.begin()), predictions.addProduct(product));
+        allProducts.insert(it, product);
+    }
+}
+
+/** dataset orders for a timestamp, from the loaded order book, the compressed store or the stream */
+const std::vector<OrderBookEntry>& MerkelBot::datasetOrders(std::string const& timestamp) const
+{
+    static const std::vector<OrderBookEntry> noOrders;
+    if (tickStore)
+    {
+        long long index = tickStore->find(timestamp);
+        return index < 0 ? noOrders : tickStore->tick(index);
+    }
+    const std::map<std::string,std::vector<OrderBookEntry>>& source = dataset ? dataset->ordersByTimestamp : streamedOrders;
+    auto it = source.find(timestamp);
+    if (it == source.end())
+    {
+        return noOrders;
+    }
+    return it->second;
+}
+
+/** version of the dataset orders of a product at the current time, 0 if unknown */
+unsigned long long MerkelBot::datasetVersion(std::string const& product) const
+{
+    // a loaded or compressed dataset numbered its ticks up front, streamed ticks carry their versions
+    if (dataset)
+    {
+        auto position = std::lower_bound(dataset->timestamps.begin(), dataset->timestamps.end(), currentTime);
+        if (position == dataset->timestamps.end() || *position != currentTime)
+        {
+            return 0;
+        }
+        return dataset->productVersion(product, position - dataset->timestamps.begin());
+    }
+    if (tickStore)
     {
-        allTimestamps.push_back(e);
-        orders[e] = fullOrderBook.ordersByTimestamp[e];
+        long long position = tickStore->find(currentTime);
+        return position < 0 ? 0 : productVersions.version(product, position);
     }
-
-    // copy vectof of products to class variable
-    for (auto const& e : fullOrderBook.products)
+    auto tick = tickVersions.find(currentTime);
+    if (tick == tickVersions.end())
     {
-        allProducts.push_back(e);
+        return 0;
     }
+    auto it = tick->second.find(product);
+    return it == tick->second.end() ? 0 : it->second;
+}
 
-    // Assign file to filestream object for logging bot assets
-    botAssetsLog.open("BotAssetsLog.txt");
-
-    // Assign file to filestream object for logging bot orders and write file header
-    botActiveOrdersLog.open("BotActiveOrdersLog.csv");
-    botActiveOrdersLog << "Timestamp,Order ID,Product,Order Price,Predicted Price,Min Ask Price,";
-    botActiveOrdersLog << "Max Bid Price,Amount,Corresponding_Amount,Order_Type,Username,Status" << std::endl;
-
-    botCancelledOrdersLog.open("BotCancelledOrdersLog.csv");
-    botCancelledOrdersLog << "Timestamp,Order ID, Product,Order Price,Predicted Price,Min Ask Price,";
-    botCancelledOrdersLog << "Max Bid Price,Amount,Corresponding_Amount,Order_Type,Username,Status" << std::endl;
-
-    // Assign file to filestream object for logging bot sales
-    botSalesLog.open("BotSalesLog.csv");
-    botSalesLog << "Timestamp,Order ID, Product,Price,Order_Type,Amount,Currency_1,Corresponding_Amount,Currency_2,";
-    botSalesLog << "Max_Bid_Price,Min_Ask_Price,Average_Price" << std::endl;
-
-    // initialzing wallets and standard order amounts
-    botAssets.addFunds();
-    botAssets.setStandardOrderAmounts();
-
-    // iterating through timestamp values until we reaches the end, so we are stopping at latestTimestamp
-    for (int i = 0; i < allTimestamps.size() - 1; ++i)
-    {   
-        currentTime = allTimestamps[i];
-
-        // extract current timestamp data by product
-        splitDataByProduct(orders[currentTime]);
-
-        // run all bot operations related to current timestamp: cancel orders, place asks/bids
-        processBotActions();
-
-        // writing to assets log
-        botAssetsLog << "Timestamp: " << currentTime << std::endl;
-        botAssetsLog << "Before processing sales: " << std::endl;
-        botAssetsLog << "========================= " << std::endl;
-        botAssets.logAssets(botAssetsLog);
-
-        // update split of current data by product to include the bot actions
-        splitDataByProduct(orders[currentTime]);
-
-        // match asks to bids and log sales, move active bot users to next period
-        runMarketSales(i);
-
-        // writing to assets log
-        botAssetsLog << "After processing sales: " << std::endl;
-        botAssetsLog << "========================= " << std::endl;
+/** pull the next tick from the stream into the streamed orders, false at the end of the stream */
+bool MerkelBot::loadNextTick()
+{
+    Tick tick;
+    bool loaded = false;
+    if (feedClient)
+    {
+        // each tick of the feed announces the timestamp of the next one
+        std::string nextTimestamp;
+        try
+        {
+            loaded = feedClient->nextTick(tick, nextTimestamp);
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "MerkelBot::loadNextTick " << e.what() << std::endl;
+        }
+        if (!loaded)
+        {
+            return false;
+        }
+        for (OrderBookEntry const& obe : tick.orders)
+        {
+            addProduct(obe.product);
+        }
+        if (allTimestamps.empty())
+        {
+            allTimestamps.push_back(tick.timestamp);
+        }
+        if (!nextTimestamp.empty())
+        {
+            allTimestamps.push_back(nextTimestamp);
+        }
+        compactTick(tick.orders);
+        productVersions.addTick(tick.orders);
+        tickVersions[tick.timestamp] = productVersions.current();
+        streamedOrders[tick.timestamp] = std::move(tick.orders);
+        liveTicksReceived++;
+        return true;
+    }
+    if (tickIngest)
+    {
+        loaded = tickIngest->nextTick(tick);
+    }
+    else if (tickStream)
+    {
+        loaded = tickStream->nextTick(tick);
+    }
+    if (!loaded)
+    {
+        return false;
+    }
 
-        // writing to assets log
-        botAssets.logAssets(botAssetsLog);
-        logTotalAssetsUSD(botAssetsLog);
-        logSalesImpact(botAssetsLog);     
-    } 
+    // products are discovered as they appear, kept sorted as in the full load
+    for (OrderBookEntry const& obe : tick.orders)
+    {
+        addProduct(obe.product);
+    }
 
-    currentTime = allTimestamps[allTimestamps.size() - 1];
+    compactTick(tick.orders);
+    productVersions.addTick(tick.orders);
+    tickVersions[tick.timestamp] = productVersions.current();
+    streamedOrders[tick.timestamp] = std::move(tick.orders);
+    allTimestamps.push_back(tick.timestamp);
+    return true;
+}
 
-    // process bot operations for last timestamp
-    processBotActions();
-    // writing to assets log
-    botAssetsLog << "Timestamp: " << currentTime << std::endl;
-    botAssets.logAssets(botAssetsLog);
+/** compact the price levels of one tick of streamed orders and count them */
+void MerkelBot::compactTick(std::vector<OrderBookEntry>& orders)
+{
+    if (!compactLevels)
+    {
+        return;
+    }
+    datasetOrdersLoaded += orders.size();
+    OrderBook::compactPriceLevels(orders);
+    datasetLevelsLoaded += orders.size();
+}
 
-    // close log files
-    botActiveOrdersLog.close();
-    botAssetsLog.close();
-    botSalesLog.close();
+/** check that a timestamp follows period i, streaming it in if needed */
+bool MerkelBot::hasNextTimestamp(size_t period)
+{
+    if (feedClient)
+    {
+        // the timestamp of the next tick is known, but the orders of this one may still be on their way
+        while (liveTicksReceived <= period && loadNextTick())
+        {
+        }
+        return liveTicksReceived > period && period + 1 < allTimestamps.size();
+    }
+    if ((tickStream || tickIngest) && period + 1 >= allTimestamps.size())
+    {
+        loadNextTick();
+    }
+    return period + 1 < allTimestamps.size();
 }
 
+
 /** function to execute all actions, including bot decisions for current time*/
 void MerkelBot::processBotActions()
 {
     // getting current market prices
     getMarketPrices();
     // adding most recent prices to historical prices
-    avgHistoricalPrices.push_back(avgCurrentPrices);
+    addToPriceHistory();
 
     // only 1 data point available at the beginning and no price prediction is possible
     // checking if we moved beyond the initial timestamp
-    if (currentTime != allTimestamps[0]) 
+    if (predictions.ticks() > 1)
     {
         // updating prediction for estimated prices in the next period
         updatePricePrediction();
 
-        // cancelling orders from previous periods if applicable
-        cancelBotOrders();
+        // the strategy cancels orders from previous periods if applicable and places new asks and bids
+        buildMarketView();
+        executeDecisions(strategy.decide(marketView));
+        cancelAccountOrders();
 
-        // placing bot asks and bids
-        placeBotAsks();
-        placeBotBids();
+        // the accounts act on the same prediction, after the bot
+        placeAccountOrders();
     }
     
-    // iterating through all live orders to record active orders to the logs
-    for (OrderBookEntry& order : orders[currentTime])
+    // iterating through all live bot orders to record active orders to the logs
+    for (OrderBookEntry& order : botOrders[currentTime])
     {
         if (order.username == "botuser" && order.orderStatus != "cancelled")
         {
@@ -138,15 +1146,20 @@ void MerkelBot::processBotActions()
     }
 }
 
-void MerkelBot::splitDataByProduct(std::vector<OrderBookEntry>& orders)
+/** function to split the dataset and bot orders of the current time by product*/
+void MerkelBot::splitDataByProduct()
 {
         // clear map data structure
         for (std::string& p: allProducts)
         {
             ordersByProduct[p].clear();
         }
-        // split data by product into a map structure
-        for (OrderBookEntry& order: orders)
+        // split data by product into a map structure, dataset orders first and bot orders after them
+        for (const OrderBookEntry& order: datasetOrders(currentTime))
+        {
+            ordersByProduct[order.product].push_back(order);
+        }
+        for (OrderBookEntry& order: botOrders[currentTime])
         {
             ordersByProduct[order.product].push_back(order);
         }
@@ -192,8 +1205,10 @@ void MerkelBot::getMarketPrices()
     std::vector<OrderBookEntry> product_ask_orders;
 
     // iterating through list of known products
-    for (std::string const& p : allProducts)
+    for (size_t k = 0; k < allProducts.size(); ++k)
     {
+        std::string const& p = allProducts[k];
+
         // extracting bids and asks for current product
         std::vector<OrderBookEntry> product_bid_orders = getLiveBidsForProduct(p);
         // std::cout << "Bids for product " << p << ": " << product_bid_orders.size() << std::endl; 
@@ -263,6 +1278,13 @@ void MerkelBot::getMarketPrices()
         {
             avgCurrentPrices[p] = (minAskPrices[p] + maxBidPrices[p]) / 2;
         }
+        valuation.setPrice(valuationProductIds[k], avgCurrentPrices[p]);
+
+        // updating the candles with the latest top-of-book price
+        if (candles && avgCurrentPrices[p] > 0)
+        {
+            candles->onQuote(p, currentTime, avgCurrentPrices[p]);
+        }
     } // end for loop
 }
 
@@ -274,18 +1296,55 @@ void MerkelBot::runMarketSales(int period)
     {
         // matching asks to bids and generating sales for current time
         // extracting user orders which were not fully processed
-        std::vector<std::vector<OrderBookEntry>> output = fullOrderBook.matchAsksToBids(ordersByProduct[p], p, currentTime);
-        std::vector<OrderBookEntry> sales = output[0];
-        std::vector<OrderBookEntry> activeUserOrders = output[1];
+        // without bot orders only the dataset orders are matched, so the sales of the last
+        // matching stay valid while they are unchanged, they only feed the candles
+        unsigned long long version = datasetVersion(p);
+        bool botOrdersPresent = false;
+        for (OrderBookEntry const& e : ordersByProduct[p])
+        {
+            if (e.username != "dataset")
+            {
+                botOrdersPresent = true;
+                break;
+            }
+        }
+        std::vector<OrderBookEntry> sales;
+        std::vector<OrderBookEntry> activeUserOrders;
+        if (!botOrdersPresent && version != 0 && matchedVersion[p] == version)
+        {
+            sales = matchedSales[p];
+            matchesReused++;
+        }
+        else
+        {
+            std::vector<std::vector<OrderBookEntry>> output = OrderBook::matchAsksToBids(ordersByProduct[p], p, currentTime);
+            sales = output[0];
+            activeUserOrders = output[1];
+            matchedVersion[p] = botOrdersPresent ? 0 : version;
+            matchedSales[p] = botOrdersPresent ? std::vector<OrderBookEntry>{} : sales;
+            matchesRun++;
+        }
 
         // iterating through the list of sales
         for (OrderBookEntry& sale: sales)
         {   
+            // every fill contributes to candle volume and VWAP, a sale between two users once
+            if (candles && sale.orderStatus != "counterparty")
+            {
+                candles->onTrade(p, currentTime, sale.price, sale.amount);
+            }
+
             // updating sale logs and wallets for the bot
             if (sale.username == "botuser")
             {
                 logBotSale(sale, botSalesLog);
                 botAssets.processSale(sale);
+                metrics.onFill(sale.amount * sale.price * valuation.rate(valuation.productQuoteCurrency(valuation.productId(sale.product))));
+                fillCount++;
+            }
+            if (sale.username == "accounts")
+            {
+                accounts.onFill(sale);
             }
         }
 
@@ -293,247 +1352,399 @@ void MerkelBot::runMarketSales(int period)
         {
             order.orderStatus = "carryover";
             order.timestamp = allTimestamps[period+1];
-            orders[allTimestamps[period+1]].push_back(order);
+            botOrders[allTimestamps[period+1]].push_back(order);
+            if (order.username == "accounts")
+            {
+                accounts.keepPool(order.orderID);
+            }
         }
     }
-}
 
+    // pooled orders of the accounts that were filled completely are closed
+    accounts.endTick();
+}
 
-/** function to estimate next likely value of a numerical array using linear regression*/
-double MerkelBot::linRegressionPrediction(std::vector<double>& priceHistory)
+/** executing and logging sales one order event at a time, the bot sees each fill as it happens */
+void MerkelBot::runContinuousSales(size_t period)
 {
-    // starting and ending points
-    // moving average calculation on 14 data points (or less)
-    int end = priceHistory.size() - 1;
-    int start = std::max(end - 13, 0);
-
-    // not enough data points
-    if (start > end)
+    // events for this tick: the previous dataset snapshot expires, the bot cancels,
+    // then dataset orders arrive in file order followed by the new bot orders
+    // with incremental books the expiry and the dataset orders are replaced by the level updates from the last snapshot
+    events.clear();
+    eventOrders.clear();
+    if (!incrementalBook)
     {
-        return 0;
+        for (std::string const& p : allProducts)
+        {
+            eventOrders.push_back(OrderBookEntry{0, 0, currentTime, p, OrderBookType::unknown});
+            events.push(OrderEvent{OrderEventType::expireDataset, eventOrders.size() - 1});
+        }
     }
-    // temporary variables for the calculations
-    double sumX = 0, sumY = 0, upperTerm = 0, lowerTerm = 0;
-    double meanX, meanY, intercept, coeff;
-
-    try
+    for (OrderBookEntry const& order : botOrders[currentTime])
+    {
+        if (order.orderStatus == "cancelled")
+        {
+            eventOrders.push_back(order);
+            events.push(OrderEvent{OrderEventType::cancel, eventOrders.size() - 1});
+        }
+    }
+    if (incrementalBook)
+    {
+        std::vector<OrderBookEntry> const& snapshot = datasetOrders(currentTime);
+        snapshotDiffer.diff(snapshot, levelUpdates);
+        snapshotOrdersSeen += snapshot.size();
+        levelUpdatesApplied += levelUpdates.size();
+        for (LevelUpdate const& update : levelUpdates)
+        {
+            eventOrders.push_back(OrderBookEntry{update.price, update.amount, currentTime,
+                                                 snapshotDiffer.productName(update.product), update.side});
+            events.push(OrderEvent{OrderEventType::setLevel, eventOrders.size() - 1});
+        }
+    }
+    else
+    {
+        for (OrderBookEntry const& order : datasetOrders(currentTime))
+        {
+            eventOrders.push_back(order);
+            events.push(OrderEvent{OrderEventType::add, eventOrders.size() - 1});
+        }
+    }
+    for (OrderBookEntry const& order : botOrders[currentTime])
     {
-        for (int i = start; i <= end; ++i)
+        // carryovers already rest in the book, unless the run was resumed from a checkpoint
+        bool restored = order.orderStatus == "carryover" && !books[order.product].hasOrder(order.orderID);
+        if (order.orderStatus == "initial" || restored)
         {
-            sumX += i;
-            sumY += priceHistory[i];
+            eventOrders.push_back(order);
+            events.push(OrderEvent{OrderEventType::add, eventOrders.size() - 1});
         }
-        meanX = sumX / (end - start + 1);
-        meanY = sumY / (end - start + 1);
+    }
+
+    OrderEvent event;
+    while (events.pop(event))
+    {
+        OrderBookEntry& order = eventOrders[event.orderIndex];
+        ContinuousBook& book = books[order.product];
 
-        // intermediary calculations
-        for (int i = start; i <= end; ++i)
+        auto eventStart = std::chrono::high_resolution_clock::now();
+        eventFills.clear();
+        if (event.type == OrderEventType::expireDataset)
+        {
+            book.expireDatasetOrders();
+        }
+        else if (event.type == OrderEventType::cancel)
+        {
+            book.cancel(order.orderID);
+        }
+        else if (event.type == OrderEventType::setLevel)
+        {
+            book.setDatasetLevel(order, currentTime, eventFills);
+        }
+        else
         {
-            upperTerm += (i - meanX) * (priceHistory[i] - meanY);
-            lowerTerm += (i - meanX) * (i - meanX);
+            book.add(order, currentTime, eventFills);
+        }
+        auto eventStop = std::chrono::high_resolution_clock::now();
+        if (latencyReport)
+        {
+            matchLatency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(eventStop - eventStart).count());
         }
 
-        // calculating linear regression coefficient and intercept
-        coeff = upperTerm / lowerTerm;
-        intercept = meanY - coeff * meanX;
+        // the wallets change with each fill, before the next event is matched
+        for (OrderBookEntry& sale : eventFills)
+        {
+            if (candles)
+            {
+                candles->onTrade(sale.product, currentTime, sale.price, sale.amount);
+            }
+            if (sale.username == "botuser")
+            {
+                logBotSale(sale, botSalesLog);
+                botAssets.processSale(sale);
+                metrics.onFill(sale.amount * sale.price * valuation.rate(valuation.productQuoteCurrency(valuation.productId(sale.product))));
+                fillCount++;
+                if (StrategyEngine<BotStrategy>::fillReactions && predictions.ticks() > 1)
+                {
+                    reactToFill(sale);
+                }
+            }
+        }
     }
-    catch(const std::exception& e)
+
+    // bot orders still resting are carried over to the next tick, where the bot may cancel them
+    for (std::string const& p : allProducts)
     {
-        std::cout << "MerkelBot::linRegressionPrediction invalid input" << std::endl;
-        throw; // throw exception to the calling function
+        for (OrderBookEntry& order : books[p].restingBotOrders())
+        {
+            order.orderStatus = "carryover";
+            order.timestamp = allTimestamps[period + 1];
+            botOrders[allTimestamps[period + 1]].push_back(order);
+        }
     }
-
-    // returning prediction for 7 period later
-    return intercept + coeff * (end + 7);
 }
 
-/** function to extract historical prices from a specific product*/
-std::vector<double> MerkelBot::getHistoricalPricesByProduct(std::string const product)
+/** feed the current prices to the forecasting models */
+void MerkelBot::addToPriceHistory()
 {
-    // vector to store the historical values for a product
-    std::vector<double> productPriceHistory;
-    // iterating through the list of historical prices
-    for (std::map<std::string, double>& priceTimeSlice : avgHistoricalPrices)
+    tickPrices.assign(predictions.productCount(), 0);
+    for (size_t k = 0; k < allProducts.size(); ++k)
     {
-        productPriceHistory.push_back(priceTimeSlice[product]);
+        auto price = avgCurrentPrices.find(allProducts[k]);
+        if (price != avgCurrentPrices.end())
+        {
+            tickPrices[predictionProductIds[k]] = price->second;
+        }
     }
-
-    return productPriceHistory;
+    predictions.update(tickPrices);
 }
 
 /** update price prediction based on the historical and the most recent market prices*/
 void MerkelBot::updatePricePrediction()
 {
-   // vector to store historical prices for a product
-   std::vector<double> productPriceHistory;
-   for (std::string const& p : allProducts)
-   {
-       try
-       {
-           productPriceHistory = getHistoricalPricesByProduct(p);
-           pricePrediction[p] = linRegressionPrediction(productPriceHistory);
-       }
-       catch(const std::exception& e)
-       {
-           std::cout << e.what() << '\n';
-       }
-   } 
-}
-
-/** analyze current market and place bot bids */ 
-void MerkelBot::placeBotBids()
-{
-    double  bidPrice, buyAmount, sellAmount;
-    for (std::string const& p : allProducts)
+    // all models were updated with the prices of the tick, the strategy combines the ones it trades on
+    for (size_t k = 0; k < allProducts.size(); ++k)
     {
-        std::vector<std::string> currs = CSVReader::tokenise(p, '/');
-        
-        // initializing bid price at min ask to close a sale
-        bidPrice = avgCurrentPrices[p];
-        // initialing amount with the standard order amount
-        buyAmount = botAssets.standardOrderAmount[currs[0]];
-        // calculate sell amount
-        sellAmount = buyAmount * bidPrice;
-
-        // using stringstream to avoid losing decimals when converting to string, applicable to DOGE/BTC
-        std::stringstream priceString;
-        priceString << bidPrice;
+        pricePrediction[allProducts[k]] = predictions.combined(parameters.predictionBlend, predictionProductIds[k]);
+    }
+}
 
-        // check if the price prediction is higher than current market price
-        // if we expect the market price to increase, we should buy at the lowest price we can get now
-        if (pricePrediction[p] > avgCurrentPrices[p] && bidPrice > 0 && bidPrice < pricePrediction[p])
+/** fill the market view of the current tick for the strategy */
+void MerkelBot::buildMarketView()
+{
+    MarketView& view = marketView;
+    size_t count = allProducts.size();
+    if (view.products != allProducts)
+    {
+        view.products = allProducts;
+        view.baseCurrencies.clear();
+        view.quoteCurrencies.clear();
+        for (std::string const& p : allProducts)
         {
-            try
-            {
-                OrderBookEntry obe = CSVReader::stringsToOBE(priceString.str(), 
-                                                             std::to_string(buyAmount), 
-                                                             currentTime, 
-                                                             p, 
-                                                             OrderBookType::bid);
-                obe.username = "botuser"; 
-                obe.orderID = std::to_string(botOrderIDTracker);
-
-                // check if enough funds are available
-                if (botAssets.standardWallet.canFulfillOrder(obe))
-                {
-                    // add order to order book
-                    orders[currentTime].push_back(obe);
-                    // update order ID tracker
-                    botOrderIDTracker++;
-
-                    // move order amount for product to the reserved wallet to avoid placing uncovered bids/asks
-                    botAssets.blockAmount(currs[1], sellAmount);
-                }
-            }
-            catch(const std::exception& e)
+            std::vector<std::string> currs = CSVReader::tokenise(p, '/');
+            view.baseCurrencies.push_back(currs[0]);
+            view.quoteCurrencies.push_back(currs.size() > 1 ? currs[1] : "");
+        }
+        view.history = &predictions;
+        view.historyIds = predictionProductIds;
+    }
+    view.candles = candles.get();
+    view.price.resize(count);
+    view.maxBid.resize(count);
+    view.minAsk.resize(count);
+    view.bidDepth.assign(count, 0);
+    view.askDepth.assign(count, 0);
+    view.prediction.resize(count);
+    view.orderAmount.resize(count);
+    for (size_t k = 0; k < count; ++k)
+    {
+        std::string const& p = allProducts[k];
+        view.price[k] = avgCurrentPrices[p];
+        view.maxBid[k] = maxBidPrices[p];
+        view.minAsk[k] = minAskPrices[p];
+        view.prediction[k] = pricePrediction[p];
+        view.orderAmount[k] = botAssets.standardOrderAmount[view.baseCurrencies[k]];
+        for (OrderBookEntry const& e : ordersByProduct[p])
+        {
+            if (e.username == "dataset")
             {
-                std::cout << "MerkelBot::placeBotBids Bad input" << std::endl;
+                (e.orderType == OrderBookType::bid ? view.bidDepth[k] : view.askDepth[k]) += e.amount;
             }
-        
-        } // end if 
-    } // end for    
+        }
+    }
+
+    updateViewBalances();
+
+    // carryovers of the bot are the orders the strategy can cancel
+    view.resting.clear();
+    std::vector<OrderBookEntry>& orders = botOrders[currentTime];
+    for (size_t i = 0; i < orders.size(); ++i)
+    {
+        OrderBookEntry const& order = orders[i];
+        if (order.orderStatus == "carryover" && order.username == "botuser")
+        {
+            int k = std::lower_bound(allProducts.begin(), allProducts.end(), order.product) - allProducts.begin();
+            view.resting.push_back(RestingOrder{i, k, order.orderType, order.price, order.amount});
+        }
+    }
 }
 
-/** analyze current market and place bot asks */ 
-void MerkelBot::placeBotAsks()
+/** free balances of the bot in the market view */
+void MerkelBot::updateViewBalances()
 {
-    double askPrice, buyAmount, sellAmount;
-    for (std::string const& p : allProducts)
+    MarketView& view = marketView;
+    view.baseAvailable.resize(view.productCount());
+    view.quoteAvailable.resize(view.productCount());
+    for (size_t k = 0; k < view.productCount(); ++k)
     {
-        std::vector<std::string> currs = CSVReader::tokenise(p, '/');
+        auto base = botAssets.standardWallet.currencies.find(view.baseCurrencies[k]);
+        auto quote = botAssets.standardWallet.currencies.find(view.quoteCurrencies[k]);
+        view.baseAvailable[k] = base != botAssets.standardWallet.currencies.end() ? base->second : 0;
+        view.quoteAvailable[k] = quote != botAssets.standardWallet.currencies.end() ? quote->second : 0;
+    }
+}
 
-        // no trading happening on this product
-        if ( (minAskPrices[p] == 0) && (maxBidPrices[p] == 0) )
-            continue;
-        
-        // initializing ask price at current market price
-        askPrice = avgCurrentPrices[p];
-        // initialing amount with the standard order amount
-        sellAmount = botAssets.standardOrderAmount[currs[0]];
-        // calculate buy amount
-        buyAmount = sellAmount * askPrice;
-
-        // using stringstream to avoid losing decimals when converting to string, applicable to DOGE/BTC
-        std::stringstream priceString;
-        priceString << askPrice;
-
-        // check if the price prediction is lower than current market price
-        // if we expect the market price to decrease, we should sell at the highest price we can get now
-        //if (pricePrediction[p] < avgCurrentPrices[p] && askPrice > pricePrediction[p])
-        if (pricePrediction[p] < avgCurrentPrices[p] && askPrice > 0 && askPrice > pricePrediction[p])
+/** cancel, check the funds of and place the orders the strategy decided on, in the order it made them */
+void MerkelBot::executeDecisions(OrderSink const& decisions)
+{
+    for (OrderIntent const& intent : decisions.decisions())
+    {
+        std::string const& base = marketView.baseCurrencies[intent.product];
+        std::string const& quote = marketView.quoteCurrencies[intent.product];
+        if (intent.type == OrderIntentType::cancel)
         {
-            try
+            OrderBookEntry& order = botOrders[currentTime][intent.order];
+            if (order.orderStatus == "cancelled")
             {
-                OrderBookEntry obe = CSVReader::stringsToOBE(priceString.str(), 
-                                                             std::to_string(sellAmount), 
-                                                             currentTime, 
-                                                             p, 
-                                                             OrderBookType::ask);
-                obe.username = "botuser";
-                obe.orderID = std::to_string(botOrderIDTracker);
-
-                // check if enough funds are available
-                if (botAssets.standardWallet.canFulfillOrder(obe))
-                {
-                    // add order to order book
-                    orders[currentTime].push_back(obe);
+                continue;
+            }
+            order.orderStatus = "cancelled";
+            if (order.orderType == OrderBookType::ask)
+            {
+                botAssets.unblockAmount(base, order.amount);
+            }
+            else
+            {
+                botAssets.unblockAmount(quote, order.amount * order.price);
+            }
+            logBotOrder(order, botCancelledOrdersLog);
+            continue;
+        }
 
-                    // update order ID tracker
-                    botOrderIDTracker++;
+        // price rounded to the 8 decimals the exchange quotes in, small prices like DOGE/BTC keep all their digits
+        bool isBid = intent.type == OrderIntentType::bid;
+        OrderBookEntry obe{Decimal{}, Decimal{}, "", "", OrderBookType::unknown};
+        if (orderBuilder.build(obe, isBid ? OrderBookType::bid : OrderBookType::ask, allProductIds[intent.product], botUserId,
+                               intent.price, intent.amount, currentTime) != OrderValidation::ok)
+        {
+            std::cout << "MerkelBot::executeDecisions Bad input" << std::endl;
+            continue;
+        }
+        obe.orderID = std::to_string(botOrderIDTracker);
 
-                    // move order amount for product to the reserved wallet to avoid placing uncovered bids/asks
-                    botAssets.blockAmount(currs[0], sellAmount);
-                }
+        // check if enough funds are available
+        if (botAssets.standardWallet.canFulfillOrder(obe))
+        {
+            // add order to order book
+            botOrders[currentTime].push_back(obe);
+            // update order ID tracker
+            botOrderIDTracker++;
+            metrics.onOrderPlaced(obe.amount * obe.price * usdPrice(quote));
+
+            // move order amount for product to the reserved wallet to avoid placing uncovered bids/asks
+            if (isBid)
+            {
+                botAssets.blockAmount(quote, obe.amount * obe.price);
             }
-            catch(const std::exception& e)
+            else
             {
-                std::cout << "MerkelBot::placeBotBids Bad input" << std::endl;
+                botAssets.blockAmount(base, obe.amount);
             }
-        
-        } // end if 
-    } // end for    
+        }
+    }
 }
 
-/** analyze current market and cancel carryover orders where needed */ 
-void MerkelBot::cancelBotOrders()
+/** let the strategy react to a fill of the bot, cancels take effect at once and new orders join the end of the events of the tick */
+void MerkelBot::reactToFill(OrderBookEntry const& sale)
 {
-    std::vector<std::string> currs;
-    for (OrderBookEntry& order : orders[currentTime])
+    int product = std::lower_bound(allProducts.begin(), allProducts.end(), sale.product) - allProducts.begin();
+    Fill fill{product, sale.orderType == OrderBookType::bidsale ? OrderBookType::bid : OrderBookType::ask,
+              sale.price, sale.amount, books[sale.product].restingAmount(sale.orderID)};
+
+    // every bot order in the book can be cancelled, at the amount still resting so a cancel releases what is left
+    updateViewBalances();
+    marketView.resting.clear();
+    std::vector<OrderBookEntry>& orders = botOrders[currentTime];
+    for (size_t i = 0; i < orders.size(); ++i)
     {
-        if (order.orderStatus == "carryover" && order.username == "botuser")
+        OrderBookEntry& order = orders[i];
+        if (order.username != "botuser" || order.orderStatus == "cancelled" || !books[order.product].hasOrder(order.orderID))
+        {
+            continue;
+        }
+        order.amount = books[order.product].restingAmount(order.orderID);
+        int k = std::lower_bound(allProducts.begin(), allProducts.end(), order.product) - allProducts.begin();
+        marketView.resting.push_back(RestingOrder{i, k, order.orderType, order.price, order.amount});
+    }
+
+    size_t placed = orders.size();
+    OrderSink const& decisions = strategy.decide(marketView, fill);
+    executeDecisions(decisions);
+    for (OrderIntent const& intent : decisions.decisions())
+    {
+        if (intent.type == OrderIntentType::cancel)
+        {
+            OrderBookEntry const& order = botOrders[currentTime][intent.order];
+            books[order.product].cancel(order.orderID);
+        }
+    }
+    for (size_t i = placed; i < botOrders[currentTime].size(); ++i)
+    {
+        logBotOrder(botOrders[currentTime][i], botActiveOrdersLog);
+        eventOrders.push_back(botOrders[currentTime][i]);
+        events.push(OrderEvent{OrderEventType::add, eventOrders.size() - 1});
+    }
+}
+
+/** cancel the pooled orders of the accounts the market or the prediction has moved past, releasing their reservations */
+void MerkelBot::cancelAccountOrders()
+{
+    for (OrderBookEntry& order : botOrders[currentTime])
+    {
+        if (order.orderStatus == "carryover" && order.username == "accounts")
         {
-            if(order.orderType == OrderBookType::ask)
+            // the same rules as the reference strategy of the bot
+            bool cancel = order.orderType == OrderBookType::ask
+                        ? order.price < maxBidPrices[order.product] || order.price < pricePrediction[order.product]
+                        : order.price > minAskPrices[order.product] || order.price > pricePrediction[order.product];
+            if (cancel)
             {
-                // check order price vs. current market prices
-                // if the price is lower than bidding prices or we predict the price will increase, we cancel the order
-                if (order.price < maxBidPrices[order.product] | order.price < pricePrediction[order.product])
-                {
-                    order.orderStatus = "cancelled";
-                    currs = CSVReader::tokenise(order.product, '/');
-                    botAssets.unblockAmount(currs[0], order.amount);
+                order.orderStatus = "cancelled";
+                accounts.closePool(order.orderID);
+            }
+        }
+    }
+}
 
-                    logBotOrder(order, botCancelledOrdersLog);
-                }
+/** pool the orders of the accounts that act on the current prediction */
+void MerkelBot::placeAccountOrders()
+{
+    if (accounts.accountCount() == 0)
+    {
+        return;
+    }
+    for (size_t k = 0; k < allProducts.size(); ++k)
+    {
+        std::string const& p = allProducts[k];
+        // no trading happening on this product
+        if ((minAskPrices[p] == 0) && (maxBidPrices[p] == 0))
+            continue;
+
+        // at the current market price like the bot, rounded as the order will be
+        double price = Decimal::fromDouble(avgCurrentPrices[p]);
+        for (OrderBookType side : {OrderBookType::ask, OrderBookType::bid})
+        {
+            std::string orderID = "A" + std::to_string(accountOrderIDTracker);
+            double amount = accounts.openPool(orderID, p, side, price, pricePrediction[p]);
+            if (amount <= 0)
+            {
+                continue;
             }
-            if(order.orderType == OrderBookType::bid)
+            OrderBookEntry obe{Decimal{}, Decimal{}, "", "", OrderBookType::unknown};
+            if (orderBuilder.build(obe, side, allProductIds[k], accountsUserId, price, amount, currentTime) != OrderValidation::ok)
             {
-                // check order price vs. current market
-                // if price is higher than asking prices or we predict the price will decrease, we cancel the order
-                if (order.price > minAskPrices[order.product] | order.price > pricePrediction[order.product])
-                {
-                    order.orderStatus = "cancelled";
-                    currs = CSVReader::tokenise(order.product, '/');
-                    botAssets.unblockAmount(currs[1], order.amount * order.price);
-
-                    logBotOrder(order, botCancelledOrdersLog);
-                }
+                // too small for the market once rounded
+                accounts.closePool(orderID);
+                continue;
             }
+            obe.orderID = orderID;
+            botOrders[currentTime].push_back(obe);
+            accountOrderIDTracker++;
         }
-    }                             
+    }
 }
 
 /** add bot order to the order log */
-void MerkelBot::logBotOrder(OrderBookEntry& order, std::ofstream& logFile)
+void MerkelBot::logBotOrder(OrderBookEntry& order, std::ostream& logFile)
 {
     logFile << order.timestamp << ",";
     logFile << order.orderID << ",";
@@ -559,7 +1770,7 @@ void MerkelBot::logBotOrder(OrderBookEntry& order, std::ofstream& logFile)
 }
 
 /** add sale to the sale log*/
-void MerkelBot::logBotSale(OrderBookEntry& sale, std::ofstream& logFile)
+void MerkelBot::logBotSale(OrderBookEntry& sale, std::ostream& logFile)
 {
     std::vector<std::string> currs = CSVReader::tokenise(sale.product, '/');
 
@@ -597,37 +1808,63 @@ void MerkelBot::logBotSale(OrderBookEntry& sale, std::ofstream& logFile)
     logFile << avgCurrentPrices[sale.product] << std::endl;
 }
 
-/** log total value of assets in USD equivalent */
-void MerkelBot::logTotalAssetsUSD(std::ofstream& logFile)
+/** total value of assets in USD equivalent at current prices */
+double MerkelBot::computeTotalAssetsUSD()
+{
+    // kept up to date by the valuation graph as prices and balances change
+    return valuation.totalValue();
+}
+
+/** USD value of one unit of a currency at current prices, 0 if it cannot be converted */
+double MerkelBot::usdPrice(std::string const& currency) const
+{
+    int id = valuation.currencyId(currency);
+    return id < 0 ? 0 : valuation.rate(id);
+}
+
+/** USD value of the holdings in each currency at current prices */
+std::map<std::string, double> MerkelBot::holdingsUSD() const
 {
-    double totalAssetsUSD = 0;
-    std::string product;
+    std::map<std::string, double> holdings;
+    for (auto const& pair : botAssets.totalAssets.currencies)
+    {
+        int id = valuation.currencyId(pair.first);
+        holdings[pair.first] = id < 0 ? 0 : valuation.value(id);
+    }
+    return holdings;
+}
 
+/** log total value of assets in USD equivalent */
+void MerkelBot::logTotalAssetsUSD(std::ostream& logFile)
+{
     // calculating USD equivalent for all the assets combined to evaluate the evolution of our portfolio
-    for (std::pair<std::string, double> pair : botAssets.totalAssets.currencies)
+    // currencies without a USDT market are converted through the other products, e.g. DOGE -> BTC -> USDT
+    for (std::pair<std::string const, double> const& pair : botAssets.totalAssets.currencies)
     {
-        if (pair.first == "USDT")
+        if (pair.first == valuation.quoteCurrency())
         {
-            totalAssetsUSD += pair.second;
             logFile << pair.first << " " << pair.second << " * " << 1.00 << " = " << pair.second << std::endl;
         }
         else
         {
-            product = pair.first + "/USDT";
-            totalAssetsUSD += pair.second * avgCurrentPrices[product];
+            double rate = usdPrice(pair.first);
             logFile << pair.first << " " << std::to_string(pair.second) << " * ";
-            logFile << std::to_string(avgCurrentPrices[product]) << " = USD ";
-            logFile << std::to_string(pair.second * avgCurrentPrices[product]) << std::endl;
+            logFile << std::to_string(rate) << " = USD ";
+            logFile << std::to_string(pair.second * rate) << std::endl;
         }
         
     }
+    // keeping the latest value for the run summary
+    double totalAssetsUSD = valuation.totalValue();
+    lastTotalAssetsUSD = totalAssetsUSD;
+
     logFile << "Total assets in USD equivalent as on " << currentTime;
     logFile << ": " << "USD " << totalAssetsUSD << std::endl;
     logFile << "===================================" << std::endl;
 }
 
 /** log impact of cumulative sales to assets log - assists with checks */
-void MerkelBot::logSalesImpact(std::ofstream& logFile)
+void MerkelBot::logSalesImpact(std::ostream& logFile)
 {
     logFile << "Impact of cumulative sales on assets as per sales log: " << std::endl;
     std::string s = "";
@@ -3,25 +3,213 @@
 #include "OrderBookEntry.h"
 #include "CSVReader.h"
 #include "Assets.h"
+#include "CandleEngine.h"
+#include "TickStream.h"
+#include "BotParameters.h"
+#include "Checkpoint.h"
+#include "ContinuousBook.h"
+#include "LatencyRecorder.h"
+#include "Pipeline.h"
+#include "MarketFeed.h"
+#include "SharedMarket.h"
+#include "OrderBuilder.h"
+#include "ProductVersions.h"
+#include "StrategyMetrics.h"
+#include "PredictionEngine.h"
+#include "AccountPopulation.h"
+#include "CompressedTicks.h"
+#include "BookUpdates.h"
+#include "ReferenceStrategy.h"
+#include <memory>
+#include <cstdint>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <chrono>
 #include <sstream>
+#include <filesystem>
 
 class MerkelBot
 {
     public:
         MerkelBot();
+        /** run over a list of dataset files merged by timestamp
+         * in streaming mode ticks are parsed while the simulation runs instead of loaded upfront */
+        MerkelBot(std::vector<std::string> _datasetFiles, bool _streaming = false);
+        /** run over an order book that is already loaded, the book is only read and can be shared between bots */
+        MerkelBot(std::shared_ptr<const OrderBook> _dataset);
+
+        /** override the strategy constants, call before init */
+        void setParameters(BotParameters const& _parameters);
 		/** Call this to start the application */
 		void init();
 
+        /** build OHLCV and VWAP candles per product at these resolutions in seconds from market prices and sales
+         * they are passed to the strategy, kept in checkpoints and written to BotCandles<seconds>s.csv at the end
+         * of the run; no resolutions, the default, turns candles off; a resumed run needs the resolutions of its checkpoint */
+        void setCandles(std::vector<int> resolutionsSeconds);
+
+        /** write the logs to this directory instead of the working directory */
+        void setOutputDirectory(std::string directory);
+
+        /** replay only part of the timeline of a loaded dataset
+         * ticks from warmupStart build the price history, ticks from tradeStart up to tradeEnd (excluded) are traded */
+        void setTickRange(size_t warmupStart, size_t tradeStart, size_t tradeEnd);
+
+        /** write a checkpoint every everyTicks processed ticks to this file, 0 turns checkpoints off */
+        void setCheckpointing(std::string path, int everyTicks);
+
+        /** continue from the checkpoint file instead of starting from the first tick */
+        void setResume(std::string path);
+
+        /** match every order as an event against persistent per-product books instead of once per tick
+         * a strategy with onFill reacts between events, see Strategy.h */
+        void setContinuousMatching(bool _continuous);
+
+        /** with continuous matching, drive the dataset side of the books with the level updates between
+         * consecutive snapshots instead of replacing every snapshot, dataset levels that do not change
+         * keep their time priority and what the bot took from them stays taken until they change */
+        void setIncrementalBook(bool _incremental);
+
+        /** print matching latency percentiles at the end of the run */
+        void setLatencyReport(bool _latencyReport);
+
+        /** record the balance changes to a binary ledger at this path with a full snapshot every snapshotInterval ticks
+         * the ledger replaces the wallet dumps of BotAssetsLog.txt */
+        void setLedger(std::string path, int snapshotInterval);
+
+        /** rolling window of the Sharpe and Sortino ratios and interval of the metrics series, in ticks
+         * the summary is always kept, the series only with an interval above 0 */
+        void setMetrics(int window, int seriesInterval);
+
+        /** simulate this many retail accounts trading against the same market as the bot, created from the seed
+         * their orders are pooled per product and side, so the matching cost does not grow with their number
+         * accounts take part in batch matching only */
+        void setAccounts(size_t count, unsigned seed = 1);
+
+        /** merge dataset orders of a tick with the same product, side and price into one price level as they are loaded
+         * applies to the files the bot loads or streams itself and to live ticks, not to a dataset handed over loaded */
+        void setPriceLevelCompaction(bool _compact);
+
+        /** keep the dataset files delta encoded and bit-packed in memory instead of as an order book
+         * the files are streamed into the store at load time and every tick is decoded as it is replayed */
+        void setTickCompression(bool _compress);
+
+        /** run ingest, simulation and log writing as a pipeline of three threads, the dataset is streamed
+         * each stage can be pinned to a core, -1 leaves it unpinned */
+        void setPipelining(bool _pipelined, int _ingestCore = -1, int _simulationCore = -1, int _logCore = -1);
+
+        /** take the ticks from a feed server at this address instead of the dataset files and send the bot orders back */
+        void setLiveFeed(std::string address);
+
+        /** publish prices, predictions and balances of every tick to the shared memory object with this name */
+        void setSharedMemory(std::string name);
+
+        /** turn the log files on or off */
+        void setLogging(bool _logging);
+
+        /** turn the console progress messages on or off */
+        void setVerbose(bool _verbose);
+
+        /** total value of the bot assets in USD at the first tick */
+        double getInitialAssetsUSD() const;
+
+        /** total value of the bot assets in USD at the last processed tick */
+        double getTotalAssetsUSD() const;
+
+        /** number of sales the bot took part in */
+        int getFillCount() const;
+
+        /** number of orders the bot placed */
+        int getOrderCount() const;
+
     private:
         // variable to store and process bot assets
         Assets botAssets;
 
-        // store order book data from file
-        OrderBook fullOrderBook;
+        // strategy constants for this run
+        BotParameters parameters;
+
+        // order book data from file, read only and possibly shared with other bots, null while streaming
+        std::shared_ptr<const OrderBook> dataset;
+
+        // dataset files to replay and whether to stream them tick by tick
+        std::vector<std::string> datasetFiles;
+        bool streaming = false;
+        std::unique_ptr<TickStream> tickStream;
+
+        // pipelined mode: ingest and log writing run on their own threads, optionally pinned to cores
+        bool pipelined = false;
+        int ingestCore = -1;
+        int simulationCore = -1;
+        int logCore = -1;
+        std::unique_ptr<TickIngest> tickIngest;
+
+        // price level compaction of the dataset orders, with the orders loaded and the levels left
+        bool compactLevels = false;
+        size_t datasetOrdersLoaded = 0;
+        size_t datasetLevelsLoaded = 0;
+
+        /** compact the price levels of one tick of streamed orders and count them */
+        void compactTick(std::vector<OrderBookEntry>& orders);
+
+        // compressed dataset, null unless tick compression is on
+        bool compressTicks = false;
+        std::unique_ptr<CompressedTickStore> tickStore;
+
+        /** stream the dataset files into the compressed store */
+        void loadCompressedDataset();
+
+        // live mode: ticks come from a feed server and the orders of each tick are sent back to it
+        std::string liveFeedAddress;
+        std::unique_ptr<FeedClient> feedClient;
+        size_t liveTicksReceived = 0;
+
+        /** send the orders placed at the current tick to the feed server */
+        void sendLiveOrders();
+
+        // top of book, predictions and balances published in shared memory for other processes
+        std::string sharedMemoryName;
+        std::unique_ptr<SharedMarketPublisher> sharedMarket;
+        LatencyRecorder publishLatency;
+
+        /** publish the state of the current tick to shared memory */
+        void publishSharedMarket();
+
+        /** load the dataset files, or start streaming them */
+        void loadDataset();
+
+        /** pull the next tick from the stream into the streamed orders, false at the end of the stream */
+        bool loadNextTick();
+
+        /** check that a timestamp follows period i, streaming it in if needed */
+        bool hasNextTimestamp(size_t period);
+
+        /** add a product to the sorted list of known products if it is new */
+        void addProduct(std::string const& product);
+
+        // checkpoint file, interval in processed ticks and the background writer
+        std::string checkpointPath;
+        int checkpointInterval = 0;
+        std::unique_ptr<CheckpointWriter> checkpointWriter;
+        long long ticksProcessed = 0;
+
+        // resume state: first tick to replay and log sizes at the checkpoint
+        bool resuming = false;
+        std::string resumeTimestamp;
+        std::vector<long long> resumeLogOffsets;
+
+        /** serialize everything needed to continue at nextTimestamp and hand it to the background writer */
+        void writeCheckpoint(std::string const& nextTimestamp);
+
+        /** read the checkpoint file back into the bot state, false if it is missing or damaged */
+        bool restoreCheckpoint();
+
+        /** open the log files, cut back to their size at the checkpoint when resuming */
+        void openLogs();
+
+        /** hand the logs of the current tick over to the log writer */
+        void flushLogs();
 
         // functions to extract bids and asks by product
         std::vector<OrderBookEntry> getLiveBidsForProduct(std::string const product);
@@ -32,11 +220,17 @@ class MerkelBot
         std::map<std::string, double> minAskPrices;
         std::map<std::string, double> avgCurrentPrices;
 
-        // a vector to store historical prices for all timestamps up to current time 
-        std::vector<std::map<std::string, double> > avgHistoricalPrices;
+        // forecasting models over the price history of all products, with the IDs of the products (same order as allProducts)
+        PredictionEngine predictions;
+        std::vector<int> predictionProductIds;
+        // current prices by prediction product ID, filled every tick
+        std::vector<double> tickPrices;
+
+        /** feed the current prices to the forecasting models */
+        void addToPriceHistory();
 
-        /** function to extract historical prices for a specific product*/
-        std::vector<double> getHistoricalPricesByProduct(std::string const product);
+        // OHLCV and VWAP candles per product at several resolutions, fed by market prices and sales, null unless turned on
+        std::unique_ptr<CandleEngine> candles;
 
         // map to store current price prediction for each product
         std::map<std::string, double> pricePrediction;
@@ -44,9 +238,6 @@ class MerkelBot
         // map to store impact of sales to assets
         std::map<std::string, double> salesImpactOnAssets;
 
-        /** function to estimate next likely value of a numerical array using linear regression*/
-        static double linRegressionPrediction(std::vector<double>& priceHistory);
-
         /** update price prediction based on the historical and the most recent market prices*/
         void updatePricePrediction();
 
@@ -59,48 +250,165 @@ class MerkelBot
         /** executing and logging sales */
         void runMarketSales(int period);
 
-        /** analyze current market and place bot bids */ 
-        void placeBotBids();
+        // continuous matching: one book per product kept across ticks, the event queue and the orders it refers to
+        bool continuousMatching = false;
+        std::map<std::string, ContinuousBook> books;
+        EventQueue events;
+        std::vector<OrderBookEntry> eventOrders;
+        std::vector<OrderBookEntry> eventFills;
+
+        // incremental books: the snapshots are diffed into level updates, counted against the snapshot orders
+        bool incrementalBook = false;
+        SnapshotDiffer snapshotDiffer;
+        std::vector<LevelUpdate> levelUpdates;
+        size_t snapshotOrdersSeen = 0;
+        size_t levelUpdatesApplied = 0;
+
+        // matching latency per event in continuous mode and per tick in batch mode
+        bool latencyReport = false;
+        LatencyRecorder matchLatency;
+
+        /** executing and logging sales one order event at a time, the bot sees each fill as it happens */
+        void runContinuousSales(size_t period);
+
+        // the trading decisions, made by the strategy type the bot is compiled with from a view of the market
+        // another type with the members described in Strategy.h plugs in by changing BotStrategy
+        using BotStrategy = ReferenceStrategy;
+        StrategyEngine<BotStrategy> strategy;
+        MarketView marketView;
 
-        /** analyze current market and place bot asks */ 
-        void placeBotAsks();
+        /** fill the market view of the current tick for the strategy */
+        void buildMarketView();
 
-        /** analyze current market and cancel carryover orders where needed */ 
-        void cancelBotOrders();
+        /** free balances of the bot in the market view */
+        void updateViewBalances();
+
+        /** cancel, check the funds of and place the orders the strategy decided on, in the order it made them */
+        void executeDecisions(OrderSink const& decisions);
+
+        /** let the strategy react to a fill of the bot during continuous matching,
+         * cancels take effect at once and new orders join the end of the events of the tick */
+        void reactToFill(OrderBookEntry const& sale);
+
+        /** cancel the pooled orders of the accounts the market or the prediction has moved past */
+        void cancelAccountOrders();
 
         /** add bot order to the order log */
-        void logBotOrder(OrderBookEntry& order, std::ofstream& logFile);
+        void logBotOrder(OrderBookEntry& order, std::ostream& logFile);
 
         /** add sale to the sale log*/
-        void logBotSale(OrderBookEntry& sale, std::ofstream& logFile);
+        void logBotSale(OrderBookEntry& sale, std::ostream& logFile);
+
+        /** total value of assets in USD equivalent at current prices */
+        double computeTotalAssetsUSD();
+
+        /** USD value of one unit of a currency at current prices, 0 if it cannot be converted */
+        double usdPrice(std::string const& currency) const;
+
+        /** USD value of the holdings in each currency at current prices */
+        std::map<std::string, double> holdingsUSD() const;
+
+        // ledger mode: balance changes and periodic snapshots instead of the assets log, with its sizes at the checkpoint
+        std::string ledgerPath;
+        int ledgerSnapshotInterval = 100;
+        std::unique_ptr<AssetLedgerWriter> ledger;
+        long long resumeLedgerOffset = -1;
+        long long resumeLedgerIndexOffset = -1;
+
+        /** start the current tick in the ledger */
+        void beginLedgerTick(bool forceSnapshot = false);
+
+        // simulated retail accounts, their number and seed before they are created, the tracking id of their pooled orders
+        // and their total value in USD at the first tick
+        AccountPopulation accounts;
+        size_t accountCount = 0;
+        unsigned accountSeed = 1;
+        int accountOrderIDTracker = 1;
+        double accountsInitialUSD = 0;
+
+        /** pool the orders of the accounts that act on the current prediction */
+        void placeAccountOrders();
+
+        // performance of the run, written to BotMetricsSummary.txt and BotMetricsSeries.csv at the end
+        StrategyMetrics metrics;
+        int metricsSeriesInterval = 0;
 
         /** log total value of assets in USD equivalent */
-        void logTotalAssetsUSD(std::ofstream& logFile);
+        void logTotalAssetsUSD(std::ostream& logFile);
 
         /** log impact of cumulative sales to assets log - assists with checks */
-        void logSalesImpact(std::ofstream& logFile);
+        void logSalesImpact(std::ostream& logFile);
 
         /** vectors to store all timestamps and products */
         std::vector<std::string> allTimestamps;
         std::vector<std::string> allProducts;
 
-        /** map of vectors to store orders by timestamp */
-        std::map<std::string,std::vector<OrderBookEntry>> orders;
+        // values the bot assets in USDT through the product graph, with the IDs of the products (same order as allProducts)
+        CurrencyGraph valuation;
+        std::vector<int> valuationProductIds;
+
+        // builds the bot orders from numbers, with the interned IDs of the products (same order as allProducts) and of the bot
+        OrderBuilder orderBuilder;
+        std::vector<int> allProductIds;
+        int botUserId;
+        int accountsUserId;
+
+        /** map of vectors to store streamed dataset orders by timestamp, until they are processed */
+        std::map<std::string,std::vector<OrderBookEntry>> streamedOrders;
+        /** map of vectors to store bot orders by timestamp: carryovers, then new asks and bids */
+        std::map<std::string,std::vector<OrderBookEntry>> botOrders;
         /** map of vectors to store orders by product */
         std::map<std::string,std::vector<OrderBookEntry>> ordersByProduct;
 
-        /** function to split orders by product*/
-        void splitDataByProduct(std::vector<OrderBookEntry>& orders);
+        /** dataset orders for a timestamp, from the loaded order book or from the stream */
+        const std::vector<OrderBookEntry>& datasetOrders(std::string const& timestamp) const;
+
+        /** function to split the dataset and bot orders of the current time by product*/
+        void splitDataByProduct();
+
+        // versions of the dataset orders of each product: a loaded dataset carries its own, a compressed one
+        // keeps them here with history and streamed ticks carry theirs by timestamp until they are processed
+        ProductVersions productVersions;
+        std::map<std::string, std::map<std::string, unsigned long long>> tickVersions;
+
+        /** version of the dataset orders of a product at the current time, 0 if unknown */
+        unsigned long long datasetVersion(std::string const& product) const;
+
+        // inputs of the last matching without bot orders per product, its sales are reused while they stay
+        // the same, with counts of the reused and the run matchings
+        std::map<std::string, unsigned long long> matchedVersion;
+        std::map<std::string, std::vector<OrderBookEntry>> matchedSales;
+        size_t matchesReused = 0;
+        size_t matchesRun = 0;
         // class variables to store current time, earliest time and latest time for the order book
         std::string currentTime;
         std::string earliestTimestamp;
         std::string latestTimestamp;
 
-        // file stream variables for the logs
-        std::ofstream botActiveOrdersLog;
-        std::ofstream botCancelledOrdersLog;
-        std::ofstream botAssetsLog;
-        std::ofstream botSalesLog;
+        // directory for the log files, empty for the working directory
+        std::string outputDirectory;
+        bool verbose = true;
+        bool logging = true;
+
+        /** path of a log file inside the output directory */
+        std::string logPath(std::string const& filename) const;
+
+        // slice of the timeline to replay, by default the whole dataset
+        size_t warmupStartTick = 0;
+        size_t tradeStartTick = 0;
+        size_t tradeEndTick = SIZE_MAX;
+
+        // results of the run so far
+        double initialTotalAssetsUSD = 0;
+        double lastTotalAssetsUSD = 0;
+        int fillCount = 0;
+
+        // logs of the current tick, formatted in memory and handed to the log writer once per tick
+        std::ostringstream botActiveOrdersLog;
+        std::ostringstream botCancelledOrdersLog;
+        std::ostringstream botAssetsLog;
+        std::ostringstream botSalesLog;
+        std::unique_ptr<LogWriter> logWriter;
 
         // tracking id for the bot orders
         int botOrderIDTracker = 1;
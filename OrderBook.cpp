@@ -6,6 +6,85 @@ OrderBook::OrderBook()
 
 }
 
+/** merge dataset orders of a tick that share product, side and price into one price level */
+size_t OrderBook::compactPriceLevels(std::vector<OrderBookEntry>& orders)
+{
+    // position of each level in the compacted vector, keyed by product, side and price
+    std::map<std::tuple<std::string, OrderBookType, long long>, size_t> levels;
+    size_t kept = 0;
+    for (size_t i = 0; i < orders.size(); ++i)
+    {
+        OrderBookEntry& order = orders[i];
+        if (order.username == "dataset")
+        {
+            auto key = std::make_tuple(order.product, order.orderType, order.price.units());
+            auto it = levels.find(key);
+            if (it != levels.end())
+            {
+                OrderBookEntry& level = orders[it->second];
+                level.amount += order.amount;
+                level.orderCount += order.orderCount;
+                continue;
+            }
+            levels[key] = kept;
+        }
+        if (kept != i)
+        {
+            orders[kept] = std::move(order);
+        }
+        kept++;
+    }
+    size_t removed = orders.size() - kept;
+    orders.erase(orders.begin() + kept, orders.end());
+    return removed;
+}
+
+/** compact the price levels of every loaded tick */
+size_t OrderBook::compactPriceLevels()
+{
+    size_t removed = 0;
+    for (auto& tick : ordersByTimestamp)
+    {
+        removed += compactPriceLevels(tick.second);
+    }
+    buildVersions();
+    return removed;
+}
+
+/** build the range-query index over the loaded ticks */
+void OrderBook::buildIndex()
+{
+    index.build(ordersByTimestamp);
+}
+
+/** number the dataset orders of every product tick after tick, the map is sorted by timestamp */
+void OrderBook::buildVersions()
+{
+    versions = ProductVersions{true};
+    for (auto const& tick : ordersByTimestamp)
+    {
+        versions.addTick(tick.second);
+    }
+}
+
+/** version of the orders of a product at a position in timestamps, 0 if unknown */
+unsigned long long OrderBook::productVersion(std::string const& product, size_t tick) const
+{
+    return versions.version(product, tick);
+}
+
+/** volume, min/max price and VWAP of a product side between two timestamps (inclusive) */
+RangeStats OrderBook::queryRange(std::string const& product,
+                                 OrderBookType type,
+                                 std::string const& fromTimestamp,
+                                 std::string const& toTimestamp) const
+{
+    return index.query(product,
+                       type,
+                       OrderBookEntry::timestampToMicros(fromTimestamp),
+                       OrderBookEntry::timestampToMicros(toTimestamp));
+}
+
 /** return vector of orders according to the filters applied */
 std::vector<OrderBookEntry> OrderBook::getOrders(std::vector<OrderBookEntry>& ordersList,
                                       OrderBookType type, 
@@ -27,6 +106,22 @@ std::vector<OrderBookEntry> OrderBook::getOrders(std::vector<OrderBookEntry>& or
 }
 
 /** matching engine */
+/** add a sale, a sale between two users is added for each side so both of them are settled
+ * the bid side is marked as the counterparty, the trade itself is counted once */
+static void addSale(std::vector<OrderBookEntry>& sales, OrderBookEntry const& sale, OrderBookEntry const& bid)
+{
+    sales.push_back(sale);
+    if (sale.orderType == OrderBookType::asksale && sale.username != "dataset" && bid.username != "dataset")
+    {
+        OrderBookEntry bidSide = sale;
+        bidSide.username = bid.username;
+        bidSide.orderType = OrderBookType::bidsale;
+        bidSide.orderID = bid.orderID;
+        bidSide.orderStatus = "counterparty";
+        sales.push_back(bidSide);
+    }
+}
+
 std::vector<std::vector<OrderBookEntry>> OrderBook::matchAsksToBids(std::vector<OrderBookEntry>& currentOrders, 
                                                        std::string product, 
                                                        std::string timestamp)
@@ -76,26 +171,26 @@ std::vector<std::vector<OrderBookEntry>> OrderBook::matchAsksToBids(std::vector<
         for (OrderBookEntry& bid : bids)
         {
             // skip bids that have been processed already (matched against asks in previous iterations)
-            if (bid.amount == 0)
+            if (bid.amount == Decimal{})
                 continue;
 
             if (bid.price >= ask.price)
             {
                 // creating sale record, username defaulted to dataset
                 // storing price difference between bid price and ask price in order to release the amounts from the reserved wallet
-                OrderBookEntry sale{ask.price, 0, timestamp, product, OrderBookType::asksale};
+                OrderBookEntry sale{ask.price, Decimal{}, timestamp, product, OrderBookType::asksale};
 
                 // initializing price difference to the OrderBookEntry for the sale
                 sale.priceDifference = bid.price - ask.price;
 
-                // both simusers and botusers can have orders placed
-                if (bid.username == "botuser")
+                // both simusers and botusers can have orders placed, as can the simulated accounts
+                if (bid.username != "dataset")
                 {
                     sale.username = bid.username;
                     sale.orderType = OrderBookType::bidsale;
                     sale.orderID = bid.orderID;
                 }
-                if (ask.username == "botuser")
+                if (ask.username != "dataset")
                 {
                     sale.username = ask.username;
                     sale.orderType = OrderBookType::asksale;
@@ -105,33 +200,33 @@ std::vector<std::vector<OrderBookEntry>> OrderBook::matchAsksToBids(std::vector<
                 if (bid.amount == ask.amount)
                 {
                     sale.amount = ask.amount;
-                    sales.push_back(sale);
+                    addSale(sales, sale, bid);
                     // bid has been fully covered so we need to set the bid amount to 0
-                    bid.amount = 0;
+                    bid.amount = Decimal{};
                     // ask has been fully covered so we need to set the ask amount to 0
-                    ask.amount = 0;
+                    ask.amount = Decimal{};
                     break;
                 }
 
                 if (bid.amount > ask.amount)
                 {
                     sale.amount = ask.amount;
-                    sales.push_back(sale);
+                    addSale(sales, sale, bid);
                     // bid has not been fully covered so deducting what was offset (the ask amount)
                     bid.amount = bid.amount - ask.amount;
                     // ask has been fully covered so we need to set the ask amount to 0
-                    ask.amount = 0;
+                    ask.amount = Decimal{};
                     break;
                 }
 
-                if (bid.amount < ask.amount && bid.amount > 0)
+                if (bid.amount < ask.amount && bid.amount > Decimal{})
                 {
                     sale.amount = bid.amount;
-                    sales.push_back(sale);
+                    addSale(sales, sale, bid);
                     // ask has not been fully covered so deducting what was offset (the bid amount)
                     ask.amount = ask.amount - bid.amount;
                     // bid has been fully covered so we need to set the bid amount to 0
-                    bid.amount = 0;
+                    bid.amount = Decimal{};
                 }
             }
 
@@ -143,19 +238,19 @@ std::vector<std::vector<OrderBookEntry>> OrderBook::matchAsksToBids(std::vector<
             }
         } // end bid for loop
 
-        // if the ask is placed by the bot and has not been fully processed, we add it to the list of active orders
+        // if the ask is placed by the bot or the accounts and has not been fully processed, we add it to the list of active orders
         // this check can be added here as we will not be iterating again over this ask
-        if (ask.username == "botuser" && ask.amount > 0)
+        if (ask.username != "dataset" && ask.amount > Decimal{})
         {
             activeUserOrders.push_back(ask);
         }       
 
     } // end ask for loop
 
-    // if the bid is placed by the bot and has not been fully processed, we add it to the list of active orders
+    // if the bid is placed by the bot or the accounts and has not been fully processed, we add it to the list of active orders
     for (OrderBookEntry& bid : bids)
     {
-        if (bid.username == "botuser" && bid.amount > 0)
+        if (bid.username != "dataset" && bid.amount > Decimal{})
         {
             activeUserOrders.push_back(bid);
         }  
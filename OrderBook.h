@@ -1,11 +1,14 @@
 #pragma once
 #include "OrderBookEntry.h"
+#include "TickIndex.h"
+#include "ProductVersions.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <tuple>
 
 class OrderBook
 {
@@ -16,9 +19,9 @@ class OrderBook
         /** matching engine, takes a vector of orders a product and a timestamps as inputs *
          * returns a list of orderbook entries representing executed sales*
          * also records unfulfilled bot orders to a vector of active orders*/
-        std::vector<std::vector<OrderBookEntry>> matchAsksToBids(std::vector<OrderBookEntry>& currentOrders, 
-                                                    std::string product, 
-                                                    std::string timestamp);
+        static std::vector<std::vector<OrderBookEntry>> matchAsksToBids(std::vector<OrderBookEntry>& currentOrders, 
+                                                           std::string product, 
+                                                           std::string timestamp);
 
         /** map of timestamps to vectors of all orders */
         std::map<std::string,std::vector<OrderBookEntry> > ordersByTimestamp;
@@ -28,9 +31,41 @@ class OrderBook
 
         /** vector of strings to store products */
         std::vector<std::string> products;
+
+        /** merge dataset orders of a tick that share product, side and price into one price level
+         * the level keeps the position of its first order, sums the amounts and counts the merged orders
+         * bot orders are never merged, returns the number of orders removed */
+        static size_t compactPriceLevels(std::vector<OrderBookEntry>& orders);
+
+        /** compact the price levels of every loaded tick and renumber the versions, returns the number of orders removed */
+        size_t compactPriceLevels();
+
+        /** build the range-query index over the loaded ticks, called before the first queryRange
+         * simulations never query ranges, so loading leaves it to the subcommands that do */
+        void buildIndex();
+
+        /** number the dataset orders of every product tick after tick, called once the data is loaded
+         * the versions are computed once here and read by every bot replaying the book */
+        void buildVersions();
+
+        /** version of the orders of a product at a position in timestamps, 0 if unknown
+         * equal versions mean the orders of the product are the same */
+        unsigned long long productVersion(std::string const& product, size_t tick) const;
+
+        /** volume, min/max price and VWAP of a product side between two timestamps (inclusive), empty before buildIndex */
+        RangeStats queryRange(std::string const& product,
+                              OrderBookType type,
+                              std::string const& fromTimestamp,
+                              std::string const& toTimestamp) const;
         
     private:
 
+        /** prefix-sum and sparse-table index over the tick series of every product */
+        TickIndex index;
+
+        /** versions of the orders of every product by tick position */
+        ProductVersions versions{true};
+
         /** Return vector of orders according to the filters applied*/
         static std::vector<OrderBookEntry> getOrders(std::vector<OrderBookEntry>& ordersList,
                                               OrderBookType type, 
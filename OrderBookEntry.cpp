@@ -1,7 +1,8 @@
 #include "OrderBookEntry.h" 
+#include <exception>
 
-OrderBookEntry::OrderBookEntry(double _price, 
-                               double _amount, 
+OrderBookEntry::OrderBookEntry(Decimal _price, 
+                               Decimal _amount, 
                                std::string _timestamp, 
                                std::string _product, 
                                OrderBookType _orderType,
@@ -17,7 +18,30 @@ OrderBookEntry::OrderBookEntry(double _price,
   priceDifference(_priceDifference),
   username(_username),
   orderStatus(_orderStatus),
-  orderID(_orderID)
+  orderID(_orderID),
+  orderCount(1)
+{
+
+};
+
+OrderBookEntry::OrderBookEntry(double _price, 
+                               double _amount, 
+                               std::string _timestamp, 
+                               std::string _product, 
+                               OrderBookType _orderType,
+                               double _priceDifference,
+                               std::string _username,
+                               std::string _orderStatus,
+                               std::string _orderID)
+: OrderBookEntry(Decimal::fromDouble(_price),
+                 Decimal::fromDouble(_amount),
+                 _timestamp,
+                 _product,
+                 _orderType,
+                 _priceDifference,
+                 _username,
+                 _orderStatus,
+                 _orderID)
 {
 
 };
@@ -35,6 +59,55 @@ OrderBookType OrderBookEntry::stringToOrderBookType(std::string s)
   return OrderBookType::unknown;
 };
 
+long long OrderBookEntry::timestampToMicros(std::string const& timestamp)
+{
+  // expected format: YYYY/MM/DD HH:MM:SS.ffffff, fractional part may be shorter or missing
+  if (timestamp.size() < 19)
+  {
+    throw std::exception{};
+  }
+  auto digits = [&timestamp](int pos, int count)
+  {
+    long long value = 0;
+    for (int i = pos; i < pos + count; ++i)
+    {
+      char c = timestamp[i];
+      if (c < '0' || c > '9')
+      {
+        throw std::exception{};
+      }
+      value = value * 10 + (c - '0');
+    }
+    return value;
+  };
+  long long year = digits(0, 4);
+  long long month = digits(5, 2);
+  long long day = digits(8, 2);
+  long long seconds = digits(11, 2) * 3600 + digits(14, 2) * 60 + digits(17, 2);
+
+  // days since 1970/01/01 for the proleptic Gregorian calendar
+  year -= month <= 2;
+  long long era = (year >= 0 ? year : year - 399) / 400;
+  long long yearOfEra = year - era * 400;
+  long long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long long days = era * 146097 + dayOfEra - 719468;
+
+  // fractional seconds padded to microseconds
+  long long micros = 0;
+  int fractionDigits = 0;
+  for (size_t i = 20; i < timestamp.size() && fractionDigits < 6; ++i, ++fractionDigits)
+  {
+    micros = micros * 10 + digits(i, 1);
+  }
+  for (; fractionDigits < 6; ++fractionDigits)
+  {
+    micros *= 10;
+  }
+
+  return (days * 86400 + seconds) * 1000000 + micros;
+}
+
 bool OrderBookEntry::compareByTimestamp(const OrderBookEntry& e1, const OrderBookEntry& e2)
 {
   return e1.timestamp < e2.timestamp;
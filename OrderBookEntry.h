@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "Decimal.h"
 	
 enum class OrderBookType {bid, ask, unknown, asksale, bidsale};
 
@@ -7,6 +8,17 @@ class OrderBookEntry
 {
 	public:
 
+		OrderBookEntry(Decimal _price, 
+					   Decimal _amount, 
+					   std::string _timestamp, 
+					   std::string _product, 
+					   OrderBookType _orderType,
+					   double _priceDifference = 0,
+					   std::string _username = "dataset",
+					   std::string _orderStatus = "initial",
+					   std::string _orderID = "");
+
+		/** price and amount computed in floating point are rounded to the nearest decimal */
 		OrderBookEntry(double _price, 
 					   double _amount, 
 					   std::string _timestamp, 
@@ -19,14 +31,18 @@ class OrderBookEntry
 
 		static OrderBookType stringToOrderBookType(std::string s);
 
+		/** convert a timestamp like 2020/03/17 17:01:24.884492 to microseconds since epoch */
+		static long long timestampToMicros(std::string const& timestamp);
+
 		static bool compareByTimestamp(const OrderBookEntry& e1, const OrderBookEntry& e2);
 
 		static bool compareByPriceAsc(const OrderBookEntry& e1, const OrderBookEntry& e2);
 
 		static bool compareByPriceDesc(const OrderBookEntry& e1, const OrderBookEntry& e2);
 
-		double price;
-		double amount;
+		// fixed-point so that matching compares and subtracts exactly
+		Decimal price;
+		Decimal amount;
 		std::string timestamp;
 		std::string product;
 		OrderBookType orderType;
@@ -34,4 +50,6 @@ class OrderBookEntry
 		std::string username;
 		std::string orderStatus;
 		std::string orderID;
+		// dataset rows merged into this entry when price levels are compacted, 1 otherwise
+		int orderCount;
 };
\ No newline at end of file
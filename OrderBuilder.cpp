@@ -0,0 +1,93 @@
+#include "OrderBuilder.h"
+#include <cmath>
+
+OrderBuilder::OrderBuilder(int _amountDecimals)
+: amountDecimals(_amountDecimals)
+{
+
+}
+
+/** ID of a product, added on first use */
+int OrderBuilder::internProduct(std::string const& product)
+{
+    auto it = productIds.find(product);
+    if (it != productIds.end())
+    {
+        return it->second;
+    }
+    productNames.push_back(product);
+    productIds[product] = productNames.size() - 1;
+    return productNames.size() - 1;
+}
+
+/** ID of a user, added on first use */
+int OrderBuilder::internUser(std::string const& username)
+{
+    auto it = userIds.find(username);
+    if (it != userIds.end())
+    {
+        return it->second;
+    }
+    userNames.push_back(username);
+    userIds[username] = userNames.size() - 1;
+    return userNames.size() - 1;
+}
+
+std::string const& OrderBuilder::productName(int product) const
+{
+    return productNames[product];
+}
+
+std::string const& OrderBuilder::userName(int user) const
+{
+    return userNames[user];
+}
+
+/** fill order from computed values */
+OrderValidation OrderBuilder::build(OrderBookEntry& order,
+                                    OrderBookType orderType,
+                                    int product,
+                                    int user,
+                                    double price,
+                                    double amount,
+                                    std::string const& timestamp) const
+{
+    if (product < 0 || product >= (int)productNames.size())
+    {
+        return OrderValidation::unknownProduct;
+    }
+    if (user < 0 || user >= (int)userNames.size())
+    {
+        return OrderValidation::unknownUser;
+    }
+
+    // checked before rounding, rounding to 0 would place an order of nothing
+    if (!std::isfinite(price))
+    {
+        return OrderValidation::badPrice;
+    }
+    if (!std::isfinite(amount))
+    {
+        return OrderValidation::badAmount;
+    }
+    Decimal fixedPrice = Decimal::fromDouble(price);
+    Decimal fixedAmount = Decimal::fromDouble(amount, amountDecimals);
+    if (fixedPrice <= Decimal{})
+    {
+        return OrderValidation::badPrice;
+    }
+    if (fixedAmount <= Decimal{})
+    {
+        return OrderValidation::badAmount;
+    }
+
+    order.price = fixedPrice;
+    order.amount = fixedAmount;
+    order.timestamp = timestamp;
+    order.product = productNames[product];
+    order.orderType = orderType;
+    order.priceDifference = 0;
+    order.username = userNames[user];
+    order.orderStatus = "initial";
+    return OrderValidation::ok;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+
+/** outcome of building an order, anything but ok means no order was built */
+enum class OrderValidation {ok, badPrice, badAmount, unknownProduct, unknownUser};
+
+/** builds orders the bot computes itself straight from numbers
+ * products and users are interned once into small integer IDs, so building an order
+ * does no string formatting, parsing or map lookup and never throws */
+class OrderBuilder
+{
+    public:
+        /** decimals kept for amounts, as std::to_string did when orders went through text */
+        OrderBuilder(int _amountDecimals = 6);
+
+        /** ID of a product, added on first use */
+        int internProduct(std::string const& product);
+
+        /** ID of a user, added on first use */
+        int internUser(std::string const& username);
+
+        std::string const& productName(int product) const;
+        std::string const& userName(int user) const;
+
+        /** fill order from computed values
+         * the price is rounded to the 8 decimals of the exchange and the amount to the builder's decimals,
+         * both must be finite and positive and the IDs must have been interned */
+        OrderValidation build(OrderBookEntry& order,
+                              OrderBookType orderType,
+                              int product,
+                              int user,
+                              double price,
+                              double amount,
+                              std::string const& timestamp) const;
+
+    private:
+        int amountDecimals;
+        std::vector<std::string> productNames;
+        std::vector<std::string> userNames;
+        std::map<std::string, int> productIds;
+        std::map<std::string, int> userIds;
+};
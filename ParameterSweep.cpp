@@ -0,0 +1,110 @@
+#include "ParameterSweep.h"
+#include "MerkelBot.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+
+double SweepResult::returnPercent() const
+{
+    if (initialAssetsUSD == 0)
+    {
+        return 0;
+    }
+    return (finalAssetsUSD / initialAssetsUSD - 1) * 100;
+}
+
+ParameterSweep::ParameterSweep(std::shared_ptr<const OrderBook> _dataset, SweepGrid _grid, int _threads)
+: dataset(_dataset),
+  grid(_grid),
+  threads(_threads)
+{
+
+}
+
+/** expand the grid into one parameter set per combination */
+std::vector<SweepResult> ParameterSweep::combinations() const
+{
+    std::vector<SweepResult> runs;
+    for (int window : grid.regressionWindows)
+    {
+        for (int horizon : grid.predictionHorizons)
+        {
+            for (double fraction : grid.standardOrderFractions)
+            {
+                for (double scale : grid.fundScales)
+                {
+                    SweepResult r;
+                    r.parameters.regressionWindow = window;
+                    r.parameters.predictionHorizon = horizon;
+                    r.parameters.standardOrderFraction = fraction;
+                    for (auto& e : r.parameters.initialFunds)
+                    {
+                        e.second *= scale;
+                    }
+                    r.fundScale = scale;
+                    runs.push_back(r);
+                }
+            }
+        }
+    }
+    return runs;
+}
+
+/** run every combination, results are ranked by return, best first */
+std::vector<SweepResult> ParameterSweep::run()
+{
+    std::vector<SweepResult> results = combinations();
+    WorkStealingPool pool{threads};
+    for (SweepResult& r : results)
+    {
+        pool.submit([this, &r]()
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+
+            // the bot only holds its own wallets, resting orders and predictions, the order book is shared
+            MerkelBot bot{dataset};
+            bot.setParameters(r.parameters);
+            bot.setLogging(false);
+            bot.setVerbose(false);
+            bot.init();
+
+            r.initialAssetsUSD = bot.getInitialAssetsUSD();
+            r.finalAssetsUSD = bot.getTotalAssetsUSD();
+            r.fills = bot.getFillCount();
+            r.orders = bot.getOrderCount();
+
+            auto stop = std::chrono::high_resolution_clock::now();
+            r.wallTimeMicros = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+        });
+    }
+    pool.wait();
+
+    // funds scales change the absolute value, so the ranking uses the return
+    std::stable_sort(results.begin(), results.end(), [](SweepResult const& a, SweepResult const& b)
+    {
+        return a.returnPercent() > b.returnPercent();
+    });
+    return results;
+}
+
+/** write the ranked results table as CSV, limit 0 writes every row */
+void ParameterSweep::writeResults(std::vector<SweepResult> const& results, std::ostream& out, size_t limit)
+{
+    out << "Rank,Regression_Window,Prediction_Horizon,Order_Fraction,Funds_Scale,";
+    out << "Initial_Assets_USD,Final_Assets_USD,Return_Percent,Fills,Orders,Wall_Time_Microseconds" << std::endl;
+    for (size_t i = 0; i < results.size() && (limit == 0 || i < limit); ++i)
+    {
+        SweepResult const& r = results[i];
+        out << i + 1 << ",";
+        out << r.parameters.regressionWindow << ",";
+        out << r.parameters.predictionHorizon << ",";
+        out << r.parameters.standardOrderFraction << ",";
+        out << r.fundScale << ",";
+        out << std::to_string(r.initialAssetsUSD) << ",";
+        out << std::to_string(r.finalAssetsUSD) << ",";
+        out << std::to_string(r.returnPercent()) << ",";
+        out << r.fills << ",";
+        out << r.orders << ",";
+        out << r.wallTimeMicros << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "BotParameters.h"
+#include "OrderBook.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+
+/** values to try for each strategy constant, every combination is evaluated */
+struct SweepGrid
+{
+    std::vector<int> regressionWindows = {14};
+    std::vector<int> predictionHorizons = {7};
+    std::vector<double> standardOrderFractions = {0.05};
+    // multipliers applied to the default initial funds
+    std::vector<double> fundScales = {1};
+};
+
+/** outcome of one parameter combination */
+struct SweepResult
+{
+    BotParameters parameters;
+    double fundScale = 1;
+    double initialAssetsUSD = 0;
+    double finalAssetsUSD = 0;
+    int fills = 0;
+    int orders = 0;
+    long long wallTimeMicros = 0;
+
+    /** final value relative to the initial value, in percent */
+    double returnPercent() const;
+};
+
+/** evaluates a grid of strategy parameters concurrently over one shared, read-only dataset */
+class ParameterSweep
+{
+    public:
+        /** threads 0 uses one worker per hardware thread */
+        ParameterSweep(std::shared_ptr<const OrderBook> _dataset, SweepGrid _grid, int _threads = 0);
+
+        /** run every combination, results are ranked by return, best first */
+        std::vector<SweepResult> run();
+
+        /** write the ranked results table as CSV, limit 0 writes every row */
+        static void writeResults(std::vector<SweepResult> const& results, std::ostream& out, size_t limit = 0);
+
+    private:
+        /** expand the grid into one parameter set per combination */
+        std::vector<SweepResult> combinations() const;
+
+        std::shared_ptr<const OrderBook> dataset;
+        SweepGrid grid;
+        int threads;
+};
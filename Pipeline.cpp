@@ -0,0 +1,269 @@
+#include "Pipeline.h"
+#include <filesystem>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+/** restrict a native thread to one core */
+static bool pinNativeThread(pthread_t thread, int core)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    return pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpus) == 0;
+}
+#endif
+
+/** pin a thread to one CPU core, -1 leaves it unpinned, returns false if pinning is not possible */
+bool pinThreadToCore(std::thread& thread, int core)
+{
+    if (core < 0)
+    {
+        return true;
+    }
+#ifdef __linux__
+    return pinNativeThread(thread.native_handle(), core);
+#else
+    return false;
+#endif
+}
+
+/** pin the calling thread to one CPU core, -1 leaves it unpinned */
+bool pinCurrentThreadToCore(int core)
+{
+    if (core < 0)
+    {
+        return true;
+    }
+#ifdef __linux__
+    return pinNativeThread(pthread_self(), core);
+#else
+    return false;
+#endif
+}
+
+TickIngest::TickIngest(std::vector<std::string> const& files, size_t capacity, int core)
+: stream(files),
+  ticks(capacity)
+{
+    ingest = std::thread([this]() { run(); });
+    if (!pinThreadToCore(ingest, core))
+    {
+        std::cout << "TickIngest cannot pin the ingest stage to core " << core << std::endl;
+    }
+}
+
+TickIngest::~TickIngest()
+{
+    // the simulation may stop before the end of the data, the ingest thread then gives up on a full ring
+    stopping = true;
+    if (ingest.joinable())
+    {
+        ingest.join();
+    }
+}
+
+void TickIngest::run()
+{
+    Tick tick;
+    while (stream.nextTick(tick))
+    {
+        if (ticks.tryPush(tick))
+        {
+            continue;
+        }
+        ticks.pushStalls++;
+        while (!ticks.tryPush(tick))
+        {
+            if (stopping)
+            {
+                ticks.close();
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+    ticks.close();
+}
+
+/** next tick in timestamp order, waits for the ingest thread, false at the end of the data */
+bool TickIngest::nextTick(Tick& tick)
+{
+    return ticks.pop(tick);
+}
+
+/** queue depth and stall counts */
+void TickIngest::report(std::ostream& out) const
+{
+    out << "Ingest -> simulation queue: max depth " << ticks.maxDepth << "/" << ticks.capacity();
+    out << ", ingest stalls (queue full) " << ticks.pushStalls;
+    out << ", simulation stalls (queue empty) " << ticks.popStalls << std::endl;
+}
+
+LogWriter::LogWriter(std::vector<std::string> const& paths,
+                     std::vector<long long> const& resumeOffsets,
+                     bool _threaded,
+                     size_t capacity,
+                     int core)
+: threaded(_threaded)
+{
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        std::error_code error;
+        if (resumeOffsets.empty())
+        {
+            files.push_back(std::unique_ptr<std::ofstream>(new std::ofstream{paths[i]}));
+            positions.push_back(0);
+            continue;
+        }
+        // a resumed run drops whatever was logged after the checkpoint
+        long long offset = i < resumeOffsets.size() ? resumeOffsets[i] : -1;
+        if (offset >= 0)
+        {
+            std::filesystem::resize_file(paths[i], offset, error);
+        }
+        files.push_back(std::unique_ptr<std::ofstream>(new std::ofstream{paths[i], std::ios::app}));
+        long long size = std::filesystem::file_size(paths[i], error);
+        positions.push_back(error ? 0 : size);
+    }
+
+    if (threaded)
+    {
+        batches.reset(new SpscRing<std::vector<std::string>>{capacity});
+        writer = std::thread([this]() { run(); });
+        if (!pinThreadToCore(writer, core))
+        {
+            std::cout << "LogWriter cannot pin the log stage to core " << core << std::endl;
+        }
+    }
+}
+
+/** writes everything queued and closes the files */
+LogWriter::~LogWriter()
+{
+    if (threaded)
+    {
+        batches->close();
+        writer.join();
+    }
+    for (auto& file : files)
+    {
+        file->close();
+    }
+}
+
+/** queue one batch of text, one entry per log file, the entries are moved out */
+void LogWriter::write(std::vector<std::string>& texts)
+{
+    // positions count everything handed over, the writer thread only touches the files
+    for (size_t i = 0; i < texts.size() && i < positions.size(); ++i)
+    {
+        positions[i] += texts[i].size();
+    }
+    batchesSubmitted++;
+    if (threaded)
+    {
+        batches->push(std::move(texts));
+        texts.assign(files.size(), std::string{});
+    }
+    else
+    {
+        writeBatch(texts);
+    }
+}
+
+/** write one batch to the files */
+void LogWriter::writeBatch(std::vector<std::string>& texts)
+{
+    for (size_t i = 0; i < texts.size() && i < files.size(); ++i)
+    {
+        if (!texts[i].empty())
+        {
+            files[i]->write(texts[i].data(), texts[i].size());
+            texts[i].clear();
+        }
+    }
+}
+
+/** writer loop of the threaded mode */
+void LogWriter::run()
+{
+    std::vector<std::string> texts;
+    bool waiting = false;
+    while (true)
+    {
+        if (batches->tryPop(texts))
+        {
+            writeBatch(texts);
+            batchesWritten++;
+            waiting = false;
+            continue;
+        }
+        if (flushRequested.load(std::memory_order_acquire))
+        {
+            // batches queued before the request are visible now
+            if (batches->tryPop(texts))
+            {
+                writeBatch(texts);
+                batchesWritten++;
+                continue;
+            }
+            for (auto& file : files)
+            {
+                file->flush();
+            }
+            flushRequested = false;
+            batchesFlushed = batchesWritten.load();
+            continue;
+        }
+        if (batches->isClosed() && batches->depth() == 0)
+        {
+            return;
+        }
+        // one stall per wait for the simulation, not per spin
+        if (!waiting)
+        {
+            batches->popStalls++;
+            waiting = true;
+        }
+        std::this_thread::yield();
+    }
+}
+
+/** wait until everything written so far has reached the files */
+void LogWriter::flush()
+{
+    if (!threaded)
+    {
+        for (auto& file : files)
+        {
+            file->flush();
+        }
+        return;
+    }
+    flushRequested = true;
+    while (batchesFlushed.load() < batchesSubmitted)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/** size of a log file once everything written so far has reached it */
+long long LogWriter::position(size_t file) const
+{
+    return positions[file];
+}
+
+/** queue depth and stall counts */
+void LogWriter::report(std::ostream& out) const
+{
+    if (!threaded)
+    {
+        return;
+    }
+    out << "Simulation -> log queue: max depth " << batches->maxDepth << "/" << batches->capacity();
+    out << ", simulation stalls (queue full) " << batches->pushStalls;
+    out << ", log stalls (queue empty) " << batches->popStalls << std::endl;
+}
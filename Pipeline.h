@@ -0,0 +1,94 @@
+#pragma once
+#include "SpscRing.h"
+#include "TickStream.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+/** pin a thread to one CPU core, -1 leaves it unpinned, returns false if pinning is not possible */
+bool pinThreadToCore(std::thread& thread, int core);
+
+/** pin the calling thread to one CPU core, -1 leaves it unpinned */
+bool pinCurrentThreadToCore(int core);
+
+/** stage 1 of the pipeline: pulls merged ticks from the dataset files on its own thread
+ * and hands them to the simulation through a single-producer/single-consumer ring */
+class TickIngest
+{
+    public:
+        TickIngest(std::vector<std::string> const& files, size_t capacity = 64, int core = -1);
+        ~TickIngest();
+
+        TickIngest(TickIngest const&) = delete;
+        TickIngest& operator=(TickIngest const&) = delete;
+
+        /** next tick in timestamp order, waits for the ingest thread, false at the end of the data */
+        bool nextTick(Tick& tick);
+
+        /** queue depth and stall counts */
+        void report(std::ostream& out) const;
+
+    private:
+        void run();
+
+        TickStream stream;
+        SpscRing<Tick> ticks;
+        std::atomic<bool> stopping{false};
+        std::thread ingest;
+};
+
+/** stage 3 of the pipeline: writes the text of the bot logs to their files
+ * the simulation formats every tick into memory and hands the text over as one batch per tick
+ * with threaded off the batches are written on the calling thread */
+class LogWriter
+{
+    public:
+        /** open the log files, new files are created empty
+         * when resuming, files with an offset are cut back to that size and every file is appended to */
+        LogWriter(std::vector<std::string> const& paths,
+                  std::vector<long long> const& resumeOffsets = {},
+                  bool threaded = false,
+                  size_t capacity = 64,
+                  int core = -1);
+        /** writes everything queued and closes the files */
+        ~LogWriter();
+
+        LogWriter(LogWriter const&) = delete;
+        LogWriter& operator=(LogWriter const&) = delete;
+
+        /** queue one batch of text, one entry per log file, the entries are moved out */
+        void write(std::vector<std::string>& texts);
+
+        /** wait until everything written so far has reached the files */
+        void flush();
+
+        /** size of a log file once everything written so far has reached it */
+        long long position(size_t file) const;
+
+        /** queue depth and stall counts */
+        void report(std::ostream& out) const;
+
+    private:
+        /** write one batch to the files */
+        void writeBatch(std::vector<std::string>& texts);
+
+        /** writer loop of the threaded mode */
+        void run();
+
+        std::vector<std::unique_ptr<std::ofstream>> files;
+        std::vector<long long> positions;
+        bool threaded;
+
+        // batches handed over, batches written and batches known to be flushed to the files
+        long long batchesSubmitted = 0;
+        std::atomic<long long> batchesWritten{0};
+        std::atomic<long long> batchesFlushed{0};
+        std::atomic<bool> flushRequested{false};
+
+        std::unique_ptr<SpscRing<std::vector<std::string>>> batches;
+        std::thread writer;
+};
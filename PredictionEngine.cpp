@@ -0,0 +1,466 @@
+#include "PredictionEngine.h"
+#include "CSVReader.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+PredictionEngine::PredictionEngine()
+{
+    history.resize(capacity);
+}
+
+/** replace the models, the products are kept and everything else starts again */
+void PredictionEngine::configure(int _horizon, std::vector<ForecastSpec> const& specs)
+{
+    horizon = _horizon;
+    size_t count = productNames.size();
+
+    capacity = 1;
+    models.clear();
+    for (ForecastSpec const& spec : specs)
+    {
+        Model model;
+        model.spec = spec;
+        model.level.assign(count, 0);
+        model.trend.assign(count, 0);
+        model.variance.assign(count, 0);
+        model.prediction.assign(count, 0);
+        model.past.assign(std::max(horizon, 0), std::vector<double>(count, 0));
+        models.push_back(model);
+        if (spec.kind == ForecastKind::regression)
+        {
+            capacity = std::max<size_t>(capacity, std::max(spec.window, 1));
+        }
+    }
+
+    history.assign(capacity, std::vector<double>(count, 0));
+    tickCount = 0;
+    observed.assign(count, 0);
+}
+
+/** ID of a product, added on first use with no prices seen */
+int PredictionEngine::addProduct(std::string const& product)
+{
+    auto it = productIds.find(product);
+    if (it != productIds.end())
+    {
+        return it->second;
+    }
+    int id = productNames.size();
+    productIds[product] = id;
+    productNames.push_back(product);
+
+    // a new column in every array, the history has a price of 0 for the ticks before it
+    for (std::vector<double>& row : history)
+    {
+        row.push_back(0);
+    }
+    observed.push_back(0);
+    for (Model& model : models)
+    {
+        model.level.push_back(0);
+        model.trend.push_back(0);
+        model.variance.push_back(0);
+        model.prediction.push_back(0);
+        for (std::vector<double>& row : model.past)
+        {
+            row.push_back(0);
+        }
+    }
+    return id;
+}
+
+size_t PredictionEngine::productCount() const
+{
+    return productNames.size();
+}
+
+size_t PredictionEngine::modelCount() const
+{
+    return models.size();
+}
+
+long long PredictionEngine::ticks() const
+{
+    return tickCount;
+}
+
+/** feed the prices of one tick indexed by product ID, 0 for a product without a price */
+void PredictionEngine::update(std::vector<double> const& prices)
+{
+    size_t count = productNames.size();
+    std::vector<double>& row = history[tickCount % capacity];
+    std::copy_n(prices.begin(), std::min(prices.size(), count), row.begin());
+    std::fill(row.begin() + std::min(prices.size(), count), row.end(), 0);
+
+    for (Model& model : models)
+    {
+        score(model, row.data());
+    }
+    tickCount++;
+
+    for (Model& model : models)
+    {
+        switch (model.spec.kind)
+        {
+            case ForecastKind::regression:
+                updateRegression(model);
+                break;
+            case ForecastKind::ewma:
+                updateEwma(model, row.data());
+                break;
+            case ForecastKind::holt:
+                updateHolt(model, row.data());
+                break;
+            case ForecastKind::kalman:
+                updateKalman(model, row.data());
+                break;
+        }
+        // kept until the tick they predict
+        if (horizon > 0)
+        {
+            model.past[(tickCount - 1) % horizon] = model.prediction;
+        }
+    }
+
+    for (size_t p = 0; p < count; ++p)
+    {
+        observed[p] += row[p] > 0 ? 1 : 0;
+    }
+}
+
+/** add the errors of the predictions made horizon ticks ago for these prices */
+void PredictionEngine::score(Model& model, const double* prices)
+{
+    if (horizon <= 0 || tickCount < horizon)
+    {
+        return;
+    }
+    const double* predicted = model.past[tickCount % horizon].data();
+    size_t count = productNames.size();
+    for (size_t p = 0; p < count; ++p)
+    {
+        if (prices[p] > 0 && predicted[p] > 0)
+        {
+            model.errorSum += std::abs(predicted[p] - prices[p]) / prices[p];
+            model.errorCount++;
+        }
+    }
+}
+
+/** linear regression over the last window ticks, x values are tick positions
+ * the sums run in the same order as a regression over one product at a time, so the results match it exactly */
+void PredictionEngine::updateRegression(Model& model)
+{
+    size_t count = productNames.size();
+    long long n = std::min<long long>(model.spec.window, tickCount);
+    if (n <= 0)
+    {
+        std::fill(model.prediction.begin(), model.prediction.end(), 0);
+        return;
+    }
+    long long first = tickCount - n;
+
+    // the x values are the same for every product
+    double sumX = 0;
+    for (long long x = first; x < tickCount; ++x)
+    {
+        sumX += x;
+    }
+    double meanX = sumX / n;
+    double lower = 0;
+    for (long long x = first; x < tickCount; ++x)
+    {
+        lower += (x - meanX) * (x - meanX);
+    }
+
+    sumY.assign(count, 0);
+    upper.assign(count, 0);
+    double* sums = sumY.data();
+    double* uppers = upper.data();
+    for (long long x = first; x < tickCount; ++x)
+    {
+        const double* y = history[x % capacity].data();
+        for (size_t p = 0; p < count; ++p)
+        {
+            sums[p] += y[p];
+        }
+    }
+    for (size_t p = 0; p < count; ++p)
+    {
+        sums[p] /= n;
+    }
+    for (long long x = first; x < tickCount; ++x)
+    {
+        const double* y = history[x % capacity].data();
+        double dx = x - meanX;
+        for (size_t p = 0; p < count; ++p)
+        {
+            uppers[p] += dx * (y[p] - sums[p]);
+        }
+    }
+
+    double target = tickCount - 1 + horizon;
+    double* prediction = model.prediction.data();
+    for (size_t p = 0; p < count; ++p)
+    {
+        double coeff = uppers[p] / lower;
+        double intercept = sums[p] - coeff * meanX;
+        prediction[p] = intercept + coeff * target;
+    }
+}
+
+/** products without a price keep their state, the first price starts it */
+void PredictionEngine::updateEwma(Model& model, const double* prices)
+{
+    size_t count = productNames.size();
+    double alpha = model.spec.alpha;
+    double* level = model.level.data();
+    double* prediction = model.prediction.data();
+    for (size_t p = 0; p < count; ++p)
+    {
+        double next = observed[p] == 0 ? prices[p] : alpha * prices[p] + (1 - alpha) * level[p];
+        level[p] = prices[p] > 0 ? next : level[p];
+        prediction[p] = level[p];
+    }
+}
+
+void PredictionEngine::updateHolt(Model& model, const double* prices)
+{
+    size_t count = productNames.size();
+    double alpha = model.spec.alpha;
+    double beta = model.spec.beta;
+    double* level = model.level.data();
+    double* trend = model.trend.data();
+    double* prediction = model.prediction.data();
+    for (size_t p = 0; p < count; ++p)
+    {
+        bool first = observed[p] == 0;
+        double nextLevel = first ? prices[p] : alpha * prices[p] + (1 - alpha) * (level[p] + trend[p]);
+        double nextTrend = first ? 0 : beta * (nextLevel - level[p]) + (1 - beta) * trend[p];
+        bool seen = prices[p] > 0;
+        level[p] = seen ? nextLevel : level[p];
+        trend[p] = seen ? nextTrend : trend[p];
+        prediction[p] = level[p] + horizon * trend[p];
+    }
+}
+
+/** the variance is in units of the measurement noise, so one ratio fits products at any price scale */
+void PredictionEngine::updateKalman(Model& model, const double* prices)
+{
+    size_t count = productNames.size();
+    double processNoise = model.spec.alpha;
+    double* level = model.level.data();
+    double* variance = model.variance.data();
+    double* prediction = model.prediction.data();
+    for (size_t p = 0; p < count; ++p)
+    {
+        bool first = observed[p] == 0;
+        double priorVariance = variance[p] + processNoise;
+        double gain = priorVariance / (priorVariance + 1);
+        double nextLevel = first ? prices[p] : level[p] + gain * (prices[p] - level[p]);
+        double nextVariance = first ? 1 : (1 - gain) * priorVariance;
+        bool seen = prices[p] > 0;
+        level[p] = seen ? nextLevel : level[p];
+        variance[p] = seen ? nextVariance : variance[p];
+        prediction[p] = level[p];
+    }
+}
+
+/** price fed for a product ticksAgo ticks before the last one, 0 if it is no longer kept */
+double PredictionEngine::pastPrice(int product, int ticksAgo) const
+{
+    if (ticksAgo < 0 || ticksAgo >= (long long)capacity || ticksAgo >= tickCount)
+    {
+        return 0;
+    }
+    return history[(tickCount - 1 - ticksAgo) % capacity][product];
+}
+
+double PredictionEngine::prediction(int model, int product) const
+{
+    return models[model].prediction[product];
+}
+
+/** weighted average of the predictions of several models for one product */
+double PredictionEngine::combined(std::vector<std::pair<int, double>> const& weights, int product) const
+{
+    double sum = 0, weightSum = 0;
+    for (std::pair<int, double> const& w : weights)
+    {
+        if (w.first < 0 || w.first >= (int)models.size())
+        {
+            continue;
+        }
+        sum += w.second * models[w.first].prediction[product];
+        weightSum += w.second;
+    }
+    return weightSum != 0 ? sum / weightSum : 0;
+}
+
+double PredictionEngine::meanError(int model) const
+{
+    return models[model].errorCount > 0 ? models[model].errorSum / models[model].errorCount : 0;
+}
+
+/** one line per model with its settings and its error */
+void PredictionEngine::report(std::ostream& out) const
+{
+    for (size_t m = 0; m < models.size(); ++m)
+    {
+        out << "Prediction model " << m << " " << describe(models[m].spec) << ": mean absolute error "
+            << meanError(m) * 100 << "% over " << models[m].errorCount << " predictions" << std::endl;
+    }
+}
+
+/** state for a checkpoint */
+void PredictionEngine::save(BinaryWriter& out) const
+{
+    out.writeInt(horizon);
+    out.writeInt(tickCount);
+    out.writeInt(models.size());
+    for (Model const& model : models)
+    {
+        out.writeInt((int)model.spec.kind);
+        out.writeInt(model.spec.window);
+        out.writeDouble(model.spec.alpha);
+        out.writeDouble(model.spec.beta);
+        out.writeDouble(model.errorSum);
+        out.writeInt(model.errorCount);
+    }
+
+    out.writeInt(productNames.size());
+    for (size_t p = 0; p < productNames.size(); ++p)
+    {
+        out.writeString(productNames[p]);
+        out.writeDouble(observed[p]);
+        for (std::vector<double> const& row : history)
+        {
+            out.writeDouble(row[p]);
+        }
+        for (Model const& model : models)
+        {
+            out.writeDouble(model.level[p]);
+            out.writeDouble(model.trend[p]);
+            out.writeDouble(model.variance[p]);
+            out.writeDouble(model.prediction[p]);
+            for (std::vector<double> const& row : model.past)
+            {
+                out.writeDouble(row[p]);
+            }
+        }
+    }
+}
+
+/** the models of the checkpoint replace the configured ones */
+void PredictionEngine::restore(BinaryReader& in)
+{
+    int savedHorizon = in.readInt();
+    long long savedTicks = in.readInt();
+    std::vector<ForecastSpec> specs;
+    std::vector<std::pair<double, long long>> errors;
+    long long modelTotal = in.readInt();
+    for (long long m = 0; m < modelTotal; ++m)
+    {
+        ForecastSpec spec;
+        spec.kind = (ForecastKind)in.readInt();
+        spec.window = in.readInt();
+        spec.alpha = in.readDouble();
+        spec.beta = in.readDouble();
+        specs.push_back(spec);
+        double errorSum = in.readDouble();
+        errors.push_back({errorSum, in.readInt()});
+    }
+    configure(savedHorizon, specs);
+    tickCount = savedTicks;
+    for (size_t m = 0; m < models.size(); ++m)
+    {
+        models[m].errorSum = errors[m].first;
+        models[m].errorCount = errors[m].second;
+    }
+
+    long long products = in.readInt();
+    for (long long i = 0; i < products; ++i)
+    {
+        int p = addProduct(in.readString());
+        observed[p] = in.readDouble();
+        for (std::vector<double>& row : history)
+        {
+            row[p] = in.readDouble();
+        }
+        for (Model& model : models)
+        {
+            model.level[p] = in.readDouble();
+            model.trend[p] = in.readDouble();
+            model.variance[p] = in.readDouble();
+            model.prediction[p] = in.readDouble();
+            for (std::vector<double>& row : model.past)
+            {
+                row[p] = in.readDouble();
+            }
+        }
+    }
+}
+
+/** parse a model like regression:14, ewma:0.3, holt:0.5:0.1 or kalman:0.05 */
+ForecastSpec PredictionEngine::parseSpec(std::string const& text)
+{
+    std::vector<std::string> tokens = CSVReader::tokenise(text, ':');
+    ForecastSpec spec;
+    try
+    {
+        if (tokens.size() == 2 && tokens[0] == "regression")
+        {
+            spec.kind = ForecastKind::regression;
+            spec.window = std::stoi(tokens[1]);
+            return spec;
+        }
+        if (tokens.size() == 2 && tokens[0] == "ewma")
+        {
+            spec.kind = ForecastKind::ewma;
+            spec.alpha = std::stod(tokens[1]);
+            return spec;
+        }
+        if (tokens.size() == 3 && tokens[0] == "holt")
+        {
+            spec.kind = ForecastKind::holt;
+            spec.alpha = std::stod(tokens[1]);
+            spec.beta = std::stod(tokens[2]);
+            return spec;
+        }
+        if (tokens.size() == 2 && tokens[0] == "kalman")
+        {
+            spec.kind = ForecastKind::kalman;
+            spec.alpha = std::stod(tokens[1]);
+            return spec;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // bad numbers are reported below like an unknown model
+    }
+    throw std::invalid_argument{"bad prediction model " + text};
+}
+
+/** the model in the form parseSpec reads */
+std::string PredictionEngine::describe(ForecastSpec const& spec)
+{
+    std::ostringstream text;
+    switch (spec.kind)
+    {
+        case ForecastKind::regression:
+            text << "regression:" << spec.window;
+            break;
+        case ForecastKind::ewma:
+            text << "ewma:" << spec.alpha;
+            break;
+        case ForecastKind::holt:
+            text << "holt:" << spec.alpha << ":" << spec.beta;
+            break;
+        case ForecastKind::kalman:
+            text << "kalman:" << spec.alpha;
+            break;
+    }
+    return text.str();
+}
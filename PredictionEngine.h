@@ -0,0 +1,114 @@
+#pragma once
+#include "Checkpoint.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+/** kinds of forecasting models */
+enum class ForecastKind {regression, ewma, holt, kalman};
+
+/** a forecasting model and its settings
+ * regression: linear regression over the last window prices
+ * ewma: exponentially weighted moving average with smoothing alpha
+ * holt: linear trend with level smoothing alpha and trend smoothing beta
+ * kalman: random walk filter, alpha is the ratio of the process noise to the measurement noise */
+struct ForecastSpec
+{
+    ForecastKind kind = ForecastKind::regression;
+    int window = 14;
+    double alpha = 0.3;
+    double beta = 0.1;
+};
+
+/** runs several forecasting models over the prices of all products
+ * the state of every model is kept as one array per quantity indexed by product ID, so one tick updates
+ * each model with a loop over contiguous arrays the compiler can vectorize instead of one map lookup per
+ * product and model; the predictions target horizon ticks ahead and are scored once that tick arrives */
+class PredictionEngine
+{
+    public:
+        PredictionEngine();
+
+        /** replace the models, their IDs are their positions in the list
+         * the products are kept, the price history and the model state start again */
+        void configure(int _horizon, std::vector<ForecastSpec> const& specs);
+
+        /** ID of a product, added on first use with no prices seen */
+        int addProduct(std::string const& product);
+
+        size_t productCount() const;
+        size_t modelCount() const;
+
+        /** ticks fed so far */
+        long long ticks() const;
+
+        /** feed the prices of one tick indexed by product ID, 0 for a product without a price */
+        void update(std::vector<double> const& prices);
+
+        /** price fed for a product ticksAgo ticks before the last one, 0 if it is no longer kept */
+        double pastPrice(int product, int ticksAgo) const;
+
+        /** prediction of one model for one product, 0 before its first price */
+        double prediction(int model, int product) const;
+
+        /** weighted average of the predictions of several models for one product, unknown model IDs are left out */
+        double combined(std::vector<std::pair<int, double>> const& weights, int product) const;
+
+        /** mean absolute error of a model relative to the price, over the predictions scored so far */
+        double meanError(int model) const;
+
+        /** one line per model with its settings and its error */
+        void report(std::ostream& out) const;
+
+        /** state for a checkpoint, products are written by name so a resumed run can number them anew */
+        void save(BinaryWriter& out) const;
+        void restore(BinaryReader& in);
+
+        /** parse a model like regression:14, ewma:0.3, holt:0.5:0.1 or kalman:0.05, throws std::invalid_argument */
+        static ForecastSpec parseSpec(std::string const& text);
+
+        /** the model in the form parseSpec reads */
+        static std::string describe(ForecastSpec const& spec);
+
+    private:
+        /** per product state of one model */
+        struct Model
+        {
+            ForecastSpec spec;
+            // smoothed level and trend, and the error variance of the Kalman filter
+            std::vector<double> level;
+            std::vector<double> trend;
+            std::vector<double> variance;
+            std::vector<double> prediction;
+            // predictions of the last horizon ticks, row t % horizon was made at tick t
+            std::vector<std::vector<double>> past;
+            double errorSum = 0;
+            long long errorCount = 0;
+        };
+
+        void updateRegression(Model& model);
+        void updateEwma(Model& model, const double* prices);
+        void updateHolt(Model& model, const double* prices);
+        void updateKalman(Model& model, const double* prices);
+
+        /** add the errors of the predictions made horizon ticks ago for these prices */
+        void score(Model& model, const double* prices);
+
+        int horizon = 7;
+        std::vector<Model> models;
+
+        std::vector<std::string> productNames;
+        std::map<std::string, int> productIds;
+
+        // the last capacity ticks of prices, the row of tick t is t % capacity, enough for the longest regression window
+        size_t capacity = 1;
+        std::vector<std::vector<double>> history;
+        long long tickCount = 0;
+        // prices seen of each product, a double so the model loops work on one type
+        std::vector<double> observed;
+
+        // sums of the regression, reused every tick
+        std::vector<double> sumY;
+        std::vector<double> upper;
+};
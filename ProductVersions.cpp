@@ -0,0 +1,60 @@
+#include "ProductVersions.h"
+#include <algorithm>
+
+ProductVersions::ProductVersions(bool _keepHistory)
+: keepHistory(_keepHistory)
+{
+
+}
+
+/** compare the orders of the next tick with those of the previous one */
+void ProductVersions::addTick(std::vector<OrderBookEntry> const& orders)
+{
+    std::map<std::string, std::vector<OrderKey>> currentOrders;
+    for (OrderBookEntry const& order : orders)
+    {
+        currentOrders[order.product].push_back(OrderKey{order.orderType, order.price.units(), order.amount.units()});
+    }
+
+    // a product missing from this tick has no orders, which is a change unless it had none before either
+    for (auto const& previous : previousOrders)
+    {
+        currentOrders[previous.first];
+    }
+
+    for (auto& current : currentOrders)
+    {
+        // compared in full rather than hashed, so an equal version can never hide a change
+        auto previous = previousOrders.find(current.first);
+        if (previous == previousOrders.end() || previous->second != current.second)
+        {
+            versions[current.first] = ++lastVersion;
+            if (keepHistory)
+            {
+                changes[current.first].push_back(std::make_pair(ticks, lastVersion));
+            }
+        }
+    }
+    previousOrders = std::move(currentOrders);
+    ticks++;
+}
+
+/** versions of every product seen so far as of the last tick added */
+std::map<std::string, unsigned long long> const& ProductVersions::current() const
+{
+    return versions;
+}
+
+/** version of a product at the tick added at this position, the one set by its last change up to then */
+unsigned long long ProductVersions::version(std::string const& product, size_t tick) const
+{
+    auto it = changes.find(product);
+    if (it == changes.end() || tick >= ticks)
+    {
+        return 0;
+    }
+    std::vector<std::pair<size_t, unsigned long long>> const& productChanges = it->second;
+    auto change = std::upper_bound(productChanges.begin(), productChanges.end(), tick,
+                                   [](size_t t, std::pair<size_t, unsigned long long> const& c) { return t < c.first; });
+    return change == productChanges.begin() ? 0 : std::prev(change)->second;
+}
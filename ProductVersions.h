@@ -0,0 +1,38 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+
+/** version numbers of the dataset orders of each product, tick after tick
+ * a product keeps its version while its orders repeat exactly those of the previous tick,
+ * so an equal version means the work done on those orders can be reused */
+class ProductVersions
+{
+    public:
+        /** with history every version change is kept, so the version of any tick added can be looked up */
+        ProductVersions(bool _keepHistory = false);
+
+        /** compare the orders of the next tick with those of the previous one, ticks must come in time order */
+        void addTick(std::vector<OrderBookEntry> const& orders);
+
+        /** versions of every product seen so far as of the last tick added */
+        std::map<std::string, unsigned long long> const& current() const;
+
+        /** version of a product at the tick added at this position, 0 if unknown or kept without history */
+        unsigned long long version(std::string const& product, size_t tick) const;
+
+    private:
+        // side, price units and amount units of an order, the only fields matching and market prices read
+        typedef std::tuple<OrderBookType, long long, long long> OrderKey;
+
+        std::map<std::string, std::vector<OrderKey>> previousOrders;
+        std::map<std::string, unsigned long long> versions;
+        unsigned long long lastVersion = 0;
+
+        // position of every tick that changed a product and the version it got, in tick order
+        bool keepHistory;
+        std::map<std::string, std::vector<std::pair<size_t, unsigned long long>>> changes;
+        size_t ticks = 0;
+};
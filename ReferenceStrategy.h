@@ -0,0 +1,58 @@
+#pragma once
+#include "Strategy.h"
+
+/** the strategy the bot was tuned with: trade the standard order amount at the current price
+ * towards the predicted price, asks for all products first and then bids, and cancel resting
+ * orders the market or the prediction has moved past */
+struct ReferenceStrategy
+{
+    // pass 0 places the asks, pass 1 the bids
+    static const int passes = 2;
+
+    void reviewOrder(MarketView const& market, RestingOrder const& order, OrderSink& orders)
+    {
+        int k = order.product;
+        if (order.side == OrderBookType::ask)
+        {
+            // if the price is lower than bidding prices or we predict the price will increase, we cancel the order
+            if ((order.price < market.maxBid[k]) || (order.price < market.prediction[k]))
+            {
+                orders.cancel(order);
+            }
+        }
+        if (order.side == OrderBookType::bid)
+        {
+            // if price is higher than asking prices or we predict the price will decrease, we cancel the order
+            if ((order.price > market.minAsk[k]) || (order.price > market.prediction[k]))
+            {
+                orders.cancel(order);
+            }
+        }
+    }
+
+    void onProduct(MarketView const& market, int k, int pass, OrderSink& orders)
+    {
+        double price = market.price[k];
+        double prediction = market.prediction[k];
+        if (pass == 0)
+        {
+            // no trading happening on this product
+            if (market.minAsk[k] == 0 && market.maxBid[k] == 0)
+                return;
+
+            // if we expect the market price to decrease, we should sell at the highest price we can get now
+            if (prediction < price && price > 0 && price > prediction)
+            {
+                orders.ask(k, price, market.orderAmount[k]);
+            }
+        }
+        else
+        {
+            // if we expect the market price to increase, we should buy at the lowest price we can get now
+            if (prediction > price && price > 0 && price < prediction)
+            {
+                orders.bid(k, price, market.orderAmount[k]);
+            }
+        }
+    }
+};
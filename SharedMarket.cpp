@@ -0,0 +1,141 @@
+#include "SharedMarket.h"
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <thread>
+#include <iomanip>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+SharedMarketPublisher::SharedMarketPublisher(std::string const& _name)
+: name(_name)
+{
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error{"cannot create shared memory " + name + ": " + std::strerror(errno)};
+    }
+    if (ftruncate(fd, sizeof(SharedMarketSegment)) < 0)
+    {
+        std::string error = std::strerror(errno);
+        close(fd);
+        throw std::runtime_error{"cannot size shared memory " + name + ": " + error};
+    }
+    void* memory = mmap(nullptr, sizeof(SharedMarketSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        throw std::runtime_error{"cannot map shared memory " + name + ": " + std::strerror(errno)};
+    }
+
+    // a reused segment keeps counting from its last sequence, so readers never see it go back
+    segment = static_cast<SharedMarketSegment*>(memory);
+    uint64_t sequence = segment->magic == SharedMarketSegment::magicValue ? segment->sequence.load() : 0;
+    sequence += sequence % 2;
+    segment->sequence.store(sequence + 1);
+    std::memset(&segment->snapshot, 0, sizeof(SharedMarketSnapshot));
+    segment->version = SharedMarketSegment::layoutVersion;
+    segment->magic = SharedMarketSegment::magicValue;
+    segment->snapshot.active = 1;
+    segment->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+/** marks the snapshot inactive and unmaps the segment */
+SharedMarketPublisher::~SharedMarketPublisher()
+{
+    beginUpdate().active = 0;
+    endUpdate();
+    munmap(segment, sizeof(SharedMarketSegment));
+}
+
+/** start writing a snapshot, fill the returned snapshot in place and call endUpdate */
+SharedMarketSnapshot& SharedMarketPublisher::beginUpdate()
+{
+    // odd sequence: readers that copy now will retry
+    segment->sequence.store(segment->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return segment->snapshot;
+}
+
+/** make the snapshot written since beginUpdate visible to readers */
+void SharedMarketPublisher::endUpdate()
+{
+    segment->sequence.store(segment->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+SharedMarketReader::SharedMarketReader(std::string const& name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        throw std::runtime_error{"cannot open shared memory " + name + ": " + std::strerror(errno)};
+    }
+    struct stat status;
+    if (fstat(fd, &status) < 0 || (size_t)status.st_size < sizeof(SharedMarketSegment))
+    {
+        close(fd);
+        throw std::runtime_error{"shared memory " + name + " is not a bot market segment"};
+    }
+    void* memory = mmap(nullptr, sizeof(SharedMarketSegment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        throw std::runtime_error{"cannot map shared memory " + name + ": " + std::strerror(errno)};
+    }
+    segment = static_cast<const SharedMarketSegment*>(memory);
+    if (segment->magic != SharedMarketSegment::magicValue || segment->version != SharedMarketSegment::layoutVersion)
+    {
+        munmap(const_cast<SharedMarketSegment*>(segment), sizeof(SharedMarketSegment));
+        throw std::runtime_error{"shared memory " + name + " has an unknown layout"};
+    }
+}
+
+SharedMarketReader::~SharedMarketReader()
+{
+    munmap(const_cast<SharedMarketSegment*>(segment), sizeof(SharedMarketSegment));
+}
+
+/** copy the latest complete snapshot, retrying while the bot is writing */
+uint64_t SharedMarketReader::read(SharedMarketSnapshot& snapshot) const
+{
+    while (true)
+    {
+        uint64_t before = segment->sequence.load(std::memory_order_acquire);
+        if (before % 2 == 0)
+        {
+            std::memcpy(&snapshot, &segment->snapshot, sizeof(SharedMarketSnapshot));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (segment->sequence.load(std::memory_order_relaxed) == before)
+            {
+                return before;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+/** print a snapshot as a small table */
+void SharedMarketReader::print(SharedMarketSnapshot const& snapshot, std::ostream& out)
+{
+    out << "Tick " << snapshot.tick << " at " << snapshot.timestamp;
+    out << (snapshot.active ? "" : " (bot finished)") << std::endl;
+    out << std::left << std::setw(12) << "Product" << std::right << std::setw(16) << "Best bid";
+    out << std::setw(16) << "Best ask" << std::setw(16) << "Mid" << std::setw(16) << "Prediction" << std::endl;
+    for (uint32_t i = 0; i < snapshot.productCount && i < SharedMarketSnapshot::maxProducts; ++i)
+    {
+        SharedQuote const& q = snapshot.quotes[i];
+        out << std::left << std::setw(12) << q.product << std::right << std::setw(16) << q.bestBid;
+        out << std::setw(16) << q.bestAsk << std::setw(16) << q.mid << std::setw(16) << q.prediction << std::endl;
+    }
+    out << std::left << std::setw(12) << "Currency" << std::right << std::setw(16) << "Available";
+    out << std::setw(16) << "Reserved" << std::setw(16) << "Total" << std::endl;
+    for (uint32_t i = 0; i < snapshot.currencyCount && i < SharedMarketSnapshot::maxCurrencies; ++i)
+    {
+        SharedBalance const& b = snapshot.balances[i];
+        out << std::left << std::setw(12) << b.currency << std::right << std::setw(16) << b.available;
+        out << std::setw(16) << b.reserved << std::setw(16) << b.total << std::endl;
+    }
+    out << "Total assets in USD equivalent: " << snapshot.totalAssetsUSD << std::endl;
+}
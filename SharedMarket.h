@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+/** market state of one product as seen by the bot at the last tick */
+struct SharedQuote
+{
+    char product[16];
+    double bestBid;
+    double bestAsk;
+    double mid;
+    double prediction;
+};
+
+/** bot balance in one currency at the last tick */
+struct SharedBalance
+{
+    char currency[8];
+    double available;
+    double reserved;
+    double total;
+};
+
+/** everything published for one tick, plain data so readers can copy it out of shared memory */
+struct SharedMarketSnapshot
+{
+    static const int maxProducts = 32;
+    static const int maxCurrencies = 32;
+
+    char timestamp[32];
+    uint64_t tick;
+    // 1 while the bot is running, 0 once it has finished
+    uint32_t active;
+    uint32_t productCount;
+    uint32_t currencyCount;
+    SharedQuote quotes[maxProducts];
+    SharedBalance balances[maxCurrencies];
+    double totalAssetsUSD;
+
+    /** copy a name into a fixed size field, truncating it if needed */
+    template <size_t N>
+    static void setName(char (&field)[N], std::string const& name)
+    {
+        size_t length = name.size() < N - 1 ? name.size() : N - 1;
+        name.copy(field, length);
+        field[length] = 0;
+    }
+};
+
+/** layout of the shared memory segment, the snapshot is guarded by a seqlock:
+ * the sequence is odd while the bot writes and readers retry if it changed while they copied */
+struct SharedMarketSegment
+{
+    static const uint32_t magicValue = 0x4D4B4254;
+    static const uint32_t layoutVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint64_t> sequence;
+    SharedMarketSnapshot snapshot;
+};
+
+/** bot side: creates the segment and publishes a snapshot per tick without ever waiting for readers
+ * the segment is kept after the bot exits so readers can still see the final state */
+class SharedMarketPublisher
+{
+    public:
+        /** create or reuse the POSIX shared memory object with this name, e.g. /merkelbot, throws std::runtime_error on failure */
+        SharedMarketPublisher(std::string const& _name);
+        /** marks the snapshot inactive and unmaps the segment */
+        ~SharedMarketPublisher();
+
+        SharedMarketPublisher(SharedMarketPublisher const&) = delete;
+        SharedMarketPublisher& operator=(SharedMarketPublisher const&) = delete;
+
+        /** start writing a snapshot, fill the returned snapshot in place and call endUpdate */
+        SharedMarketSnapshot& beginUpdate();
+
+        /** make the snapshot written since beginUpdate visible to readers */
+        void endUpdate();
+
+    private:
+        std::string name;
+        SharedMarketSegment* segment = nullptr;
+};
+
+/** reader side: maps the segment read only and takes consistent copies of the latest snapshot */
+class SharedMarketReader
+{
+    public:
+        /** open the shared memory object published by a bot, throws std::runtime_error if there is none */
+        SharedMarketReader(std::string const& name);
+        ~SharedMarketReader();
+
+        SharedMarketReader(SharedMarketReader const&) = delete;
+        SharedMarketReader& operator=(SharedMarketReader const&) = delete;
+
+        /** copy the latest complete snapshot, retrying while the bot is writing
+         * returns its sequence number, which only changes when a new snapshot is published */
+        uint64_t read(SharedMarketSnapshot& snapshot) const;
+
+        /** print a snapshot as a small table */
+        static void print(SharedMarketSnapshot const& snapshot, std::ostream& out);
+
+    private:
+        const SharedMarketSegment* segment = nullptr;
+};
@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstddef>
+
+/** lock-free bounded queue between exactly one producer thread and one consumer thread
+ * the capacity is rounded up to a power of two, a full or empty queue makes the caller yield
+ * and every such wait is counted as a stall */
+template <typename T>
+class SpscRing
+{
+    public:
+        SpscRing(size_t capacity)
+        : slots(roundUpToPowerOfTwo(capacity)),
+          mask(slots.size() - 1)
+        {
+
+        }
+
+        SpscRing(SpscRing const&) = delete;
+        SpscRing& operator=(SpscRing const&) = delete;
+
+        /** producer: add a value, false if the queue is full (value is left untouched) */
+        bool tryPush(T& value)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == slots.size())
+            {
+                return false;
+            }
+            slots[t & mask] = std::move(value);
+            tail.store(t + 1, std::memory_order_release);
+
+            size_t depth = t + 1 - head.load(std::memory_order_relaxed);
+            if ((long long)depth > maxDepth.load(std::memory_order_relaxed))
+            {
+                maxDepth.store(depth, std::memory_order_relaxed);
+            }
+            return true;
+        }
+
+        /** producer: add a value, waiting while the queue is full */
+        void push(T value)
+        {
+            if (tryPush(value))
+            {
+                return;
+            }
+            pushStalls.fetch_add(1, std::memory_order_relaxed);
+            while (!tryPush(value))
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        /** producer: no more values will be pushed */
+        void close()
+        {
+            closed.store(true, std::memory_order_release);
+        }
+
+        /** consumer: take the oldest value, false if the queue is empty */
+        bool tryPop(T& value)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            value = std::move(slots[h & mask]);
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** consumer: take the oldest value, waiting while the queue is empty
+         * returns false once the producer has closed the queue and it is drained */
+        bool pop(T& value)
+        {
+            if (tryPop(value))
+            {
+                return true;
+            }
+            popStalls.fetch_add(1, std::memory_order_relaxed);
+            while (true)
+            {
+                // a value pushed before close is visible once close is seen
+                if (isClosed())
+                {
+                    return tryPop(value);
+                }
+                if (tryPop(value))
+                {
+                    return true;
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        bool isClosed() const
+        {
+            return closed.load(std::memory_order_acquire);
+        }
+
+        size_t capacity() const
+        {
+            return slots.size();
+        }
+
+        /** values currently queued, approximate while both sides are running */
+        size_t depth() const
+        {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+
+        // queue statistics: highest depth seen, waits on a full queue and waits on an empty queue
+        std::atomic<long long> maxDepth{0};
+        std::atomic<long long> pushStalls{0};
+        std::atomic<long long> popStalls{0};
+
+    private:
+        static size_t roundUpToPowerOfTwo(size_t n)
+        {
+            size_t size = 1;
+            while (size < n)
+            {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        std::vector<T> slots;
+        size_t mask;
+
+        // producer and consumer positions on separate cache lines to avoid false sharing
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        std::atomic<bool> closed{false};
+};
@@ -0,0 +1,285 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include "PredictionEngine.h"
+#include "CandleEngine.h"
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+/** a resting order of the bot a strategy can keep or cancel */
+struct RestingOrder
+{
+    // position among the orders of the tick, as passed back to OrderSink::cancel
+    size_t index;
+    // position of the product in the market view
+    int product;
+    OrderBookType side;
+    double price;
+    double amount;
+};
+
+/** read-only market state of one tick, one array per quantity indexed by product position
+ * prices are 0 for a product that has not traded yet, depth is the dataset amount on each side */
+struct MarketView
+{
+    std::vector<std::string> products;
+    std::vector<std::string> baseCurrencies;
+    std::vector<std::string> quoteCurrencies;
+    std::vector<double> price;
+    std::vector<double> maxBid;
+    std::vector<double> minAsk;
+    std::vector<double> bidDepth;
+    std::vector<double> askDepth;
+    std::vector<double> prediction;
+    // standard order amount in the base currency and the free balances of both currencies
+    std::vector<double> orderAmount;
+    std::vector<double> baseAvailable;
+    std::vector<double> quoteAvailable;
+    std::vector<RestingOrder> resting;
+
+    // price history of the forecasting models, product IDs in the same order as products
+    const PredictionEngine* history = nullptr;
+    std::vector<int> historyIds;
+
+    // candles of every product, null unless the bot builds them
+    const CandleEngine* candles = nullptr;
+
+    size_t productCount() const
+    {
+        return products.size();
+    }
+
+    /** price of a product ticksAgo ticks before the current one, 0 if it is no longer kept */
+    double pastPrice(int product, int ticksAgo) const
+    {
+        return history ? history->pastPrice(historyIds[product], ticksAgo) : 0;
+    }
+
+    /** bars of a product at a resolution in seconds, null without candles at that resolution */
+    const CandleSeries* candleSeries(int product, int resolutionSeconds) const
+    {
+        return candles ? candles->findSeries(products[product], resolutionSeconds) : nullptr;
+    }
+};
+
+/** a fill of one of the bot's orders while the continuous book runs */
+struct Fill
+{
+    int product;
+    // side of the bot's order that traded
+    OrderBookType side;
+    double price;
+    double amount;
+    // amount of the order still resting after the fill, 0 once it is filled completely
+    double remaining;
+};
+
+/** kinds of decisions a strategy can make */
+enum class OrderIntentType {bid, ask, cancel};
+
+/** one decision of a strategy, executed by the bot in the order it was made */
+struct OrderIntent
+{
+    OrderIntentType type;
+    int product;
+    double price;
+    double amount;
+    size_t order;
+};
+
+/** collects the decisions of a strategy for one tick, the bot checks funds and places them afterwards */
+class OrderSink
+{
+    public:
+        /** buy amount of the base currency of a product at price */
+        void bid(int product, double price, double amount)
+        {
+            intents.push_back(OrderIntent{OrderIntentType::bid, product, price, amount, 0});
+        }
+
+        /** sell amount of the base currency of a product at price */
+        void ask(int product, double price, double amount)
+        {
+            intents.push_back(OrderIntent{OrderIntentType::ask, product, price, amount, 0});
+        }
+
+        /** cancel a resting order */
+        void cancel(RestingOrder const& order)
+        {
+            intents.push_back(OrderIntent{OrderIntentType::cancel, order.product, order.price, order.amount, order.index});
+        }
+
+        void clear()
+        {
+            intents.clear();
+        }
+
+        std::vector<OrderIntent> const& decisions() const
+        {
+            return intents;
+        }
+
+    private:
+        std::vector<OrderIntent> intents;
+};
+
+/** what a strategy provides, checked at compile time:
+ *   static const int passes                                   number of passes over the products per tick
+ *   void reviewOrder(MarketView const&, RestingOrder const&, OrderSink&)   called for every resting order first
+ *   void onProduct(MarketView const&, int product, int pass, OrderSink&)  called for every product in every pass
+ * decisions are executed in the order they are made, so a strategy that wants all its asks placed
+ * before its bids makes them in separate passes
+ *
+ * optionally, for continuous matching:
+ *   void onFill(MarketView const&, Fill const&, OrderSink&)   called after every fill of a bot order
+ * the view holds the balances after the fill and every bot order resting in the book at its remaining amount;
+ * cancels take effect before the next event, new orders join the end of the events of the tick */
+template <typename S, typename = void>
+struct isStrategy : std::false_type {};
+
+template <typename S>
+struct isStrategy<S, std::void_t<decltype(int{S::passes}),
+                                 decltype(std::declval<S&>().reviewOrder(std::declval<MarketView const&>(),
+                                                                         std::declval<RestingOrder const&>(),
+                                                                         std::declval<OrderSink&>())),
+                                 decltype(std::declval<S&>().onProduct(std::declval<MarketView const&>(),
+                                                                       0, 0,
+                                                                       std::declval<OrderSink&>()))>>
+: std::true_type {};
+
+template <typename S, typename = void>
+struct reactsToFills : std::false_type {};
+
+template <typename S>
+struct reactsToFills<S, std::void_t<decltype(std::declval<S&>().onFill(std::declval<MarketView const&>(),
+                                                                      std::declval<Fill const&>(),
+                                                                      std::declval<OrderSink&>()))>>
+: std::true_type {};
+
+/** runs one strategy type over the market view of each tick
+ * the engine is instantiated per strategy, so the decision calls of the tick are direct and can be inlined */
+template <typename Strategy>
+class StrategyEngine
+{
+    static_assert(isStrategy<Strategy>::value, "a strategy needs passes, reviewOrder and onProduct, see Strategy.h");
+
+    public:
+        StrategyEngine(Strategy _strategy = Strategy{})
+        : strategy(std::move(_strategy))
+        {
+
+        }
+
+        /** make the decisions of one tick */
+        OrderSink const& decide(MarketView const& market)
+        {
+            sink.clear();
+            for (RestingOrder const& order : market.resting)
+            {
+                strategy.reviewOrder(market, order, sink);
+            }
+            for (int pass = 0; pass < Strategy::passes; ++pass)
+            {
+                for (size_t k = 0; k < market.productCount(); ++k)
+                {
+                    strategy.onProduct(market, k, pass, sink);
+                }
+            }
+            return sink;
+        }
+
+        /** whether the strategy reacts to fills, the bot skips building a view for them otherwise */
+        static constexpr bool fillReactions = reactsToFills<Strategy>::value;
+
+        /** make the decisions after a fill, none for a strategy without onFill */
+        OrderSink const& decide(MarketView const& market, Fill const& fill)
+        {
+            sink.clear();
+            if constexpr (fillReactions)
+            {
+                strategy.onFill(market, fill, sink);
+            }
+            return sink;
+        }
+
+        Strategy& getStrategy()
+        {
+            return strategy;
+        }
+
+    private:
+        Strategy strategy;
+        OrderSink sink;
+};
+
+/** the same interface behind virtual calls, for strategies picked at run time
+ * the tick path of the bot uses StrategyEngine, this is the comparison for the strategy benchmark */
+class DynamicStrategy
+{
+    public:
+        virtual ~DynamicStrategy() = default;
+        virtual int passes() const = 0;
+        virtual void reviewOrder(MarketView const& market, RestingOrder const& order, OrderSink& orders) = 0;
+        virtual void onProduct(MarketView const& market, int product, int pass, OrderSink& orders) = 0;
+        virtual void onFill(MarketView const&, Fill const&, OrderSink&) {}
+
+        /** make the decisions of one tick, one virtual call per decision */
+        OrderSink const& decide(MarketView const& market)
+        {
+            sink.clear();
+            for (RestingOrder const& order : market.resting)
+            {
+                reviewOrder(market, order, sink);
+            }
+            for (int pass = 0; pass < passes(); ++pass)
+            {
+                for (size_t k = 0; k < market.productCount(); ++k)
+                {
+                    onProduct(market, k, pass, sink);
+                }
+            }
+            return sink;
+        }
+
+    private:
+        OrderSink sink;
+};
+
+/** wraps a compile-time strategy as a DynamicStrategy */
+template <typename Strategy>
+class DynamicStrategyAdapter : public DynamicStrategy
+{
+    public:
+        DynamicStrategyAdapter(Strategy _strategy = Strategy{})
+        : strategy(std::move(_strategy))
+        {
+
+        }
+
+        int passes() const override
+        {
+            return Strategy::passes;
+        }
+
+        void reviewOrder(MarketView const& market, RestingOrder const& order, OrderSink& orders) override
+        {
+            strategy.reviewOrder(market, order, orders);
+        }
+
+        void onProduct(MarketView const& market, int product, int pass, OrderSink& orders) override
+        {
+            strategy.onProduct(market, product, pass, orders);
+        }
+
+        void onFill(MarketView const& market, Fill const& fill, OrderSink& orders) override
+        {
+            if constexpr (reactsToFills<Strategy>::value)
+            {
+                strategy.onFill(market, fill, orders);
+            }
+        }
+
+    private:
+        Strategy strategy;
+};
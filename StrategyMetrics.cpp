@@ -0,0 +1,296 @@
+#include "StrategyMetrics.h"
+#include <cmath>
+#include <algorithm>
+
+StrategyMetrics::StrategyMetrics(int _window, int _seriesInterval)
+: window(_window > 1 ? _window : 2),
+  seriesInterval(_seriesInterval)
+{
+    windowReturns.reserve(window);
+}
+
+/** total USD value when trading starts, the base of P&L and returns */
+void StrategyMetrics::start(double equityUSD)
+{
+    initialEquity = equityUSD;
+    equity = equityUSD;
+    peakEquity = equityUSD;
+}
+
+/** the bot placed an order of this USD value */
+void StrategyMetrics::onOrderPlaced(double notionalUSD)
+{
+    orders++;
+    placedUSD += notionalUSD;
+}
+
+/** the bot took part in a sale of this USD value */
+void StrategyMetrics::onFill(double notionalUSD)
+{
+    fills++;
+    filledUSD += notionalUSD;
+}
+
+/** mark to market after the sales of a tick */
+void StrategyMetrics::onMark(std::string const& timestamp, std::map<std::string, double> const& holdingsUSD)
+{
+    double previousEquity = equity;
+    equity = 0;
+    for (auto const& holding : holdingsUSD)
+    {
+        equity += holding.second;
+    }
+    double tickReturn = previousEquity != 0 ? equity / previousEquity - 1 : 0;
+    double loss = std::min(tickReturn, 0.0);
+    marks++;
+
+    // drawdown from the highest value so far
+    peakEquity = std::max(peakEquity, equity);
+    drawdown = peakEquity > 0 ? (peakEquity - equity) / peakEquity : 0;
+    worstDrawdown = std::max(worstDrawdown, drawdown);
+
+    double delta = tickReturn - returnMean;
+    returnMean += delta / marks;
+    returnM2 += delta * (tickReturn - returnMean);
+    downsideSquares += loss * loss;
+
+    // the oldest return leaves the window once it is full
+    if ((int)windowReturns.size() < window)
+    {
+        windowReturns.push_back(tickReturn);
+    }
+    else
+    {
+        double oldest = windowReturns[windowNext];
+        double oldestLoss = std::min(oldest, 0.0);
+        windowSum -= oldest;
+        windowSquares -= oldest * oldest;
+        windowDownside -= oldestLoss * oldestLoss;
+        windowReturns[windowNext] = tickReturn;
+        windowNext = (windowNext + 1) % window;
+    }
+    windowSum += tickReturn;
+    windowSquares += tickReturn * tickReturn;
+    windowDownside += loss * loss;
+
+    if (equity != 0)
+    {
+        for (auto const& holding : holdingsUSD)
+        {
+            double share = holding.second / equity;
+            exposure[holding.first] = share;
+            exposureSum[holding.first] += share;
+            double& largest = exposureMax[holding.first];
+            largest = std::max(largest, share);
+        }
+    }
+
+    if (seriesInterval > 0 && marks % seriesInterval == 0)
+    {
+        MetricsRow row;
+        row.timestamp = timestamp;
+        row.equityUSD = equity;
+        row.pnlUSD = pnlUSD();
+        row.tickReturn = tickReturn;
+        row.drawdown = drawdown;
+        row.rollingSharpe = rollingSharpe();
+        row.rollingSortino = rollingSortino();
+        row.turnoverUSD = filledUSD;
+        row.fills = fills;
+        series.push_back(row);
+    }
+}
+
+double StrategyMetrics::pnlUSD() const
+{
+    return equity - initialEquity;
+}
+
+double StrategyMetrics::maxDrawdown() const
+{
+    return worstDrawdown;
+}
+
+double StrategyMetrics::sharpe() const
+{
+    return marks > 0 ? ratio(returnMean, returnM2 / marks) : 0;
+}
+
+double StrategyMetrics::sortino() const
+{
+    return marks > 0 ? ratio(returnMean, downsideSquares / marks) : 0;
+}
+
+double StrategyMetrics::rollingSharpe() const
+{
+    if (windowReturns.empty())
+    {
+        return 0;
+    }
+    double mean = windowSum / windowReturns.size();
+    return ratio(mean, windowSquares / windowReturns.size() - mean * mean);
+}
+
+double StrategyMetrics::rollingSortino() const
+{
+    if (windowReturns.empty())
+    {
+        return 0;
+    }
+    return ratio(windowSum / windowReturns.size(), windowDownside / windowReturns.size());
+}
+
+/** share of the value of the placed orders that was filled */
+double StrategyMetrics::fillRatio() const
+{
+    return placedUSD > 0 ? filledUSD / placedUSD : 0;
+}
+
+/** mean over standard deviation, 0 without spread */
+double StrategyMetrics::ratio(double mean, double variance)
+{
+    // the running sums can leave a tiny negative variance behind when all returns are equal
+    if (variance <= 1e-24)
+    {
+        return 0;
+    }
+    return mean / std::sqrt(variance);
+}
+
+/** compact summary of the run */
+void StrategyMetrics::writeSummary(std::ostream& out) const
+{
+    out << "Strategy metrics over " << marks << " ticks" << std::endl;
+    out << "Total assets USD: initial " << initialEquity << ", final " << equity
+        << ", P&L " << pnlUSD() << " (" << (initialEquity != 0 ? pnlUSD() / initialEquity * 100 : 0) << "%)" << std::endl;
+    out << "Max drawdown: " << worstDrawdown * 100 << "%" << std::endl;
+    out << "Sharpe per tick: " << sharpe() << " over the run, " << rollingSharpe() << " over the last " << windowReturns.size() << " ticks" << std::endl;
+    out << "Sortino per tick: " << sortino() << " over the run, " << rollingSortino() << " over the last " << windowReturns.size() << " ticks" << std::endl;
+    out << "Orders: " << orders << " placed, " << fills << " fills, " << fillRatio() * 100 << "% of the placed value filled" << std::endl;
+    out << "Turnover USD: " << filledUSD << " (" << (initialEquity != 0 ? filledUSD / initialEquity : 0) << " times the initial assets)" << std::endl;
+    for (auto const& share : exposure)
+    {
+        out << "Exposure " << share.first << ": " << share.second * 100 << "% now, "
+            << exposureSum.at(share.first) / marks * 100 << "% average, " << exposureMax.at(share.first) * 100 << "% max" << std::endl;
+    }
+}
+
+/** the series rows as CSV */
+void StrategyMetrics::writeSeries(std::ostream& out) const
+{
+    out << "timestamp,equityUSD,pnlUSD,return,drawdown,rollingSharpe,rollingSortino,turnoverUSD,fills" << std::endl;
+    for (MetricsRow const& row : series)
+    {
+        out << row.timestamp << ","
+            << std::to_string(row.equityUSD) << ","
+            << std::to_string(row.pnlUSD) << ","
+            << row.tickReturn << ","
+            << row.drawdown << ","
+            << row.rollingSharpe << ","
+            << row.rollingSortino << ","
+            << std::to_string(row.turnoverUSD) << ","
+            << row.fills << std::endl;
+    }
+}
+
+/** state for a checkpoint */
+void StrategyMetrics::save(BinaryWriter& out) const
+{
+    out.writeDouble(initialEquity);
+    out.writeDouble(equity);
+    out.writeDouble(peakEquity);
+    out.writeDouble(drawdown);
+    out.writeDouble(worstDrawdown);
+    out.writeInt(marks);
+    out.writeDouble(returnMean);
+    out.writeDouble(returnM2);
+    out.writeDouble(downsideSquares);
+
+    // the window is written oldest first, so it can be restored with another window length
+    out.writeInt(windowReturns.size());
+    for (size_t i = 0; i < windowReturns.size(); ++i)
+    {
+        out.writeDouble(windowReturns[(windowNext + i) % windowReturns.size()]);
+    }
+
+    out.writeInt(orders);
+    out.writeInt(fills);
+    out.writeDouble(placedUSD);
+    out.writeDouble(filledUSD);
+    out.writeMap(exposure);
+    out.writeMap(exposureSum);
+    out.writeMap(exposureMax);
+
+    out.writeInt(series.size());
+    for (MetricsRow const& row : series)
+    {
+        out.writeString(row.timestamp);
+        out.writeDouble(row.equityUSD);
+        out.writeDouble(row.pnlUSD);
+        out.writeDouble(row.tickReturn);
+        out.writeDouble(row.drawdown);
+        out.writeDouble(row.rollingSharpe);
+        out.writeDouble(row.rollingSortino);
+        out.writeDouble(row.turnoverUSD);
+        out.writeInt(row.fills);
+    }
+}
+
+void StrategyMetrics::restore(BinaryReader& in)
+{
+    initialEquity = in.readDouble();
+    equity = in.readDouble();
+    peakEquity = in.readDouble();
+    drawdown = in.readDouble();
+    worstDrawdown = in.readDouble();
+    marks = in.readInt();
+    returnMean = in.readDouble();
+    returnM2 = in.readDouble();
+    downsideSquares = in.readDouble();
+
+    windowReturns.clear();
+    windowNext = 0;
+    windowSum = 0;
+    windowSquares = 0;
+    windowDownside = 0;
+    long long windowSize = in.readInt();
+    for (long long i = 0; i < windowSize; ++i)
+    {
+        double tickReturn = in.readDouble();
+        double loss = std::min(tickReturn, 0.0);
+        // only the most recent returns fit when this run has a shorter window
+        if (windowSize - i > window)
+        {
+            continue;
+        }
+        windowReturns.push_back(tickReturn);
+        windowSum += tickReturn;
+        windowSquares += tickReturn * tickReturn;
+        windowDownside += loss * loss;
+    }
+
+    orders = in.readInt();
+    fills = in.readInt();
+    placedUSD = in.readDouble();
+    filledUSD = in.readDouble();
+    exposure = in.readMap();
+    exposureSum = in.readMap();
+    exposureMax = in.readMap();
+
+    series.clear();
+    long long rows = in.readInt();
+    for (long long i = 0; i < rows; ++i)
+    {
+        MetricsRow row;
+        row.timestamp = in.readString();
+        row.equityUSD = in.readDouble();
+        row.pnlUSD = in.readDouble();
+        row.tickReturn = in.readDouble();
+        row.drawdown = in.readDouble();
+        row.rollingSharpe = in.readDouble();
+        row.rollingSortino = in.readDouble();
+        row.turnoverUSD = in.readDouble();
+        row.fills = in.readInt();
+        series.push_back(row);
+    }
+}
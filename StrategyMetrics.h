@@ -0,0 +1,102 @@
+#pragma once
+#include "Checkpoint.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+
+/** strategy metrics at one point of the run, for the optional series */
+struct MetricsRow
+{
+    std::string timestamp;
+    double equityUSD = 0;
+    double pnlUSD = 0;
+    double tickReturn = 0;
+    double drawdown = 0;
+    double rollingSharpe = 0;
+    double rollingSortino = 0;
+    double turnoverUSD = 0;
+    long long fills = 0;
+};
+
+/** performance of the bot updated as the run goes, in O(1) per fill and per tick
+ * fed with the orders and fills of the bot and with the USD value of its holdings after each tick,
+ * so results no longer have to be parsed back out of the assets log
+ * ratios are per tick and not annualized, returns are tick over tick changes of the total USD value */
+class StrategyMetrics
+{
+    public:
+        /** window is the number of ticks of the rolling Sharpe and Sortino ratios,
+         * a series row is kept every seriesInterval ticks, 0 keeps none */
+        StrategyMetrics(int _window = 60, int _seriesInterval = 0);
+
+        /** total USD value when trading starts, the base of P&L and returns */
+        void start(double equityUSD);
+
+        /** the bot placed an order of this USD value */
+        void onOrderPlaced(double notionalUSD);
+
+        /** the bot took part in a sale of this USD value */
+        void onFill(double notionalUSD);
+
+        /** mark to market after the sales of a tick, with the USD value held in each currency */
+        void onMark(std::string const& timestamp, std::map<std::string, double> const& holdingsUSD);
+
+        double pnlUSD() const;
+        double maxDrawdown() const;
+        double sharpe() const;
+        double sortino() const;
+        double rollingSharpe() const;
+        double rollingSortino() const;
+
+        /** share of the value of the placed orders that was filled */
+        double fillRatio() const;
+
+        /** compact summary of the run */
+        void writeSummary(std::ostream& out) const;
+
+        /** the series rows as CSV */
+        void writeSeries(std::ostream& out) const;
+
+        /** state for a checkpoint, restored with restore */
+        void save(BinaryWriter& out) const;
+        void restore(BinaryReader& in);
+
+    private:
+        int window;
+        int seriesInterval;
+
+        double initialEquity = 0;
+        double equity = 0;
+        double peakEquity = 0;
+        double drawdown = 0;
+        double worstDrawdown = 0;
+        long long marks = 0;
+
+        // whole run: running mean and sum of squared deviations of the returns (Welford), and squared losses
+        double returnMean = 0;
+        double returnM2 = 0;
+        double downsideSquares = 0;
+
+        // rolling window: ring of the last returns with their running sums, updated as returns enter and leave
+        std::vector<double> windowReturns;
+        size_t windowNext = 0;
+        double windowSum = 0;
+        double windowSquares = 0;
+        double windowDownside = 0;
+
+        long long orders = 0;
+        long long fills = 0;
+        double placedUSD = 0;
+        double filledUSD = 0;
+
+        // inventory exposure by currency as a share of the total value: latest, sum over ticks and largest
+        std::map<std::string, double> exposure;
+        std::map<std::string, double> exposureSum;
+        std::map<std::string, double> exposureMax;
+
+        std::vector<MetricsRow> series;
+
+        /** mean over standard deviation, 0 without spread */
+        static double ratio(double mean, double variance);
+};
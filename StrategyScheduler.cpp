@@ -0,0 +1,700 @@
+#include "StrategyScheduler.h"
+
+#ifdef MERKELBOT_COROUTINES
+
+#include "CSVReader.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#ifdef __linux__
+#include <time.h>
+#endif
+
+/** CPU time of the calling thread, the wall clock where there is no per thread clock */
+static long long threadCpuNanos()
+{
+#ifdef __linux__
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000000000LL + now.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+StrategyTask::StrategyTask(std::coroutine_handle<promise_type> _handle)
+: handle(_handle)
+{
+
+}
+
+StrategyTask::StrategyTask(StrategyTask&& other) noexcept
+: handle(other.handle)
+{
+    other.handle = nullptr;
+}
+
+StrategyTask& StrategyTask::operator=(StrategyTask&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+        handle = other.handle;
+        other.handle = nullptr;
+    }
+    return *this;
+}
+
+/** a strategy still waiting for an event at the end of the run is destroyed suspended */
+StrategyTask::~StrategyTask()
+{
+    if (handle)
+    {
+        handle.destroy();
+    }
+}
+
+/** run the strategy up to its next co_await, rethrows what escaped the strategy */
+void StrategyTask::resume()
+{
+    if (!handle || handle.done())
+    {
+        return;
+    }
+    handle.resume();
+    if (handle.promise().error)
+    {
+        std::exception_ptr error = handle.promise().error;
+        handle.promise().error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+bool StrategyTask::done() const
+{
+    return !handle || handle.done();
+}
+
+StrategyContext::StrategyContext(std::string _name, MarketView const& _market)
+: name(std::move(_name)), view(_market)
+{
+
+}
+
+StrategyContext::EventAwaiter StrategyContext::next()
+{
+    return EventAwaiter{*this};
+}
+
+MarketView const& StrategyContext::market() const
+{
+    return view;
+}
+
+bool StrategyContext::bid(int product, double price, double amount)
+{
+    return submit(product, OrderBookType::bid, price, amount);
+}
+
+bool StrategyContext::ask(int product, double price, double amount)
+{
+    return submit(product, OrderBookType::ask, price, amount);
+}
+
+/** reserve the funds of an order and queue it for the next matching */
+bool StrategyContext::submit(int product, OrderBookType side, double price, double amount)
+{
+    if (product < 0 || product >= (int)view.productCount() || !(price > 0) || !(amount > 0))
+    {
+        stats.rejected++;
+        return false;
+    }
+    // the order is rounded for the market first so exactly what it can spend is reserved
+    OrderBookEntry order{price, amount, current.timestamp, view.products[product], side, 0, name, "initial",
+                         name + "-" + std::to_string(orderCount)};
+    bool isBid = side == OrderBookType::bid;
+    std::string const& currency = isBid ? view.quoteCurrencies[product] : view.baseCurrencies[product];
+    double cost = isBid ? (double)order.price * (double)order.amount : (double)order.amount;
+    if (order.amount == Decimal{} || !assets.standardWallet.containsCurrency(currency, cost))
+    {
+        stats.rejected++;
+        return false;
+    }
+    assets.blockAmount(currency, cost);
+    orders.push_back(std::move(order));
+    orderCount++;
+    stats.orders++;
+    return true;
+}
+
+double StrategyContext::available(std::string const& currency) const
+{
+    auto it = assets.standardWallet.currencies.find(currency);
+    return it == assets.standardWallet.currencies.end() ? 0 : it->second;
+}
+
+void StrategyContext::wakeAt(long long micros)
+{
+    timers.push_back(micros);
+}
+
+void StrategyContext::wakeAfter(long long micros)
+{
+    timers.push_back(current.micros + micros);
+}
+
+std::string const& StrategyContext::getName() const
+{
+    return name;
+}
+
+Assets const& StrategyContext::getAssets() const
+{
+    return assets;
+}
+
+StrategyStats const& StrategyContext::getStats() const
+{
+    return stats;
+}
+
+/** release what is still reserved for the unfilled part of an order */
+static void releaseOrder(Assets& assets, OrderBookEntry const& order)
+{
+    std::vector<std::string> currs = CSVReader::tokenise(order.product, '/');
+    bool isBid = order.orderType == OrderBookType::bid;
+    std::string const& currency = isBid ? currs[1] : currs[0];
+    double amount = isBid ? (double)order.price * (double)order.amount : (double)order.amount;
+    // the reservation was computed in the same rounding, never release more than is left of it
+    amount = std::min(amount, assets.reservedWallet.currencies[currency]);
+    if (amount > 0)
+    {
+        assets.unblockAmount(currency, amount);
+    }
+}
+
+StrategyScheduler::StrategyScheduler(std::shared_ptr<const OrderBook> _dataset, int threads)
+: dataset(std::move(_dataset))
+{
+    if (threads > 1)
+    {
+        pool.reset(new WorkStealingPool{threads});
+    }
+    predictions.configure(7, {PredictionEngine::parseSpec("regression:14")});
+    for (std::string const& p : dataset->products)
+    {
+        std::vector<std::string> currs = CSVReader::tokenise(p, '/');
+        if (currs.size() != 2)
+        {
+            continue;
+        }
+        productIndex[p] = view.products.size();
+        view.products.push_back(p);
+        view.baseCurrencies.push_back(currs[0]);
+        view.quoteCurrencies.push_back(currs[1]);
+        view.historyIds.push_back(predictions.addProduct(p));
+        valuationIds.push_back(valuation.addProduct(p));
+    }
+    size_t count = view.products.size();
+    view.price.assign(count, 0);
+    view.maxBid.assign(count, 0);
+    view.minAsk.assign(count, 0);
+    view.bidDepth.assign(count, 0);
+    view.askDepth.assign(count, 0);
+    view.prediction.assign(count, 0);
+    view.history = &predictions;
+    tickPrices.assign(predictions.productCount(), 0);
+}
+
+/** add a strategy with its initial funds, names must be unique */
+void StrategyScheduler::addStrategy(std::string const& name, StrategyFactory factory, std::map<std::string, double> const& funds)
+{
+    // sales are told apart by username, so the name must not be taken by the dataset or another strategy
+    if (name.empty() || name == "dataset" || entryByName.count(name) > 0)
+    {
+        throw std::invalid_argument{"StrategyScheduler::addStrategy name " + name + " is empty or taken"};
+    }
+    std::unique_ptr<StrategyContext> context{new StrategyContext{name, view}};
+    context->assets.addFunds(funds);
+    StrategyTask task = factory(*context);
+    Entry entry{std::move(context), std::move(task), funds, false, false, std::string{}};
+    entryByName[name] = entries.size();
+    entries.push_back(std::move(entry));
+}
+
+size_t StrategyScheduler::strategyCount() const
+{
+    return entries.size();
+}
+
+/** replay the whole dataset */
+void StrategyScheduler::run()
+{
+    auto start = std::chrono::steady_clock::now();
+    static const std::vector<OrderBookEntry> noOrders;
+    for (std::string const& timestamp : dataset->timestamps)
+    {
+        auto tick = dataset->ordersByTimestamp.find(timestamp);
+        std::vector<OrderBookEntry> const& tickOrders = tick == dataset->ordersByTimestamp.end() ? noOrders : tick->second;
+        currentTime = timestamp;
+        currentMicros = OrderBookEntry::timestampToMicros(timestamp);
+        updateMarket(tickOrders);
+
+        // the due timers first, in the order they were set, then the tick itself
+        for (Entry& entry : entries)
+        {
+            StrategyContext& context = *entry.context;
+            for (auto it = context.timers.begin(); it != context.timers.end();)
+            {
+                if (*it <= currentMicros)
+                {
+                    context.pending.push_back(MarketEvent{MarketEventType::timer, timestamp, *it, {}});
+                    it = context.timers.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            context.pending.push_back(MarketEvent{MarketEventType::tick, timestamp, currentMicros, {}});
+        }
+        deliver();
+
+        // orders placed while handling the fills wait for the next tick
+        matchOrders(timestamp, tickOrders);
+        deliver();
+        ticks++;
+    }
+
+    // orders placed at the last tick are never matched
+    for (Entry& entry : entries)
+    {
+        for (OrderBookEntry const& order : entry.context->orders)
+        {
+            releaseOrder(entry.context->assets, order);
+        }
+        entry.context->orders.clear();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    wallNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+}
+
+/** set the market view from the dataset orders of a tick, products without orders keep their last prices */
+void StrategyScheduler::updateMarket(std::vector<OrderBookEntry> const& tickOrders)
+{
+    size_t count = view.products.size();
+    std::vector<double> maxBid(count, 0);
+    std::vector<double> minAsk(count, 0);
+    view.bidDepth.assign(count, 0);
+    view.askDepth.assign(count, 0);
+    for (OrderBookEntry const& order : tickOrders)
+    {
+        auto it = productIndex.find(order.product);
+        if (it == productIndex.end())
+        {
+            continue;
+        }
+        int k = it->second;
+        double price = order.price;
+        if (order.orderType == OrderBookType::bid)
+        {
+            maxBid[k] = std::max(maxBid[k], price);
+            view.bidDepth[k] += (double)order.amount;
+        }
+        else if (order.orderType == OrderBookType::ask)
+        {
+            minAsk[k] = minAsk[k] == 0 ? price : std::min(minAsk[k], price);
+            view.askDepth[k] += (double)order.amount;
+        }
+    }
+
+    std::fill(tickPrices.begin(), tickPrices.end(), 0);
+    for (size_t k = 0; k < count; ++k)
+    {
+        if (maxBid[k] > 0)
+            view.maxBid[k] = maxBid[k];
+        if (minAsk[k] > 0)
+            view.minAsk[k] = minAsk[k];
+        // the middle of the spread, or the one side there is
+        if (maxBid[k] > 0 || minAsk[k] > 0)
+        {
+            view.price[k] = view.maxBid[k] > 0 && view.minAsk[k] > 0 ? (view.maxBid[k] + view.minAsk[k]) / 2
+                                                                     : std::max(view.maxBid[k], view.minAsk[k]);
+            tickPrices[view.historyIds[k]] = view.price[k];
+            valuation.setPrice(valuationIds[k], view.price[k]);
+        }
+    }
+    predictions.update(tickPrices);
+    for (size_t k = 0; k < count; ++k)
+    {
+        view.prediction[k] = predictions.prediction(0, view.historyIds[k]);
+    }
+}
+
+/** resume every strategy with pending events until it has handled all of them
+ * each strategy is resumed by one thread at a time and only touches its own context */
+void StrategyScheduler::deliver()
+{
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (!entries[i].context->pending.empty())
+        {
+            ready.push_back(i);
+        }
+    }
+    if (!pool || ready.size() < 2)
+    {
+        for (size_t i : ready)
+        {
+            resumeStrategy(entries[i]);
+        }
+        return;
+    }
+
+    // the workers take the next strategy in line until none is left
+    std::atomic<size_t> next{0};
+    for (int t = 0; t < pool->size(); ++t)
+    {
+        pool->submit([this, &ready, &next]()
+        {
+            for (size_t j = next++; j < ready.size(); j = next++)
+            {
+                resumeStrategy(entries[ready[j]]);
+            }
+        });
+    }
+    pool->wait();
+}
+
+/** resume one strategy for each of its pending events, timing every resume */
+void StrategyScheduler::resumeStrategy(Entry& entry)
+{
+    StrategyContext& context = *entry.context;
+    try
+    {
+        // the first resume runs the strategy up to its first co_await
+        if (!entry.started)
+        {
+            entry.started = true;
+            context.current = MarketEvent{MarketEventType::tick, currentTime, currentMicros, {}};
+            timedResume(entry);
+        }
+        while (!context.pending.empty() && !entry.task.done())
+        {
+            context.current = std::move(context.pending.front());
+            context.pending.pop_front();
+            timedResume(entry);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        entry.failed = true;
+        entry.error = e.what();
+    }
+    catch (...)
+    {
+        entry.failed = true;
+        entry.error = "unknown exception";
+    }
+    if (entry.task.done())
+    {
+        context.pending.clear();
+        context.timers.clear();
+    }
+}
+
+/** one resume of a strategy, counted in the CPU time of the thread it ran on */
+void StrategyScheduler::timedResume(Entry& entry)
+{
+    StrategyStats& stats = entry.context->stats;
+    std::exception_ptr error;
+    long long start = threadCpuNanos();
+    try
+    {
+        entry.task.resume();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    long long elapsed = threadCpuNanos() - start;
+    stats.resumes++;
+    stats.cpuNanos += elapsed;
+    stats.maxResumeNanos = std::max(stats.maxResumeNanos, elapsed);
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+/** match the orders of the strategies against the dataset orders of the tick and settle the fills
+ * orders last one tick like the dataset orders, what is not filled is released again */
+void StrategyScheduler::matchOrders(std::string const& timestamp, std::vector<OrderBookEntry> const& tickOrders)
+{
+    // the strategy orders in registration order, then only the products they trade get matched
+    std::map<std::string, std::vector<OrderBookEntry>> strategyOrders;
+    for (Entry& entry : entries)
+    {
+        for (OrderBookEntry& order : entry.context->orders)
+        {
+            order.timestamp = timestamp;
+            strategyOrders[order.product].push_back(std::move(order));
+        }
+        entry.context->orders.clear();
+    }
+    if (strategyOrders.empty())
+    {
+        return;
+    }
+    std::map<std::string, std::vector<OrderBookEntry>> ordersByProduct;
+    for (OrderBookEntry const& order : tickOrders)
+    {
+        if (strategyOrders.count(order.product) > 0)
+        {
+            ordersByProduct[order.product].push_back(order);
+        }
+    }
+
+    std::vector<std::vector<OrderBookEntry>> fills(entries.size());
+    for (auto& e : strategyOrders)
+    {
+        std::vector<OrderBookEntry>& orders = ordersByProduct[e.first];
+        orders.insert(orders.end(), e.second.begin(), e.second.end());
+        std::vector<std::vector<OrderBookEntry>> result = OrderBook::matchAsksToBids(orders, e.first, timestamp);
+
+        for (OrderBookEntry& sale : result[0])
+        {
+            auto owner = entryByName.find(sale.username);
+            if (owner == entryByName.end())
+            {
+                continue;
+            }
+            Entry& entry = entries[owner->second];
+            entry.context->assets.processSale(sale);
+            entry.context->stats.fills++;
+            fills[owner->second].push_back(sale);
+            // a trade between two strategies is recorded for both, count it once
+            if (sale.orderStatus != "counterparty")
+            {
+                trades++;
+            }
+        }
+        for (OrderBookEntry const& order : result[1])
+        {
+            auto owner = entryByName.find(order.username);
+            if (owner != entryByName.end())
+            {
+                releaseOrder(entries[owner->second].context->assets, order);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (!fills[i].empty() && !entries[i].task.done())
+        {
+            entries[i].context->pending.push_back(MarketEvent{MarketEventType::fill, timestamp, currentMicros, std::move(fills[i])});
+        }
+    }
+}
+
+/** value of holdings at the last prices, in the quote currency of the valuation graph */
+static double valueAt(CurrencyGraph const& valuation, std::map<std::string, double> const& holdings)
+{
+    double value = 0;
+    for (auto const& e : holdings)
+    {
+        int currency = valuation.currencyId(e.first);
+        if (currency >= 0)
+        {
+            value += e.second * valuation.rate(currency);
+        }
+    }
+    return value;
+}
+
+/** value of a strategy's assets at the last prices, in USDT */
+double StrategyScheduler::valueOf(size_t strategy) const
+{
+    return valueAt(valuation, entries[strategy].context->getAssets().totalAssets.currencies);
+}
+
+/** one line per strategy, the most CPU time first
+ * the value is compared to holding the initial funds over the same prices */
+void StrategyScheduler::report(std::ostream& out) const
+{
+    long long totalCpu = 0;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        totalCpu += entries[i].context->getStats().cpuNanos;
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+    {
+        return entries[a].context->getStats().cpuNanos > entries[b].context->getStats().cpuNanos;
+    });
+
+    out << "Strategies: " << entries.size() << " over " << ticks << " ticks on " << (pool ? pool->size() : 1)
+        << " threads, " << trades << " trades, " << wallNanos / 1000 << " microseconds" << std::endl;
+    out << "strategy,resumes,cpu microseconds,cpu share %,max resume microseconds,orders,rejected,fills,value USDT,vs holding USDT,status" << std::endl;
+    for (size_t i : order)
+    {
+        Entry const& entry = entries[i];
+        StrategyStats const& stats = entry.context->getStats();
+        double value = valueOf(i);
+        std::string status = entry.failed ? "failed: " + entry.error : entry.task.done() ? "finished" : "running";
+        out << entry.context->getName() << ","
+            << stats.resumes << ","
+            << stats.cpuNanos / 1000 << ","
+            << (totalCpu > 0 ? std::round(1000.0 * stats.cpuNanos / totalCpu) / 10 : 0) << ","
+            << stats.maxResumeNanos / 1000 << ","
+            << stats.orders << ","
+            << stats.rejected << ","
+            << stats.fills << ","
+            << value << ","
+            << value - valueAt(valuation, entry.funds) << ","
+            << status << std::endl;
+    }
+}
+
+/** share of the free balance a sample strategy puts into one order */
+static const double orderShare = 0.05;
+
+/** buy or sell on the price move over lookback ticks, with the move when follow is set and against it otherwise */
+static StrategyTask priceMoveStrategy(StrategyContext& context, int lookback, double threshold, bool follow)
+{
+    // the last lookback prices of every product, oldest first
+    std::vector<std::deque<double>> history;
+    while (true)
+    {
+        MarketEvent event = co_await context.next();
+        if (event.type != MarketEventType::tick)
+        {
+            continue;
+        }
+        MarketView const& market = context.market();
+        history.resize(market.productCount());
+        for (size_t k = 0; k < market.productCount(); ++k)
+        {
+            double price = market.price[k];
+            if (price <= 0)
+            {
+                continue;
+            }
+            std::deque<double>& past = history[k];
+            past.push_back(price);
+            if ((int)past.size() <= lookback)
+            {
+                continue;
+            }
+            double move = price / past.front() - 1;
+            past.pop_front();
+            bool rising = follow ? move > threshold : move < -threshold;
+            bool falling = follow ? move < -threshold : move > threshold;
+            if (rising && market.minAsk[k] > 0)
+            {
+                context.bid(k, market.minAsk[k], orderShare * context.available(market.quoteCurrencies[k]) / market.minAsk[k]);
+            }
+            else if (falling && market.maxBid[k] > 0)
+            {
+                context.ask(k, market.maxBid[k], orderShare * context.available(market.baseCurrencies[k]));
+            }
+        }
+    }
+}
+
+StrategyTask momentumStrategy(StrategyContext& context, int lookback, double threshold)
+{
+    return priceMoveStrategy(context, lookback, threshold, true);
+}
+
+StrategyTask meanReversionStrategy(StrategyContext& context, int lookback, double threshold)
+{
+    return priceMoveStrategy(context, lookback, threshold, false);
+}
+
+StrategyTask crossoverStrategy(StrategyContext& context, int shortWindow, int longWindow)
+{
+    std::vector<std::deque<double>> history;
+    // which average was above at the last tick, 1 for the short one, -1 for the long one
+    std::vector<int> above;
+    while (true)
+    {
+        MarketEvent event = co_await context.next();
+        if (event.type != MarketEventType::tick)
+        {
+            continue;
+        }
+        MarketView const& market = context.market();
+        history.resize(market.productCount());
+        above.resize(market.productCount(), 0);
+        for (size_t k = 0; k < market.productCount(); ++k)
+        {
+            if (market.price[k] <= 0)
+            {
+                continue;
+            }
+            std::deque<double>& past = history[k];
+            past.push_back(market.price[k]);
+            if ((int)past.size() > longWindow)
+            {
+                past.pop_front();
+            }
+            if ((int)past.size() < longWindow)
+            {
+                continue;
+            }
+            double shortSum = 0;
+            double longSum = 0;
+            for (int i = 0; i < longWindow; ++i)
+            {
+                longSum += past[i];
+                if (i >= longWindow - shortWindow)
+                {
+                    shortSum += past[i];
+                }
+            }
+            int now = shortSum / shortWindow > longSum / longWindow ? 1 : -1;
+            if (above[k] == -1 && now == 1 && market.minAsk[k] > 0)
+            {
+                context.bid(k, market.minAsk[k], orderShare * context.available(market.quoteCurrencies[k]) / market.minAsk[k]);
+            }
+            else if (above[k] == 1 && now == -1 && market.maxBid[k] > 0)
+            {
+                context.ask(k, market.maxBid[k], orderShare * context.available(market.baseCurrencies[k]));
+            }
+            above[k] = now;
+        }
+    }
+}
+
+StrategyTask averagingStrategy(StrategyContext& context, long long intervalMicros, double share)
+{
+    // the first purchase at the tick after the start
+    context.wakeAfter(0);
+    while (true)
+    {
+        MarketEvent event = co_await context.next();
+        if (event.type != MarketEventType::timer)
+        {
+            continue;
+        }
+        MarketView const& market = context.market();
+        for (size_t k = 0; k < market.productCount(); ++k)
+        {
+            if (market.minAsk[k] > 0)
+            {
+                context.bid(k, market.minAsk[k], share * context.available(market.quoteCurrencies[k]) / market.minAsk[k]);
+            }
+        }
+        context.wakeAfter(intervalMicros);
+    }
+}
+
+#endif
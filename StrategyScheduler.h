@@ -0,0 +1,261 @@
+#pragma once
+#include "OrderBook.h"
+#include "OrderBookEntry.h"
+#include "Assets.h"
+#include "Strategy.h"
+#include "PredictionEngine.h"
+#include "CurrencyGraph.h"
+#include "WorkStealingPool.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <iostream>
+
+// the scheduler needs C++20 coroutines, a C++17 build leaves it out and the arena subcommand says so
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define MERKELBOT_COROUTINES 1
+#endif
+
+#ifdef MERKELBOT_COROUTINES
+
+/** kinds of events a strategy coroutine wakes up for */
+enum class MarketEventType {tick, fill, timer};
+
+/** what a strategy coroutine gets back from StrategyContext::next */
+struct MarketEvent
+{
+    MarketEventType type = MarketEventType::tick;
+    std::string timestamp;
+    long long micros = 0;
+    // the sales of the strategy's orders at this tick, for a fill event
+    std::vector<OrderBookEntry> fills;
+};
+
+/** coroutine type of a strategy, created suspended and resumed by the scheduler only */
+class StrategyTask
+{
+    public:
+        struct promise_type
+        {
+            StrategyTask get_return_object()
+            {
+                return StrategyTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+            std::suspend_always final_suspend() noexcept
+            {
+                return {};
+            }
+            void return_void()
+            {
+
+            }
+            void unhandled_exception()
+            {
+                error = std::current_exception();
+            }
+
+            std::exception_ptr error;
+        };
+
+        StrategyTask(StrategyTask&& other) noexcept;
+        StrategyTask& operator=(StrategyTask&& other) noexcept;
+        StrategyTask(StrategyTask const&) = delete;
+        StrategyTask& operator=(StrategyTask const&) = delete;
+        ~StrategyTask();
+
+        /** run the strategy up to its next co_await, rethrows what escaped the strategy */
+        void resume();
+
+        /** the strategy returned or threw */
+        bool done() const;
+
+    private:
+        explicit StrategyTask(std::coroutine_handle<promise_type> _handle);
+
+        std::coroutine_handle<promise_type> handle;
+};
+
+/** CPU time and activity of one strategy */
+struct StrategyStats
+{
+    long long resumes = 0;
+    long long cpuNanos = 0;
+    long long maxResumeNanos = 0;
+    long long orders = 0;
+    long long rejected = 0;
+    long long fills = 0;
+};
+
+/** everything a strategy coroutine sees of the market and of its own account
+ * a strategy only touches its own context while it runs, so the scheduler can resume different
+ * strategies on different threads; orders are reserved at once and matched at the next tick */
+class StrategyContext
+{
+    public:
+        StrategyContext(std::string _name, MarketView const& _market);
+
+        /** awaitable of the next event for this strategy: co_await context.next() */
+        struct EventAwaiter
+        {
+            StrategyContext& context;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+            void await_suspend(std::coroutine_handle<>) const noexcept
+            {
+
+            }
+            MarketEvent await_resume() const
+            {
+                return context.current;
+            }
+        };
+
+        EventAwaiter next();
+
+        /** market state of the current tick, shared by all strategies */
+        MarketView const& market() const;
+
+        /** buy amount of the base currency of a product at price, false if the quote currency does not cover it */
+        bool bid(int product, double price, double amount);
+
+        /** sell amount of the base currency of a product at price, false if the base currency does not cover it */
+        bool ask(int product, double price, double amount);
+
+        /** free balance of a currency */
+        double available(std::string const& currency) const;
+
+        /** a timer event once the market time reaches micros */
+        void wakeAt(long long micros);
+
+        /** a timer event micros after the current event */
+        void wakeAfter(long long micros);
+
+        std::string const& getName() const;
+        Assets const& getAssets() const;
+        StrategyStats const& getStats() const;
+
+    private:
+        friend class StrategyScheduler;
+
+        /** reserve the funds of an order and queue it for the next matching */
+        bool submit(int product, OrderBookType side, double price, double amount);
+
+        std::string name;
+        MarketView const& view;
+        Assets assets;
+        StrategyStats stats;
+
+        // events waiting to be delivered and the one being handled
+        std::deque<MarketEvent> pending;
+        MarketEvent current;
+        // market times of the timers still to fire, in the order they were set
+        std::vector<long long> timers;
+        // orders placed since the last matching
+        std::vector<OrderBookEntry> orders;
+        long long orderCount = 0;
+};
+
+/** a coroutine strategy as the scheduler starts it, e.g. [](StrategyContext& c) { return momentumStrategy(c, 10, 0.001); } */
+typedef std::function<StrategyTask(StrategyContext&)> StrategyFactory;
+
+/** steps many strategy coroutines through one market timeline
+ * every tick the due timers and the tick event are delivered, the orders the strategies placed are
+ * matched against the dataset orders of the tick and each other's, and the fills are delivered;
+ * within a delivery round the strategies are resumed in registration order on one thread, or spread
+ * over a small pool, and their orders are merged in registration order either way, so a run gives the
+ * same results with any number of threads; every resume is timed in thread CPU time so the report
+ * shows which strategies the run spends its time in */
+class StrategyScheduler
+{
+    public:
+        /** threads 1 resumes the strategies on the calling thread */
+        StrategyScheduler(std::shared_ptr<const OrderBook> _dataset, int threads = 1);
+
+        /** add a strategy with its initial funds, names must be unique, throws std::invalid_argument */
+        void addStrategy(std::string const& name, StrategyFactory factory, std::map<std::string, double> const& funds);
+
+        size_t strategyCount() const;
+
+        /** replay the whole dataset */
+        void run();
+
+        /** one line per strategy, the most CPU time first */
+        void report(std::ostream& out) const;
+
+        /** value of a strategy's assets at the last prices, in USDT */
+        double valueOf(size_t strategy) const;
+
+    private:
+        struct Entry
+        {
+            std::unique_ptr<StrategyContext> context;
+            StrategyTask task;
+            std::map<std::string, double> funds;
+            bool started = false;
+            bool failed = false;
+            std::string error;
+        };
+
+        /** set the market view from the dataset orders of a tick */
+        void updateMarket(std::vector<OrderBookEntry> const& tickOrders);
+
+        /** resume every strategy with pending events until it has handled all of them */
+        void deliver();
+
+        /** resume one strategy for each of its pending events, timing every resume */
+        void resumeStrategy(Entry& entry);
+
+        /** one resume of a strategy, counted in the CPU time of the thread it ran on */
+        void timedResume(Entry& entry);
+
+        /** match the orders of the strategies against the dataset orders of the tick and settle the fills */
+        void matchOrders(std::string const& timestamp, std::vector<OrderBookEntry> const& tickOrders);
+
+        std::shared_ptr<const OrderBook> dataset;
+        std::unique_ptr<WorkStealingPool> pool;
+
+        std::vector<Entry> entries;
+        std::map<std::string, size_t> entryByName;
+
+        MarketView view;
+        std::map<std::string, int> productIndex;
+        PredictionEngine predictions;
+        std::vector<double> tickPrices;
+        CurrencyGraph valuation;
+        std::vector<int> valuationIds;
+
+        std::string currentTime;
+        long long currentMicros = 0;
+        long long ticks = 0;
+        long long wallNanos = 0;
+        long long trades = 0;
+};
+
+/** sample strategies for the arena subcommand, each keeps its own state in its coroutine frame */
+
+/** trend following: buy after the price rose by threshold over lookback ticks, sell after it fell */
+StrategyTask momentumStrategy(StrategyContext& context, int lookback, double threshold);
+
+/** the opposite bet: sell after a rise and buy after a fall over lookback ticks */
+StrategyTask meanReversionStrategy(StrategyContext& context, int lookback, double threshold);
+
+/** moving average crossover over its own price history, recomputed from scratch every tick
+ * so its cost grows with the long window, the slow strategy of the arena */
+StrategyTask crossoverStrategy(StrategyContext& context, int shortWindow, int longWindow);
+
+/** buy a fixed share of the free quote currency of every product each interval, woken by a timer */
+StrategyTask averagingStrategy(StrategyContext& context, long long intervalMicros, double share);
+
+#endif
@@ -0,0 +1,156 @@
+#include "TickIndex.h"
+#include <algorithm>
+#include <array>
+
+double RangeStats::vwap() const
+{
+    if (volume == 0)
+    {
+        return 0;
+    }
+    return notional / volume;
+}
+
+TickSeries::TickSeries()
+: orderPrefix{0},
+  volumePrefix{0},
+  notionalPrefix{0}
+{
+
+}
+
+/** append the aggregate of one tick, ticks must be added in time order */
+void TickSeries::addTick(long long time, int orders, double volume, double notional, double minPrice, double maxPrice)
+{
+    times.push_back(time);
+    orderPrefix.push_back(orderPrefix.back() + orders);
+    volumePrefix.push_back(volumePrefix.back() + volume);
+    notionalPrefix.push_back(notionalPrefix.back() + notional);
+    tickMin.push_back(minPrice);
+    tickMax.push_back(maxPrice);
+}
+
+/** build the sparse tables once all ticks have been added */
+void TickSeries::build()
+{
+    minTable.assign(1, tickMin);
+    maxTable.assign(1, tickMax);
+    for (size_t width = 2; width <= times.size(); width *= 2)
+    {
+        const std::vector<double>& prevMin = minTable.back();
+        const std::vector<double>& prevMax = maxTable.back();
+        size_t half = width / 2;
+        std::vector<double> levelMin(times.size() - width + 1);
+        std::vector<double> levelMax(times.size() - width + 1);
+        for (size_t i = 0; i + width <= times.size(); ++i)
+        {
+            levelMin[i] = std::min(prevMin[i], prevMin[i + half]);
+            levelMax[i] = std::max(prevMax[i], prevMax[i + half]);
+        }
+        minTable.push_back(std::move(levelMin));
+        maxTable.push_back(std::move(levelMax));
+    }
+}
+
+/** statistics for ticks with from <= time <= to */
+RangeStats TickSeries::query(long long from, long long to) const
+{
+    RangeStats stats;
+    // binary search for the first tick at or after from and the first tick after to
+    size_t first = std::lower_bound(times.begin(), times.end(), from) - times.begin();
+    size_t last = std::upper_bound(times.begin(), times.end(), to) - times.begin();
+    if (first >= last)
+    {
+        return stats;
+    }
+
+    size_t ticks = last - first;
+    stats.ticks = ticks;
+    stats.orders = orderPrefix[last] - orderPrefix[first];
+    stats.volume = volumePrefix[last] - volumePrefix[first];
+    stats.notional = notionalPrefix[last] - notionalPrefix[first];
+
+    // two overlapping power of two blocks cover the window
+    int level = 0;
+    while ((size_t(2) << level) <= ticks)
+    {
+        ++level;
+    }
+    size_t second = last - (size_t(1) << level);
+    stats.minPrice = std::min(minTable[level][first], minTable[level][second]);
+    stats.maxPrice = std::max(maxTable[level][first], maxTable[level][second]);
+    return stats;
+}
+
+TickIndex::TickIndex()
+{
+
+}
+
+/** build the index from orders grouped by timestamp */
+void TickIndex::build(std::map<std::string, std::vector<OrderBookEntry>> const& ordersByTimestamp)
+{
+    bidSeries.clear();
+    askSeries.clear();
+
+    // per product aggregate of the current tick, bids in [0] and asks in [1]
+    struct TickAggregate
+    {
+        int orders = 0;
+        double volume = 0;
+        double notional = 0;
+        double minPrice = 0;
+        double maxPrice = 0;
+    };
+
+    // the map is ordered by timestamp so every series receives its ticks in time order
+    for (auto const& tick : ordersByTimestamp)
+    {
+        long long time = OrderBookEntry::timestampToMicros(tick.first);
+        std::map<std::string, std::array<TickAggregate, 2>> aggregates;
+        for (OrderBookEntry const& e : tick.second)
+        {
+            if (e.orderType != OrderBookType::bid && e.orderType != OrderBookType::ask)
+                continue;
+            TickAggregate& a = aggregates[e.product][e.orderType == OrderBookType::bid ? 0 : 1];
+            if (a.orders == 0 || e.price < a.minPrice) a.minPrice = e.price;
+            if (a.orders == 0 || e.price > a.maxPrice) a.maxPrice = e.price;
+            a.orders++;
+            a.volume += e.amount;
+            a.notional += e.price * e.amount;
+        }
+
+        for (auto& p : aggregates)
+        {
+            for (int side = 0; side < 2; ++side)
+            {
+                TickAggregate& a = p.second[side];
+                if (a.orders == 0)
+                    continue;
+                TickSeries& s = side == 0 ? bidSeries[p.first] : askSeries[p.first];
+                s.addTick(time, a.orders, a.volume, a.notional, a.minPrice, a.maxPrice);
+            }
+        }
+    }
+
+    for (auto& e : bidSeries)
+    {
+        e.second.build();
+    }
+    for (auto& e : askSeries)
+    {
+        e.second.build();
+    }
+}
+
+/** statistics for a product and side between two timestamps (inclusive) */
+RangeStats TickIndex::query(std::string const& product, OrderBookType type, long long from, long long to) const
+{
+    const std::map<std::string, TickSeries>& sideSeries = type == OrderBookType::bid ? bidSeries : askSeries;
+    auto it = sideSeries.find(product);
+    if (it == sideSeries.end())
+    {
+        return RangeStats{};
+    }
+    return it->second.query(from, to);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <map>
+
+/** aggregated statistics for one product and one side over a time window */
+struct RangeStats
+{
+    // number of ticks and orders in the window
+    int ticks = 0;
+    long long orders = 0;
+    double volume = 0;
+    double notional = 0;
+    double minPrice = 0;
+    double maxPrice = 0;
+
+    /** amount weighted average price of the orders in the window, 0 if empty */
+    double vwap() const;
+};
+
+/** per tick series for one product and one side with prefix sums and sparse tables */
+class TickSeries
+{
+    public:
+        TickSeries();
+
+        /** append the aggregate of one tick, ticks must be added in time order */
+        void addTick(long long time, int orders, double volume, double notional, double minPrice, double maxPrice);
+
+        /** build the sparse tables once all ticks have been added */
+        void build();
+
+        /** statistics for ticks with from <= time <= to */
+        RangeStats query(long long from, long long to) const;
+
+    private:
+        std::vector<long long> times;
+
+        // prefix sums, entry i covers ticks [0, i)
+        std::vector<long long> orderPrefix;
+        std::vector<double> volumePrefix;
+        std::vector<double> notionalPrefix;
+
+        // per tick extremes and their sparse tables, level k covers 2^k ticks
+        std::vector<double> tickMin;
+        std::vector<double> tickMax;
+        std::vector<std::vector<double>> minTable;
+        std::vector<std::vector<double>> maxTable;
+};
+
+/** range-query index over the tick series of every product, built at load time */
+class TickIndex
+{
+    public:
+        TickIndex();
+
+        /** build the index from orders grouped by timestamp */
+        void build(std::map<std::string, std::vector<OrderBookEntry>> const& ordersByTimestamp);
+
+        /** statistics for a product and side between two timestamps (inclusive) */
+        RangeStats query(std::string const& product, OrderBookType type, long long from, long long to) const;
+
+    private:
+        std::map<std::string, TickSeries> bidSeries;
+        std::map<std::string, TickSeries> askSeries;
+};
@@ -0,0 +1,191 @@
+#include "TickStream.h"
+#include "CSVReader.h"
+#include <algorithm>
+
+/** earlier timestamps first, ties broken by file order so the merge is deterministic */
+bool TickStream::HeapEntry::operator>(HeapEntry const& other) const
+{
+    if (timestamp != other.timestamp)
+    {
+        return timestamp > other.timestamp;
+    }
+    return feedIndex > other.feedIndex;
+}
+
+TickStream::TickStream(std::vector<std::string> const& files, int _maxBufferedTicks, unsigned parserThreads)
+: maxBufferedTicks(_maxBufferedTicks > 0 ? _maxBufferedTicks : 0)
+{
+    for (std::string const& f : files)
+    {
+        feeds.push_back(std::unique_ptr<FileFeed>(new FileFeed{}));
+        feeds.back()->filename = f;
+    }
+    heads.resize(feeds.size());
+
+    // no more parsers than files or cores
+    if (parserThreads == 0)
+    {
+        parserThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t threads = std::min<size_t>(parserThreads, feeds.size());
+    for (size_t i = 0; i < threads; ++i)
+    {
+        parsers.emplace_back([this]() { parse(); });
+    }
+}
+
+TickStream::~TickStream()
+{
+    // wake up parsers waiting for a file with room in its queue and let them exit
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (std::thread& parser : parsers)
+    {
+        parser.join();
+    }
+}
+
+/** parser thread: parse one tick at a time of the file most in need until every file is finished */
+void TickStream::parse()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        // the unclaimed file with the fewest ticks queued, the consumer waits on an empty one first
+        FileFeed* next = nullptr;
+        bool unfinished = false;
+        for (auto& feed : feeds)
+        {
+            if (feed->finished)
+                continue;
+            unfinished = true;
+            if (feed->claimed || (maxBufferedTicks > 0 && feed->ticks.size() >= maxBufferedTicks))
+                continue;
+            if (!next || feed->ticks.size() < next->ticks.size())
+                next = feed.get();
+        }
+        if (stopping || !unfinished)
+        {
+            return;
+        }
+        if (!next)
+        {
+            changed.wait(lock);
+            continue;
+        }
+
+        next->claimed = true;
+        lock.unlock();
+        Tick tick;
+        bool more = parseTick(*next, tick);
+        lock.lock();
+        if (!tick.orders.empty())
+        {
+            next->ticks.push_back(std::move(tick));
+        }
+        next->finished = !more;
+        next->claimed = false;
+        changed.notify_all();
+    }
+}
+
+/** read the file up to the end of its next tick, false at the end of the file */
+bool TickStream::parseTick(FileFeed& feed, Tick& tick)
+{
+    if (!feed.opened)
+    {
+        feed.file.open(feed.filename);
+        feed.opened = true;
+    }
+    std::string line;
+    while (feed.file.is_open() && std::getline(feed.file, line))
+    {
+        try
+        {
+            OrderBookEntry obe = CSVReader::stringsToOBE(CSVReader::tokenise(line, ','));
+            // a new timestamp closes the current tick
+            if (!feed.current.orders.empty() && obe.timestamp != feed.current.timestamp)
+            {
+                tick = std::move(feed.current);
+                feed.current = Tick{};
+                feed.current.timestamp = obe.timestamp;
+                feed.current.orders.push_back(obe);
+                return true;
+            }
+            feed.current.timestamp = obe.timestamp;
+            feed.current.orders.push_back(obe);
+        }
+        catch(const std::exception& e)
+        {
+            // skip bad lines, as CSVReader::readCSV does
+        }
+    }
+    tick = std::move(feed.current);
+    feed.current = Tick{};
+    feed.file.close();
+    return false;
+}
+
+/** block until the feed has a tick or is finished, returns false when finished */
+bool TickStream::popTick(FileFeed& feed, Tick& tick)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [&feed]() { return !feed.ticks.empty() || feed.finished; });
+    if (feed.ticks.empty())
+    {
+        return false;
+    }
+    tick = std::move(feed.ticks.front());
+    feed.ticks.pop_front();
+    lock.unlock();
+    // there is room in the queue again
+    changed.notify_all();
+    return true;
+}
+
+/** next tick across all files, orders with equal timestamps are combined */
+bool TickStream::nextTick(Tick& tick)
+{
+    // prime the heap with the first tick of every file
+    if (!started)
+    {
+        started = true;
+        for (size_t i = 0; i < feeds.size(); ++i)
+        {
+            if (popTick(*feeds[i], heads[i]))
+            {
+                heap.push(HeapEntry{heads[i].timestamp, i});
+            }
+        }
+    }
+
+    if (heap.empty())
+    {
+        return false;
+    }
+
+    tick = Tick{};
+    tick.timestamp = heap.top().timestamp;
+    // take the head of every file at this timestamp and refill from the same file
+    while (!heap.empty() && heap.top().timestamp == tick.timestamp)
+    {
+        size_t i = heap.top().feedIndex;
+        heap.pop();
+        if (tick.orders.empty())
+        {
+            tick.orders = std::move(heads[i].orders);
+        }
+        else
+        {
+            tick.orders.insert(tick.orders.end(), heads[i].orders.begin(), heads[i].orders.end());
+        }
+        if (popTick(*feeds[i], heads[i]))
+        {
+            heap.push(HeapEntry{heads[i].timestamp, i});
+        }
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include "OrderBookEntry.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <queue>
+#include <fstream>
+
+/** all orders of a file sharing one timestamp */
+struct Tick
+{
+    std::string timestamp;
+    std::vector<OrderBookEntry> orders;
+};
+
+/** time ordered stream of ticks merged from several CSV files
+ * the files are parsed by a pool of at most hardware_concurrency threads into one bounded queue of ticks per file
+ * and the queues are merged by timestamp with a k-way heap merge; a parser takes one tick at a time from
+ * whichever file has the fewest ticks queued and room for more, so any number of files needs neither a
+ * thread each nor more than maxBufferedTicks ticks of each in memory
+ * every file is expected to be sorted by timestamp, as the exchange dumps are */
+class TickStream
+{
+    public:
+        /** start parsing the files, at most maxBufferedTicks ticks of each file are parsed ahead (0 for no limit)
+         * with at most parserThreads threads (0 for the number of cores) */
+        TickStream(std::vector<std::string> const& files, int maxBufferedTicks = 16, unsigned parserThreads = 0);
+        ~TickStream();
+
+        TickStream(TickStream const&) = delete;
+        TickStream& operator=(TickStream const&) = delete;
+
+        /** next tick across all files, orders with equal timestamps are combined
+         * returns false once every file has been consumed */
+        bool nextTick(Tick& tick);
+
+    private:
+        /** parser state and output queue for one file, the queue and flags are guarded by the stream mutex */
+        struct FileFeed
+        {
+            std::string filename;
+            std::deque<Tick> ticks;
+            bool finished = false;
+            // a parser is reading the file, only the parser touches the file and the tick being built
+            bool claimed = false;
+            bool opened = false;
+            std::ifstream file;
+            Tick current;
+        };
+
+        /** parser thread: parse one tick at a time of the file most in need until every file is finished */
+        void parse();
+
+        /** read the file up to the end of its next tick, false at the end of the file
+         * the complete tick is moved to tick, the first order of the following one stays in the feed */
+        bool parseTick(FileFeed& feed, Tick& tick);
+
+        /** block until the feed has a tick or is finished, returns false when finished */
+        bool popTick(FileFeed& feed, Tick& tick);
+
+        std::vector<std::unique_ptr<FileFeed>> feeds;
+        size_t maxBufferedTicks;
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<std::thread> parsers;
+
+        // head tick of every feed that still has data, ordered by earliest timestamp
+        struct HeapEntry
+        {
+            std::string timestamp;
+            size_t feedIndex;
+            bool operator>(HeapEntry const& other) const;
+        };
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+        std::vector<Tick> heads;
+        bool started = false;
+};
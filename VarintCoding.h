@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/** signed deltas near zero become small unsigned values: 0, -1, 1, -2, ... map to 0, 1, 2, 3, ... */
+inline uint64_t zigzag(long long value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline long long unzigzag(uint64_t value)
+{
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+/** append a LEB128 varint, 7 bits per byte, low bits first, the high bit set on all but the last byte */
+inline void encodeVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+/** read a LEB128 varint at position and move past it,
+ * false if the data ends inside the number or it does not fit 64 bits */
+inline bool decodeVarint(std::string const& data, size_t& position, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && position < data.size(); shift += 7)
+    {
+        unsigned char byte = data[position++];
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
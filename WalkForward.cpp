@@ -0,0 +1,180 @@
+#include "WalkForward.h"
+#include "MerkelBot.h"
+#include "WorkStealingPool.h"
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+
+double WalkForwardSegment::pnl() const
+{
+    return finalAssetsUSD - initialAssetsUSD;
+}
+
+double WalkForwardReport::stitchedPnL() const
+{
+    double total = 0;
+    for (WalkForwardSegment const& s : segments)
+    {
+        total += s.pnl();
+    }
+    return total;
+}
+
+int WalkForwardReport::stitchedFills() const
+{
+    int total = 0;
+    for (WalkForwardSegment const& s : segments)
+    {
+        total += s.fills;
+    }
+    return total;
+}
+
+WalkForwardRunner::WalkForwardRunner(std::shared_ptr<const OrderBook> _dataset,
+                                     int _segmentCount,
+                                     int _warmupTicks,
+                                     BotParameters _parameters,
+                                     std::string _outputDirectory,
+                                     int _threads)
+: dataset(_dataset),
+  segmentCount(std::max(1, _segmentCount)),
+  warmupTicks(std::max(0, _warmupTicks)),
+  parameters(_parameters),
+  outputDirectory(_outputDirectory),
+  threads(_threads)
+{
+
+}
+
+/** split the traded ticks into contiguous segments */
+std::vector<WalkForwardSegment> WalkForwardRunner::plan() const
+{
+    std::vector<WalkForwardSegment> segments;
+    // the last timestamp is never matched, it only receives carryovers
+    size_t tradedTicks = dataset->timestamps.empty() ? 0 : dataset->timestamps.size() - 1;
+    size_t count = std::min<size_t>(segmentCount, std::max<size_t>(tradedTicks, 1));
+    for (size_t k = 0; k < count; ++k)
+    {
+        WalkForwardSegment s;
+        s.tradeStart = k * tradedTicks / count;
+        s.tradeEnd = (k + 1) * tradedTicks / count;
+        s.warmupStart = s.tradeStart > (size_t)warmupTicks ? s.tradeStart - warmupTicks : 0;
+        s.outputDirectory = outputDirectory + "/segment_" + std::to_string(k + 1);
+        segments.push_back(s);
+    }
+    return segments;
+}
+
+/** concatenate a log of every segment into one file in the output directory */
+void WalkForwardRunner::stitchLog(std::vector<WalkForwardSegment> const& segments, std::string const& filename) const
+{
+    std::ofstream stitched{outputDirectory + "/" + filename};
+    bool headerWritten = false;
+    for (WalkForwardSegment const& s : segments)
+    {
+        std::ifstream part{s.outputDirectory + "/" + filename};
+        std::string line;
+        // keep the header of the first segment only
+        if (std::getline(part, line) && !headerWritten)
+        {
+            stitched << line << std::endl;
+            headerWritten = true;
+        }
+        while (std::getline(part, line))
+        {
+            stitched << line << std::endl;
+        }
+    }
+}
+
+/** run the segments in parallel, stitch their logs and run the sequential reference */
+WalkForwardReport WalkForwardRunner::run()
+{
+    WalkForwardReport report;
+    report.segments = plan();
+    std::filesystem::create_directories(outputDirectory);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    {
+        WorkStealingPool pool{threads};
+        for (WalkForwardSegment& s : report.segments)
+        {
+            pool.submit([this, &s]()
+            {
+                auto segmentStart = std::chrono::high_resolution_clock::now();
+                std::filesystem::create_directories(s.outputDirectory);
+
+                MerkelBot bot{dataset};
+                bot.setParameters(parameters);
+                bot.setTickRange(s.warmupStart, s.tradeStart, s.tradeEnd);
+                bot.setOutputDirectory(s.outputDirectory);
+                bot.setVerbose(false);
+                bot.init();
+
+                s.initialAssetsUSD = bot.getInitialAssetsUSD();
+                s.finalAssetsUSD = bot.getTotalAssetsUSD();
+                s.fills = bot.getFillCount();
+                s.orders = bot.getOrderCount();
+
+                auto segmentStop = std::chrono::high_resolution_clock::now();
+                s.wallTimeMicros = std::chrono::duration_cast<std::chrono::microseconds>(segmentStop - segmentStart).count();
+            });
+        }
+        pool.wait();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    report.parallelMicros = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+
+    stitchLog(report.segments, "BotSalesLog.csv");
+    stitchLog(report.segments, "BotActiveOrdersLog.csv");
+    stitchLog(report.segments, "BotCancelledOrdersLog.csv");
+
+    // sequential reference over the whole timeline, run on its own so its timing is not shared
+    start = std::chrono::high_resolution_clock::now();
+    MerkelBot sequential{dataset};
+    sequential.setParameters(parameters);
+    sequential.setLogging(false);
+    sequential.setVerbose(false);
+    sequential.init();
+    stop = std::chrono::high_resolution_clock::now();
+    report.sequentialMicros = std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count();
+    report.sequentialPnL = sequential.getTotalAssetsUSD() - sequential.getInitialAssetsUSD();
+    report.sequentialFills = sequential.getFillCount();
+
+    return report;
+}
+
+/** write the per-segment table and the divergence from the sequential run */
+void WalkForwardRunner::writeReport(WalkForwardReport const& report, std::ostream& out)
+{
+    out << "Segment,Warmup_Start_Tick,Trade_Start_Tick,Trade_End_Tick,Initial_Assets_USD,Final_Assets_USD,";
+    out << "PnL_USD,Cumulative_PnL_USD,Fills,Orders,Wall_Time_Microseconds" << std::endl;
+    double cumulative = 0;
+    for (size_t k = 0; k < report.segments.size(); ++k)
+    {
+        WalkForwardSegment const& s = report.segments[k];
+        cumulative += s.pnl();
+        out << k + 1 << ",";
+        out << s.warmupStart << "," << s.tradeStart << "," << s.tradeEnd << ",";
+        out << std::to_string(s.initialAssetsUSD) << ",";
+        out << std::to_string(s.finalAssetsUSD) << ",";
+        out << std::to_string(s.pnl()) << ",";
+        out << std::to_string(cumulative) << ",";
+        out << s.fills << "," << s.orders << ",";
+        out << s.wallTimeMicros << std::endl;
+    }
+
+    double divergence = report.stitchedPnL() - report.sequentialPnL;
+    out << "Stitched PnL USD: " << std::to_string(report.stitchedPnL()) << std::endl;
+    out << "Sequential PnL USD: " << std::to_string(report.sequentialPnL) << std::endl;
+    out << "Divergence USD: " << std::to_string(divergence);
+    if (report.sequentialPnL != 0)
+    {
+        out << " (" << std::to_string(100 * std::fabs(divergence / report.sequentialPnL)) << "% of sequential PnL)";
+    }
+    out << std::endl;
+    out << "Fills stitched/sequential: " << report.stitchedFills() << "/" << report.sequentialFills << std::endl;
+    out << "Parallel wall time: " << report.parallelMicros << " microseconds, ";
+    out << "sequential: " << report.sequentialMicros << " microseconds" << std::endl;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "BotParameters.h"
+#include "OrderBook.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+
+/** one slice of the timeline and its result */
+struct WalkForwardSegment
+{
+    // tick indexes: history from warmupStart, trading from tradeStart up to tradeEnd (excluded)
+    size_t warmupStart = 0;
+    size_t tradeStart = 0;
+    size_t tradeEnd = 0;
+    std::string outputDirectory;
+    double initialAssetsUSD = 0;
+    double finalAssetsUSD = 0;
+    int fills = 0;
+    int orders = 0;
+    long long wallTimeMicros = 0;
+
+    /** profit and loss of the segment in USD */
+    double pnl() const;
+};
+
+/** segment results next to the fully sequential run of the same timeline */
+struct WalkForwardReport
+{
+    std::vector<WalkForwardSegment> segments;
+    double sequentialPnL = 0;
+    int sequentialFills = 0;
+    long long sequentialMicros = 0;
+    long long parallelMicros = 0;
+
+    /** sum of the segment profit and loss */
+    double stitchedPnL() const;
+
+    /** sum of the segment fills */
+    int stitchedFills() const;
+};
+
+/** splits one long dataset into segments with a warm-up prefix and replays them in parallel */
+class WalkForwardRunner
+{
+    public:
+        /** warmupTicks of history precede every segment, threads 0 uses one worker per hardware thread */
+        WalkForwardRunner(std::shared_ptr<const OrderBook> _dataset,
+                          int _segmentCount,
+                          int _warmupTicks,
+                          BotParameters _parameters,
+                          std::string _outputDirectory,
+                          int _threads = 0);
+
+        /** run the segments in parallel, stitch their logs and run the sequential reference */
+        WalkForwardReport run();
+
+        /** write the per-segment table and the divergence from the sequential run */
+        static void writeReport(WalkForwardReport const& report, std::ostream& out);
+
+    private:
+        /** split the traded ticks into contiguous segments */
+        std::vector<WalkForwardSegment> plan() const;
+
+        /** concatenate a log of every segment into one file in the output directory */
+        void stitchLog(std::vector<WalkForwardSegment> const& segments, std::string const& filename) const;
+
+        std::shared_ptr<const OrderBook> dataset;
+        int segmentCount;
+        int warmupTicks;
+        BotParameters parameters;
+        std::string outputDirectory;
+        int threads;
+};
@@ -49,8 +49,8 @@ bool Wallet::containsCurrency(std::string type, double amount)
     if (currencies.count(type) == 0) // not there yet
         return false;
     else
-        // added 0.9999 multiplication to avoid rounding from floating point calculations on reserved wallet
-        return currencies[type] >= 0.9999 * amount;
+        // compared at the 8 decimals of the exchange, so floating point noise on the reserved wallet does not count
+        return Decimal::fromDouble(currencies[type]) >= Decimal::fromDouble(amount);
 }
 
 std::string Wallet::toString()
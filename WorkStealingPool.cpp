@@ -0,0 +1,135 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.push_back(std::unique_ptr<Worker>(new Worker{}));
+    }
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i]->thread = std::thread([this, i]() { run(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (auto& w : workers)
+    {
+        w->thread.join();
+    }
+}
+
+/** queue a task, tasks are spread round robin over the workers */
+void WorkStealingPool::submit(std::function<void()> task)
+{
+    // counted before it is visible so a worker can never finish it before it is counted
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        pending++;
+        queued++;
+    }
+    Worker& w = *workers[nextWorker++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(w.mutex);
+        w.tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+/** block until every submitted task has finished */
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this]() { return pending == 0; });
+}
+
+int WorkStealingPool::size() const
+{
+    return workers.size();
+}
+
+long long WorkStealingPool::stealCount() const
+{
+    return steals;
+}
+
+/** take a task from the back of the own deque or the front of another one */
+bool WorkStealingPool::takeTask(size_t self, std::function<void()>& task)
+{
+    {
+        Worker& own = *workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < workers.size(); ++i)
+    {
+        Worker& victim = *workers[(self + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** worker loop: own tasks first, then steal, then sleep */
+void WorkStealingPool::run(size_t self)
+{
+    while (true)
+    {
+        {
+            // sleep until something is queued anywhere in the pool
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this]() { return stopping || queued > 0; });
+            if (stopping && queued == 0)
+            {
+                return;
+            }
+        }
+
+        std::function<void()> task;
+        if (!takeTask(self, task))
+        {
+            // another worker got there first
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued--;
+        }
+
+        task();
+
+        bool finished;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            finished = --pending == 0;
+        }
+        if (finished)
+        {
+            allDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+/** fixed size thread pool where every worker owns a task deque
+ * workers take their own tasks from the back and steal from the front of the others when idle */
+class WorkStealingPool
+{
+    public:
+        /** start the workers, 0 uses one worker per hardware thread */
+        WorkStealingPool(int threads = 0);
+        ~WorkStealingPool();
+
+        WorkStealingPool(WorkStealingPool const&) = delete;
+        WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+
+        /** queue a task, tasks are spread round robin over the workers */
+        void submit(std::function<void()> task);
+
+        /** block until every submitted task has finished */
+        void wait();
+
+        /** number of worker threads */
+        int size() const;
+
+        /** number of tasks taken from another worker's deque */
+        long long stealCount() const;
+
+    private:
+        struct Worker
+        {
+            std::deque<std::function<void()>> tasks;
+            std::mutex mutex;
+            std::thread thread;
+        };
+
+        /** worker loop: own tasks first, then steal, then sleep */
+        void run(size_t self);
+
+        /** take a task from the back of the own deque or the front of another one */
+        bool takeTask(size_t self, std::function<void()>& task);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<size_t> nextWorker{0};
+        std::atomic<long long> steals{0};
+
+        // pending counts queued and running tasks, guarded by stateMutex for sleeping and waiting
+        std::mutex stateMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        long long pending = 0;
+        long long queued = 0;
+        bool stopping = false;
+};
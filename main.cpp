@@ -5,13 +5,1154 @@
 #include "MerkelBot.h"
 #include "CSVReader.h"
 #include <chrono>
+#include <fstream>
+#include "BatchRunner.h"
+#include "ParameterSweep.h"
+#include "WalkForward.h"
+#include "MarketFeed.h"
+#include "SharedMarket.h"
+#include "AssetLedger.h"
+#include "PredictionEngine.h"
+#include "ReferenceStrategy.h"
+#include "StrategyScheduler.h"
+#include "FillSimulator.h"
+#include "BookUpdates.h"
+#include <random>
+#include <thread>
 
-int main() {
+/** complete a time of day like 17:05 with the date of the dataset */
+static std::string completeTimestamp(std::string time, std::string const& datasetTimestamp)
+{
+    // already a full timestamp
+    if (time.size() >= 19)
+    {
+        return time;
+    }
+    // pad HH:MM to HH:MM:SS
+    if (time.size() == 5)
+    {
+        time += ":00";
+    }
+    return datasetTimestamp.substr(0, 11) + time;
+}
+
+/** query subcommand: range statistics for a product side between two times */
+static int runQuery(int argc, char* argv[])
+{
+    if (argc < 6)
+    {
+        std::cout << "Usage: query <product> <bid|ask> <from> <to> [csv file]" << std::endl;
+        std::cout << "Example: query BTC/USDT bid 17:05 17:20" << std::endl;
+        return 1;
+    }
+    std::string product = argv[2];
+    OrderBookType type = OrderBookEntry::stringToOrderBookType(argv[3]);
+    std::string csvFile = argc > 6 ? argv[6] : "20200317.csv";
+
+    CSVReader csvReader{};
+    OrderBook orderBook = csvReader.readCSV(csvFile);
+    if (orderBook.timestamps.empty() || type == OrderBookType::unknown)
+    {
+        std::cout << "No data for the query" << std::endl;
+        return 1;
+    }
+
+    orderBook.buildIndex();
+    std::string from = completeTimestamp(argv[4], orderBook.timestamps.front());
+    std::string to = completeTimestamp(argv[5], orderBook.timestamps.front());
+
+    RangeStats stats;
+    try
+    {
+        stats = orderBook.queryRange(product, type, from, to);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Bad timestamp, expected HH:MM[:SS] or YYYY/MM/DD HH:MM:SS" << std::endl;
+        return 1;
+    }
+
+    std::cout << product << " " << argv[3] << " from " << from << " to " << to << std::endl;
+    std::cout << "Ticks: " << stats.ticks << std::endl;
+    std::cout << "Orders: " << stats.orders << std::endl;
+    std::cout << "Volume: " << stats.volume << std::endl;
+    std::cout << "Min price: " << stats.minPrice << std::endl;
+    std::cout << "Max price: " << stats.maxPrice << std::endl;
+    std::cout << "VWAP: " << stats.vwap() << std::endl;
+    return 0;
+}
+
+/** batch subcommand: one independent simulation per dataset file on a thread pool */
+static int runBatch(int argc, char* argv[])
+{
+    std::vector<std::string> datasetFiles;
+    std::string outputDirectory = "batch";
+    int threads = 0;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+            datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            outputDirectory = argv[++i];
+        }
+        else
+        {
+            std::cout << "Usage: batch --data <csv file or directory>... [--threads N] [--out directory]" << std::endl;
+            return 1;
+        }
+    }
+    if (datasetFiles.empty())
+    {
+        std::cout << "Usage: batch --data <csv file or directory>... [--threads N] [--out directory]" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    BatchRunner runner{datasetFiles, outputDirectory, threads};
+    std::vector<BatchRunResult> results = runner.run();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+    std::ofstream summaryFile{outputDirectory + "/BatchSummary.csv"};
+    BatchRunner::writeSummary(results, summaryFile);
+    BatchRunner::writeSummary(results, std::cout);
+
+    // sum of the run times over the wall time shows how well the pool scaled
+    long long runMicros = 0;
+    for (BatchRunResult const& r : results)
+    {
+        runMicros += r.wallTimeMicros;
+    }
+    std::cout << "Batch of " << results.size() << " runs executed in " << duration.count() << " microseconds";
+    std::cout << " (speedup " << (duration.count() > 0 ? (double)runMicros / duration.count() : 0) << "x)" << std::endl;
+    return 0;
+}
+
+/** parse a comma separated list of numbers */
+template <typename T>
+static std::vector<T> parseList(std::string const& list)
+{
+    std::vector<T> values;
+    for (std::string const& token : CSVReader::tokenise(list, ','))
+    {
+        values.push_back((T)std::stod(token));
+    }
+    return values;
+}
+
+/** sweep subcommand: evaluate a grid of strategy parameters over one shared dataset */
+static int runSweep(int argc, char* argv[])
+{
+    std::vector<std::string> datasetFiles;
+    SweepGrid grid;
+    int threads = 0;
+    size_t top = 20;
+    std::string resultsFile = "SweepResults.csv";
+    try
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--data" && i + 1 < argc)
+            {
+                std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+                datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+            }
+            else if (arg == "--windows" && i + 1 < argc)
+                grid.regressionWindows = parseList<int>(argv[++i]);
+            else if (arg == "--horizons" && i + 1 < argc)
+                grid.predictionHorizons = parseList<int>(argv[++i]);
+            else if (arg == "--fractions" && i + 1 < argc)
+                grid.standardOrderFractions = parseList<double>(argv[++i]);
+            else if (arg == "--funds" && i + 1 < argc)
+                grid.fundScales = parseList<double>(argv[++i]);
+            else if (arg == "--threads" && i + 1 < argc)
+                threads = std::atoi(argv[++i]);
+            else if (arg == "--top" && i + 1 < argc)
+                top = std::atoi(argv[++i]);
+            else if (arg == "--out" && i + 1 < argc)
+                resultsFile = argv[++i];
+            else
+                throw std::invalid_argument{arg};
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Usage: sweep [--data <csv file or directory>]... [--windows 7,14,28] [--horizons 1,7]" << std::endl;
+        std::cout << "             [--fractions 0.02,0.05] [--funds 0.5,1,2] [--threads N] [--top N] [--out file]" << std::endl;
+        return 1;
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // the dataset is loaded once and shared read-only by every run
+    CSVReader csvReader{};
+    std::shared_ptr<const OrderBook> dataset = std::make_shared<OrderBook>(csvReader.readCSVFiles(datasetFiles));
+
+    ParameterSweep sweep{dataset, grid, threads};
+    std::vector<SweepResult> results = sweep.run();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(stop - start);
+
+    std::ofstream out{resultsFile};
+    ParameterSweep::writeResults(results, out);
+    ParameterSweep::writeResults(results, std::cout, top);
+    std::cout << "Sweep of " << results.size() << " configurations executed in " << duration.count() << " microseconds" << std::endl;
+    return 0;
+}
+
+/** walkforward subcommand: replay time slices of one long dataset in parallel */
+static int runWalkForward(int argc, char* argv[])
+{
+    std::vector<std::string> datasetFiles;
+    BotParameters parameters;
+    int segments = 4;
+    // enough history for the regression window by default
+    int warmup = parameters.regressionWindow;
+    int threads = 0;
+    std::string outputDirectory = "walkforward";
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+            datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--segments" && i + 1 < argc)
+            segments = std::atoi(argv[++i]);
+        else if (arg == "--warmup" && i + 1 < argc)
+            warmup = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else if (arg == "--out" && i + 1 < argc)
+            outputDirectory = argv[++i];
+        else
+        {
+            std::cout << "Usage: walkforward [--data <csv file or directory>]... [--segments N] [--warmup ticks]" << std::endl;
+            std::cout << "                   [--threads N] [--out directory]" << std::endl;
+            return 1;
+        }
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+
+    CSVReader csvReader{};
+    std::shared_ptr<const OrderBook> dataset = std::make_shared<OrderBook>(csvReader.readCSVFiles(datasetFiles));
+
+    WalkForwardRunner runner{dataset, segments, warmup, parameters, outputDirectory, threads};
+    WalkForwardReport report = runner.run();
+
+    std::ofstream reportFile{outputDirectory + "/WalkForwardReport.csv"};
+    WalkForwardRunner::writeReport(report, reportFile);
+    WalkForwardRunner::writeReport(report, std::cout);
+    return 0;
+}
+
+/** serve subcommand: replay the dataset to one live bot over a socket */
+static int runServe(int argc, char* argv[])
+{
+    std::vector<std::string> datasetFiles;
+    std::string address = "unix:MerkelFeed.sock";
+    double speed = 1.0;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+            datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--listen" && i + 1 < argc)
+            address = argv[++i];
+        else if (arg == "--speed" && i + 1 < argc)
+            speed = std::atof(argv[++i]);
+        else
+        {
+            std::cout << "Usage: serve [--data <csv file or directory>]... [--listen unix:<path>|<host>:<port>]" << std::endl;
+            std::cout << "             [--speed <replay speed, 1 for real time, 0 for as fast as possible>]" << std::endl;
+            return 1;
+        }
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+
+    FeedServer server{datasetFiles, address, speed};
+    if (!server.run())
+    {
+        return 1;
+    }
+    server.report(std::cout);
+    return 0;
+}
+
+/** watch subcommand: example reader of the market state a bot publishes in shared memory */
+static int runWatch(int argc, char* argv[])
+{
+    std::string name = "/merkelbot";
+    int intervalMillis = 100;
+    bool once = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc)
+            name = argv[++i];
+        else if (arg == "--interval" && i + 1 < argc)
+            intervalMillis = std::atoi(argv[++i]);
+        else if (arg == "--once")
+            once = true;
+        else
+        {
+            std::cout << "Usage: watch [--shm <shared memory name>] [--interval <milliseconds>] [--once]" << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        SharedMarketReader reader{name};
+        SharedMarketSnapshot snapshot;
+        uint64_t lastSequence = 0;
+        while (true)
+        {
+            // print every new snapshot until the bot has finished
+            uint64_t sequence = reader.read(snapshot);
+            if (sequence != lastSequence)
+            {
+                SharedMarketReader::print(snapshot, std::cout);
+                lastSequence = sequence;
+            }
+            if (once || !snapshot.active)
+            {
+                return 0;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(intervalMillis));
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "watch: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+/** ledger subcommand: rebuild the bot wallets at a tick from an asset ledger */
+static int runLedger(int argc, char* argv[])
+{
+    std::string path = "BotAssets.ledger";
+    std::string at;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--file" && i + 1 < argc)
+            path = argv[++i];
+        else if (arg == "--at" && i + 1 < argc)
+            at = argv[++i];
+        else
+        {
+            std::cout << "Usage: ledger [--file <ledger file>] [--at HH:MM[:SS] | YYYY/MM/DD HH:MM:SS[.micros]]" << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        AssetLedgerReader reader{path};
+        LedgerState state;
+        bool found = reader.finalState(state);
+        if (found && !at.empty())
+        {
+            // the date of a time of day comes from the ledger
+            at = completeTimestamp(at, state.timestamp);
+            found = reader.stateAt(OrderBookEntry::timestampToMicros(at), state);
+        }
+        if (!found)
+        {
+            std::cout << "The ledger has no state at " << (at.empty() ? "its end" : at) << std::endl;
+            return 1;
+        }
+
+        std::cout << "Wallets after the tick at " << state.timestamp << ", rebuilt from the snapshot at micros "
+                  << reader.snapshotMicros() << " and " << reader.changesApplied() << " changes" << std::endl;
+        Assets assets;
+        assets.standardWallet.currencies = state.standard;
+        assets.reservedWallet.currencies = state.reserved;
+        assets.totalAssets.currencies = state.total;
+        assets.logAssets(std::cout);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "ledger: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/** parse a list of model IDs with optional weights like 0:0.5,3:0.5, an ID without a weight counts once */
+static std::vector<std::pair<int, double>> parseBlend(std::string const& list)
+{
+    std::vector<std::pair<int, double>> weights;
+    for (std::string const& token : CSVReader::tokenise(list, ','))
+    {
+        std::vector<std::string> parts = CSVReader::tokenise(token, ':');
+        weights.push_back({std::stoi(parts[0]), parts.size() > 1 ? std::stod(parts[1]) : 1.0});
+    }
+    return weights;
+}
+
+/** bench-predict subcommand: cost of one tick of the forecasting models as the number of products grows */
+static int runPredictionBenchmark(int argc, char* argv[])
+{
+    std::vector<int> productCounts = {5, 50, 500, 5000, 50000};
+    int ticks = 2000;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--products" && i + 1 < argc)
+            productCounts = parseList<int>(argv[++i]);
+        else if (arg == "--ticks" && i + 1 < argc)
+            ticks = std::atoi(argv[++i]);
+        else
+        {
+            std::cout << "Usage: bench-predict [--products N,...] [--ticks N]" << std::endl;
+            return 1;
+        }
+    }
+
+    // the regression of the bot and one model of every other kind
+    BotParameters parameters;
+    std::vector<ForecastSpec> models{ForecastSpec{ForecastKind::regression, parameters.regressionWindow}};
+    for (const char* model : {"regression:7", "regression:28", "ewma:0.3", "holt:0.5:0.1", "kalman:0.05"})
+    {
+        models.push_back(PredictionEngine::parseSpec(model));
+    }
+
+    std::cout << "Forecasting models: " << models.size() << ", ticks: " << ticks << std::endl;
+    std::cout << "products,nanoseconds per tick,nanoseconds per product and model" << std::endl;
+    for (int count : productCounts)
+    {
+        PredictionEngine engine;
+        for (int p = 0; p < count; ++p)
+        {
+            engine.addProduct("P" + std::to_string(p) + "/USDT");
+        }
+        engine.configure(parameters.predictionHorizon, models);
+
+        // random walks with a fixed seed, generated before timing
+        std::mt19937 random{42};
+        std::normal_distribution<double> step{0, 0.01};
+        std::vector<std::vector<double>> prices(ticks, std::vector<double>(count));
+        for (int p = 0; p < count; ++p)
+        {
+            double price = 100;
+            for (int t = 0; t < ticks; ++t)
+            {
+                price *= 1 + step(random);
+                prices[t][p] = price;
+            }
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int t = 0; t < ticks; ++t)
+        {
+            engine.update(prices[t]);
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+        double nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count() / (double)ticks;
+        std::cout << count << "," << nanos << "," << nanos / count / models.size() << std::endl;
+    }
+    return 0;
+}
+
+/** time the decisions of ticks over a market view, returns nanoseconds per tick and adds up the decisions made */
+template <typename Engine>
+static double timeDecisions(Engine& engine, MarketView const& view, int ticks, size_t& decisions)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < ticks; ++t)
+    {
+        decisions += engine.decide(view).decisions().size();
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count() / (double)ticks;
+}
+
+/** bench-strategy subcommand: decisions of the reference strategy through the template engine and through virtual calls */
+static int runStrategyBenchmark(int argc, char* argv[])
+{
+    std::vector<int> productCounts = {5, 50, 500, 5000};
+    int ticks = 20000;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--products" && i + 1 < argc)
+            productCounts = parseList<int>(argv[++i]);
+        else if (arg == "--ticks" && i + 1 < argc)
+            ticks = std::atoi(argv[++i]);
+        else
+        {
+            std::cout << "Usage: bench-strategy [--products N,...] [--ticks N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Ticks: " << ticks << ", one resting order per two products" << std::endl;
+    std::cout << "products,template nanoseconds per tick,virtual nanoseconds per tick,virtual/template" << std::endl;
+    for (int count : productCounts)
+    {
+        // prices around 100 with predictions up to 1% either way, generated with a fixed seed
+        std::mt19937 random{42};
+        std::uniform_real_distribution<double> move{-0.01, 0.01};
+        MarketView view;
+        for (int k = 0; k < count; ++k)
+        {
+            double price = 100 * (1 + move(random));
+            view.products.push_back("P" + std::to_string(k) + "/USDT");
+            view.baseCurrencies.push_back("P" + std::to_string(k));
+            view.quoteCurrencies.push_back("USDT");
+            view.price.push_back(price);
+            view.maxBid.push_back(price * (1 + move(random) / 10));
+            view.minAsk.push_back(price * (1 + move(random) / 10));
+            view.bidDepth.push_back(10);
+            view.askDepth.push_back(10);
+            view.prediction.push_back(price * (1 + move(random)));
+            view.orderAmount.push_back(1);
+            view.baseAvailable.push_back(100);
+            view.quoteAvailable.push_back(10000);
+            if (k % 2 == 0)
+            {
+                view.resting.push_back(RestingOrder{(size_t)k / 2, k, k % 4 == 0 ? OrderBookType::bid : OrderBookType::ask, price, 1});
+            }
+        }
+
+        StrategyEngine<ReferenceStrategy> direct;
+        std::unique_ptr<DynamicStrategy> dynamic{new DynamicStrategyAdapter<ReferenceStrategy>{}};
+        size_t directDecisions = 0, dynamicDecisions = 0;
+        // one untimed round each so both start warm
+        timeDecisions(direct, view, 1, directDecisions);
+        timeDecisions(*dynamic, view, 1, dynamicDecisions);
+        double directNanos = timeDecisions(direct, view, ticks, directDecisions);
+        double dynamicNanos = timeDecisions(*dynamic, view, ticks, dynamicDecisions);
+        if (directDecisions != dynamicDecisions)
+        {
+            std::cout << "bench-strategy: the engines made different decisions" << std::endl;
+            return 1;
+        }
+        std::cout << count << "," << directNanos << "," << dynamicNanos << "," << dynamicNanos / directNanos << std::endl;
+    }
+    return 0;
+}
+
+/** arena subcommand: many coroutine strategies trading on one market timeline */
+static int runArena(int argc, char* argv[])
+{
+#ifdef MERKELBOT_COROUTINES
+    std::vector<std::string> datasetFiles;
+    int strategies = 8;
+    int threads = 1;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+            datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--strategies" && i + 1 < argc)
+            strategies = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc)
+            threads = std::atoi(argv[++i]);
+        else
+        {
+            std::cout << "Usage: arena [--data <csv file or directory>]... [--strategies N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+
+    CSVReader csvReader{};
+    std::shared_ptr<const OrderBook> dataset = std::make_shared<OrderBook>(csvReader.readCSVFiles(datasetFiles));
+    StrategyScheduler scheduler{dataset, threads};
+
+    // the sample strategies in turn, each round with longer windows and intervals
+    std::map<std::string, double> funds = BotParameters{}.initialFunds;
+    for (int i = 0; i < strategies; ++i)
+    {
+        int round = i / 4 + 1;
+        switch (i % 4)
+        {
+            case 0:
+                scheduler.addStrategy("momentum-" + std::to_string(5 * round), [round](StrategyContext& c)
+                {
+                    return momentumStrategy(c, 5 * round, 0.001);
+                }, funds);
+                break;
+            case 1:
+                scheduler.addStrategy("reversion-" + std::to_string(5 * round), [round](StrategyContext& c)
+                {
+                    return meanReversionStrategy(c, 5 * round, 0.001);
+                }, funds);
+                break;
+            case 2:
+                scheduler.addStrategy("crossover-" + std::to_string(100 * round), [round](StrategyContext& c)
+                {
+                    return crossoverStrategy(c, 10 * round, 100 * round);
+                }, funds);
+                break;
+            default:
+                scheduler.addStrategy("averaging-" + std::to_string(60 * round) + "s", [round](StrategyContext& c)
+                {
+                    return averagingStrategy(c, 60000000LL * round, 0.01);
+                }, funds);
+                break;
+        }
+    }
+    scheduler.run();
+    scheduler.report(std::cout);
+    return 0;
+#else
+    (void)argc;
+    (void)argv;
+    std::cout << "arena: this build has no C++20 coroutine support, build with -std=c++20 to run it" << std::endl;
+    return 1;
+#endif
+}
+
+/** whatif subcommand: how much hypothetical orders posted at every tick would have filled */
+static int runWhatIf(int argc, char* argv[])
+{
+    std::vector<std::string> datasetFiles;
+    std::string product;
+    std::vector<OrderBookType> sides = {OrderBookType::bid, OrderBookType::ask};
+    std::vector<double> prices;
+    std::vector<double> amounts = {0.1, 1, 10};
+    int steps = 21;
+    try
+    {
+        for (int i = 2; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (arg == "--data" && i + 1 < argc)
+            {
+                std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+                datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+            }
+            else if (arg == "--product" && i + 1 < argc)
+                product = argv[++i];
+            else if (arg == "--side" && i + 1 < argc)
+            {
+                OrderBookType side = OrderBookEntry::stringToOrderBookType(argv[++i]);
+                if (side == OrderBookType::unknown)
+                    throw std::invalid_argument{arg};
+                sides = {side};
+            }
+            else if (arg == "--prices" && i + 1 < argc)
+                prices = parseList<double>(argv[++i]);
+            else if (arg == "--amounts" && i + 1 < argc)
+                amounts = parseList<double>(argv[++i]);
+            else if (arg == "--steps" && i + 1 < argc)
+                steps = std::max(2, std::atoi(argv[++i]));
+            else
+                throw std::invalid_argument{arg};
+        }
+        if (product.empty())
+            throw std::invalid_argument{"--product"};
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Usage: whatif --product <product> [--data <csv file or directory>]... [--side bid|ask]" << std::endl;
+        std::cout << "              [--prices p1,p2,... | --steps N] [--amounts a1,a2,...]" << std::endl;
+        return 1;
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+
+    CSVReader csvReader{};
+    OrderBook orderBook = csvReader.readCSVFiles(datasetFiles);
+    if (orderBook.timestamps.empty())
+    {
+        std::cout << "No data for the query" << std::endl;
+        return 1;
+    }
+
+    // without prices, steps prices from the lowest to the highest price of the product over the data
+    if (prices.empty())
+    {
+        orderBook.buildIndex();
+        RangeStats bids = orderBook.queryRange(product, OrderBookType::bid, orderBook.timestamps.front(), orderBook.timestamps.back());
+        RangeStats asks = orderBook.queryRange(product, OrderBookType::ask, orderBook.timestamps.front(), orderBook.timestamps.back());
+        if (bids.orders == 0 || asks.orders == 0)
+        {
+            std::cout << "No orders for " << product << std::endl;
+            return 1;
+        }
+        double low = std::min(bids.minPrice, asks.minPrice);
+        double high = std::max(bids.maxPrice, asks.maxPrice);
+        for (int i = 0; i < steps; ++i)
+        {
+            prices.push_back(low + (high - low) * i / (steps - 1));
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    FillSimulator simulator;
+    simulator.build(orderBook.ordersByTimestamp);
+    auto built = std::chrono::high_resolution_clock::now();
+
+    std::vector<FillHypothesis> hypotheses;
+    for (OrderBookType side : sides)
+    {
+        for (double price : prices)
+        {
+            for (double amount : amounts)
+            {
+                hypotheses.push_back(FillHypothesis{product, side, price, amount});
+            }
+        }
+    }
+    std::vector<FillEstimate> estimates = simulator.evaluate(hypotheses);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::cout << "side,price,amount,ticks,ticks filled,fill ratio,average fill price" << std::endl;
+    for (size_t i = 0; i < hypotheses.size(); ++i)
+    {
+        FillHypothesis const& h = hypotheses[i];
+        FillEstimate const& e = estimates[i];
+        std::cout << (h.side == OrderBookType::bid ? "bid" : "ask") << ","
+                  << h.price << ","
+                  << h.amount << ","
+                  << e.ticks << ","
+                  << e.ticksFilled << ","
+                  << e.fillRatio() << ","
+                  << e.averagePrice() << std::endl;
+    }
+    auto buildMicros = std::chrono::duration_cast<std::chrono::microseconds>(built - start).count();
+    auto queryMicros = std::chrono::duration_cast<std::chrono::microseconds>(stop - built).count();
+    std::cout << hypotheses.size() << " hypotheses over " << simulator.tickCount() << " ticks evaluated in " << queryMicros
+              << " microseconds, ladders built in " << buildMicros << " microseconds" << std::endl;
+    return 0;
+}
+
+/** updates subcommand: convert the dataset snapshots to level updates, store them and replay the stored stream
+ * the replayed levels are checked against the levels of every snapshot */
+static int runUpdates(int argc, char* argv[])
+{
+    std::vector<std::string> datasetFiles;
+    std::string outFile = "MerkelUpdates.bin";
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+            datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            outFile = argv[++i];
+        }
+        else
+        {
+            std::cout << "Usage: updates [--data <csv file or directory>]... [--out <update stream file>]" << std::endl;
+            return 1;
+        }
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+
+    CSVReader csvReader{};
+    OrderBook orderBook = csvReader.readCSVFiles(datasetFiles);
+    long long csvBytes = 0;
+    for (std::string const& file : datasetFiles)
+    {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(file, error);
+        csvBytes += error ? 0 : size;
+    }
+
+    SnapshotDiffer differ;
+    std::vector<LevelUpdate> updates;
+    size_t orders = 0;
+    size_t updateCount = 0;
+    long long streamBytes = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    try
+    {
+        UpdateStreamWriter writer{outFile};
+        for (auto const& tick : orderBook.ordersByTimestamp)
+        {
+            differ.diff(tick.second, updates);
+            writer.writeTick(tick.first, updates, differ);
+            orders += tick.second.size();
+            updateCount += updates.size();
+        }
+        streamBytes = writer.size();
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "updates " << e.what() << std::endl;
+        return 1;
+    }
+    auto converted = std::chrono::high_resolution_clock::now();
+
+    // rebuild the levels from the stream alone, by product name and side
+    std::map<std::pair<std::string, OrderBookType>, std::map<Decimal, Decimal>> levels;
+    std::vector<std::string> timestamps;
+    size_t mismatches = 0;
+    try
+    {
+        UpdateStreamReader reader{outFile};
+        std::string timestamp;
+        while (reader.nextTick(timestamp, updates))
+        {
+            for (LevelUpdate const& update : updates)
+            {
+                std::map<Decimal, Decimal>& side = levels[std::make_pair(reader.productName(update.product), update.side)];
+                if (update.type == LevelUpdateType::remove)
+                    side.erase(update.price);
+                else
+                    side[update.price] = update.amount;
+            }
+            timestamps.push_back(timestamp);
+
+            // the levels of the snapshot, summed the way the differ sums them
+            std::map<std::pair<std::string, OrderBookType>, std::map<Decimal, Decimal>> expected;
+            auto tick = orderBook.ordersByTimestamp.find(timestamp);
+            if (tick != orderBook.ordersByTimestamp.end())
+            {
+                for (OrderBookEntry const& order : tick->second)
+                {
+                    if (order.orderType == OrderBookType::bid || order.orderType == OrderBookType::ask)
+                        expected[std::make_pair(order.product, order.orderType)][order.price] += order.amount;
+                }
+            }
+            for (auto it = levels.begin(); it != levels.end(); )
+                it = it->second.empty() ? levels.erase(it) : std::next(it);
+            if (levels != expected)
+            {
+                mismatches++;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "updates " << e.what() << std::endl;
+        return 1;
+    }
+    auto replayed = std::chrono::high_resolution_clock::now();
+
+    auto convertMicros = std::chrono::duration_cast<std::chrono::microseconds>(converted - start).count();
+    auto replayMicros = std::chrono::duration_cast<std::chrono::microseconds>(replayed - converted).count();
+    std::cout << orders << " snapshot orders of " << orderBook.ordersByTimestamp.size() << " ticks converted to "
+              << updateCount << " level updates in " << convertMicros << " microseconds" << std::endl;
+    std::cout << outFile << ": " << streamBytes << " bytes, the dataset files " << csvBytes << " bytes" << std::endl;
+    std::cout << timestamps.size() << " ticks replayed in " << replayMicros << " microseconds, "
+              << mismatches << " ticks with levels different from their snapshot" << std::endl;
+    return mismatches == 0 && timestamps.size() == orderBook.ordersByTimestamp.size() ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc > 1 && std::string(argv[1]) == "query")
+    {
+        return runQuery(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "batch")
+    {
+        return runBatch(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "sweep")
+    {
+        return runSweep(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "walkforward")
+    {
+        return runWalkForward(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "serve")
+    {
+        return runServe(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "watch")
+    {
+        return runWatch(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "ledger")
+    {
+        return runLedger(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "bench-strategy")
+    {
+        return runStrategyBenchmark(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "whatif")
+    {
+        return runWhatIf(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "updates")
+    {
+        return runUpdates(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "arena")
+    {
+        return runArena(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "bench-predict")
+    {
+        return runPredictionBenchmark(argc, argv);
+    }
+
+    // dataset options: --data <file or directory> (repeatable) and --stream
+    // checkpoint options: --checkpoint <file>, --checkpoint-every <ticks> and --resume
+    // matching options: --continuous for event-driven matching and --latency for the latency report
+    // with --continuous the strategy decides once per tick and, if it has onFill, again after each fill of the bot
+    // metrics options: --metrics-window <ticks> for the rolling ratios and --metrics-every <ticks> for the series
+    // ledger options: --ledger <file> records balance changes instead of the wallet dumps of the assets log,
+    // with a snapshot every --ledger-snapshot-every <ticks>
+    // prediction options: --predict-models <model>,... for the models next to the regression (model 0), none by default,
+    // e.g. regression:28,ewma:0.3,holt:0.5:0.1,kalman:0.05, and --predict-blend <ID>[:<weight>],... for the traded prediction
+    // account options: --accounts <count> simulates retail accounts next to the bot, created from --account-seed <seed>
+    // --compact merges dataset orders with the same tick, product, side and price into one price level
+    // --compress keeps the dataset delta encoded and bit-packed in memory instead of as an order book
+    // --incremental drives the continuous books with the level updates between snapshots
+    // --candles <seconds>,... builds candles at these resolutions, passed to the strategy and written to BotCandles<seconds>s.csv
+    // pipeline options: --pipeline and --pin <ingest core>,<simulation core>,<log core>
+    // live option: --live <feed address> replaces the dataset files with a feed server
+    // shared memory option: --shm <name> publishes the market state of every tick
+    std::vector<std::string> datasetFiles;
+    bool streaming = false;
+    std::string checkpointPath = "MerkelBot.checkpoint";
+    int checkpointInterval = 0;
+    bool resume = false;
+    bool continuous = false;
+    bool latency = false;
+    bool compact = false;
+    bool compress = false;
+    bool incremental = false;
+    std::vector<int> candleResolutions;
+    int metricsWindow = 60;
+    int metricsEvery = 0;
+    std::string ledgerFile;
+    int ledgerSnapshotEvery = 100;
+    bool pipeline = false;
+    std::vector<int> cores = {-1, -1, -1};
+    std::string liveFeed;
+    std::string sharedMemory;
+    BotParameters parameters;
+    size_t accountCount = 0;
+    unsigned accountSeed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data" && i + 1 < argc)
+        {
+            std::vector<std::string> files = CSVReader::listDatasetFiles(argv[++i]);
+            datasetFiles.insert(datasetFiles.end(), files.begin(), files.end());
+        }
+        else if (arg == "--stream")
+        {
+            streaming = true;
+        }
+        else if (arg == "--checkpoint" && i + 1 < argc)
+        {
+            checkpointPath = argv[++i];
+        }
+        else if (arg == "--checkpoint-every" && i + 1 < argc)
+        {
+            checkpointInterval = std::atoi(argv[++i]);
+        }
+        else if (arg == "--resume")
+        {
+            resume = true;
+        }
+        else if (arg == "--continuous")
+        {
+            continuous = true;
+        }
+        else if (arg == "--latency")
+        {
+            latency = true;
+        }
+        else if (arg == "--metrics-window" && i + 1 < argc)
+        {
+            metricsWindow = std::atoi(argv[++i]);
+        }
+        else if (arg == "--metrics-every" && i + 1 < argc)
+        {
+            metricsEvery = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ledger" && i + 1 < argc)
+        {
+            ledgerFile = argv[++i];
+        }
+        else if (arg == "--ledger-snapshot-every" && i + 1 < argc)
+        {
+            ledgerSnapshotEvery = std::atoi(argv[++i]);
+        }
+        else if (arg == "--predict-models" && i + 1 < argc)
+        {
+            parameters.predictionModels.clear();
+            for (std::string const& model : CSVReader::tokenise(argv[++i], ','))
+            {
+                try
+                {
+                    parameters.predictionModels.push_back(PredictionEngine::parseSpec(model));
+                }
+                catch (const std::exception& e)
+                {
+                    std::cout << e.what() << std::endl;
+                    return 1;
+                }
+            }
+        }
+        else if (arg == "--predict-blend" && i + 1 < argc)
+        {
+            parameters.predictionBlend = parseBlend(argv[++i]);
+        }
+        else if (arg == "--accounts" && i + 1 < argc)
+        {
+            accountCount = std::atoll(argv[++i]);
+        }
+        else if (arg == "--account-seed" && i + 1 < argc)
+        {
+            accountSeed = std::atoi(argv[++i]);
+        }
+        else if (arg == "--compact")
+        {
+            compact = true;
+        }
+        else if (arg == "--compress")
+        {
+            compress = true;
+        }
+        else if (arg == "--incremental")
+        {
+            incremental = true;
+        }
+        else if (arg == "--candles" && i + 1 < argc)
+        {
+            candleResolutions = parseList<int>(argv[++i]);
+        }
+        else if (arg == "--pipeline")
+        {
+            pipeline = true;
+        }
+        else if (arg == "--live" && i + 1 < argc)
+        {
+            liveFeed = argv[++i];
+        }
+        else if (arg == "--shm" && i + 1 < argc)
+        {
+            sharedMemory = argv[++i];
+        }
+        else if (arg == "--pin" && i + 1 < argc)
+        {
+            cores = parseList<int>(argv[++i]);
+            cores.resize(3, -1);
+        }
+        else
+        {
+            std::cout << "Unknown option " << arg << std::endl;
+            std::cout << "Usage: [--data <csv file or directory>]... [--stream]" << std::endl;
+            std::cout << "       [--checkpoint <file>] [--checkpoint-every <ticks>] [--resume]" << std::endl;
+            std::cout << "       [--continuous [--incremental]] [--latency] [--compact] [--compress] [--pipeline] [--pin <ingest>,<simulation>,<log>]" << std::endl;
+            std::cout << "       [--metrics-window <ticks>] [--metrics-every <ticks>] [--candles <seconds>,...]" << std::endl;
+            std::cout << "       [--ledger <file>] [--ledger-snapshot-every <ticks>]" << std::endl;
+            std::cout << "       [--accounts <count>] [--account-seed <seed>]" << std::endl;
+            std::cout << "       [--predict-models <model>,...] [--predict-blend <model ID>[:<weight>],...]" << std::endl;
+            std::cout << "       [--live unix:<path>|<host>:<port>] [--shm <shared memory name>]" << std::endl;
+            std::cout << "       query <product> <bid|ask> <from> <to> [csv file]" << std::endl;
+            std::cout << "       whatif --product <product> [--data <csv file or directory>]... [--side bid|ask] [options]" << std::endl;
+            std::cout << "       batch --data <csv file or directory>... [--threads N] [--out directory]" << std::endl;
+            std::cout << "       sweep [--data <csv file or directory>]... [--windows ...] [--horizons ...] [options]" << std::endl;
+            std::cout << "       serve [--data <csv file or directory>]... [--listen <address>] [--speed <factor>]" << std::endl;
+            std::cout << "       watch [--shm <shared memory name>] [--interval <milliseconds>] [--once]" << std::endl;
+            std::cout << "       ledger [--file <ledger file>] [--at <time>]" << std::endl;
+            std::cout << "       bench-predict [--products N,...] [--ticks N]" << std::endl;
+            std::cout << "       bench-strategy [--products N,...] [--ticks N]" << std::endl;
+            std::cout << "       updates [--data <csv file or directory>]... [--out <update stream file>]" << std::endl;
+            std::cout << "       arena [--data <csv file or directory>]... [--strategies N] [--threads N]" << std::endl;
+            std::cout << "       walkforward [--data <csv file or directory>]... [--segments N] [--warmup ticks] [options]" << std::endl;
+            return 1;
+        }
+    }
+    if (datasetFiles.empty())
+    {
+        datasetFiles.push_back("20200317.csv");
+    }
+    if (!liveFeed.empty() && resume)
+    {
+        std::cout << "A live run cannot resume from a checkpoint" << std::endl;
+        return 1;
+    }
+    // a resumed run has its models and blend from the checkpoint
+    for (std::pair<int, double> const& w : parameters.predictionBlend)
+    {
+        if (!resume && (w.first < 0 || w.first > (int)parameters.predictionModels.size()))
+        {
+            std::cout << "--predict-blend model " << w.first << " does not exist, add it with --predict-models" << std::endl;
+            return 1;
+        }
+    }
 
     // starting high resolution clock to measure program running time
     auto start = std::chrono::high_resolution_clock::now();
 
-    MerkelBot app{};
+    MerkelBot app{datasetFiles, streaming};
+    app.setParameters(parameters);
+    app.setCheckpointing(checkpointPath, checkpointInterval);
+    if (resume)
+    {
+        app.setResume(checkpointPath);
+    }
+    app.setContinuousMatching(continuous);
+    app.setIncrementalBook(incremental);
+    app.setCandles(candleResolutions);
+    app.setLatencyReport(latency);
+    app.setPriceLevelCompaction(compact);
+    app.setTickCompression(compress);
+    app.setMetrics(metricsWindow, metricsEvery);
+    app.setAccounts(accountCount, accountSeed);
+    if (!ledgerFile.empty())
+    {
+        app.setLedger(ledgerFile, ledgerSnapshotEvery);
+    }
+    app.setPipelining(pipeline, cores[0], cores[1], cores[2]);
+    if (!liveFeed.empty())
+    {
+        app.setLiveFeed(liveFeed);
+    }
+    if (!sharedMemory.empty())
+    {
+        app.setSharedMemory(sharedMemory);
+    }
     app.init();
 
     // stopping high resolution clock to measure program running time
@@ -21,4 +1162,4 @@ int main() {
     std::cout << "Program executed successfully in " << duration.count() << " microseconds" << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}